@@ -27,6 +27,7 @@ public class MultiplayerSessions : ModuleRules
 			{
 				"Core",
                 "OnlineSubsystem",
+				"OnlineSubsystemUtils",
 				"OnlineSubsystemSteam",
 				"UMG",
 				"Slate",
@@ -43,6 +44,9 @@ public class MultiplayerSessions : ModuleRules
 				"Engine",
 				"Slate",
 				"SlateCore",
+				"Json",
+				"Icmp",
+				"Sockets",
 				// ... add private dependencies that you statically link with here ...	
 			}
 			);
@@ -0,0 +1,173 @@
+/// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GhostSessionCache.h"
+#include "MultiplayerSessions.h"
+#include "HAL/IConsoleManager.h"
+
+namespace MultiplayerSessionsGhostSessions
+{
+	static int32 bEnabled = 1;
+	static FAutoConsoleVariableRef CVarEnabled(
+		TEXT("MultiplayerSessions.GhostSessions.Enable"),
+		bEnabled,
+		TEXT("Leave sessions that recently failed to join (gone host, no address, timeout) out of the search results."));
+
+	static float BaseTTL = 30.f;
+	static FAutoConsoleVariableRef CVarBaseTTL(
+		TEXT("MultiplayerSessions.GhostSessions.BaseTTL"),
+		BaseTTL,
+		TEXT("Seconds a session is suppressed after its first failed join; doubles with every failure before it is forgotten."));
+
+	static float MaxTTL = 600.f;
+	static FAutoConsoleVariableRef CVarMaxTTL(
+		TEXT("MultiplayerSessions.GhostSessions.MaxTTL"),
+		MaxTTL,
+		TEXT("Most seconds a session is suppressed for, however often it failed."));
+
+	/// Everything this process recorded
+	static int32 NumFailures[static_cast<int32>(EGhostSessionReason::Num)] = {};
+	static int32 NumRepeatFailures = 0;
+	static int64 NumSuppressedResults = 0;
+	static int32 NumSearchesWithSuppressed = 0;
+	static int32 NumTracked = 0;
+
+	static FAutoConsoleCommand CmdReport(
+		TEXT("MultiplayerSessions.GhostSessions.Report"),
+		TEXT("Logs the failed joins that marked sessions as ghosts, and how many search results were left out because of them."),
+		FConsoleCommandDelegate::CreateLambda([]()
+		{
+			for (int32 Reason = 0; Reason < static_cast<int32>(EGhostSessionReason::Num); ++Reason)
+			{
+				UE_LOG(LogMultiplayerSessions, Display, TEXT("Ghost sessions: %-25s %d failed joins"), LexToString(static_cast<EGhostSessionReason>(Reason)), NumFailures[Reason]);
+			}
+			UE_LOG(LogMultiplayerSessions, Display, TEXT("Ghost sessions: %d tracked, %d failed again after their suppression ran out, %lld results suppressed over %d searches"),
+				NumTracked, NumRepeatFailures, NumSuppressedResults, NumSearchesWithSuppressed);
+		}));
+}
+
+const TCHAR* LexToString(EGhostSessionReason Reason)
+{
+	switch (Reason)
+	{
+	case EGhostSessionReason::CouldNotRetrieveAddress: return TEXT("CouldNotRetrieveAddress");
+	case EGhostSessionReason::SessionDoesNotExist: return TEXT("SessionDoesNotExist");
+	case EGhostSessionReason::Timeout: return TEXT("Timeout");
+	default: break;
+	}
+	return TEXT("Unknown");
+}
+
+FGhostSessionCache::~FGhostSessionCache()
+{
+	MultiplayerSessionsGhostSessions::NumTracked -= Entries.Num();
+}
+
+bool FGhostSessionCache::IsEnabled()
+{
+	return MultiplayerSessionsGhostSessions::bEnabled != 0;
+}
+
+bool FGhostSessionCache::GetReason(EOnJoinSessionCompleteResult::Type Result, EGhostSessionReason& OutReason)
+{
+	switch (Result)
+	{
+	case EOnJoinSessionCompleteResult::CouldNotRetrieveAddress:
+		OutReason = EGhostSessionReason::CouldNotRetrieveAddress;
+		return true;
+	case EOnJoinSessionCompleteResult::SessionDoesNotExist:
+		OutReason = EGhostSessionReason::SessionDoesNotExist;
+		return true;
+	default:
+		return false;
+	}
+}
+
+void FGhostSessionCache::RecordFailure(const FString& SessionId, EGhostSessionReason Reason)
+{
+	using namespace MultiplayerSessionsGhostSessions;
+
+	if (SessionId.IsEmpty() || !IsEnabled())
+	{
+		return;
+	}
+
+	const double Now = FPlatformTime::Seconds();
+	ForgetDecayed(Now);
+
+	FEntry* Entry = Entries.Find(SessionId);
+	if (Entry == nullptr)
+	{
+		Entry = &Entries.Add(SessionId);
+		++NumTracked;
+	}
+	else if (Now >= Entry->SuppressedUntil)
+	{
+		++NumRepeatFailures;
+	}
+
+	++Entry->NumFailures;
+	Entry->LastReason = Reason;
+	const double TTL = FMath::Min(BaseTTL * FMath::Pow(2.f, FMath::Min(Entry->NumFailures - 1, 16)), MaxTTL);
+	Entry->SuppressedUntil = Now + TTL;
+	Entry->ForgetAt = Entry->SuppressedUntil + TTL;
+	++NumFailures[static_cast<int32>(Reason)];
+
+	UE_LOG(LogMultiplayerSessions, Log, TEXT("Ghost session %s (%s, failure %d): suppressed for %.0f s"), *SessionId, LexToString(Reason), Entry->NumFailures, TTL);
+}
+
+void FGhostSessionCache::RecordSuccess(const FString& SessionId)
+{
+	if (Entries.Remove(SessionId) > 0)
+	{
+		--MultiplayerSessionsGhostSessions::NumTracked;
+	}
+}
+
+bool FGhostSessionCache::IsSuppressed(const FString& SessionId) const
+{
+	const FEntry* Entry = Entries.Find(SessionId);
+	return IsEnabled() && Entry && FPlatformTime::Seconds() < Entry->SuppressedUntil;
+}
+
+TSet<FString> FGhostSessionCache::GetSuppressedSessionIds()
+{
+	TSet<FString> SuppressedSessionIds;
+	if (!IsEnabled())
+	{
+		return SuppressedSessionIds;
+	}
+
+	const double Now = FPlatformTime::Seconds();
+	ForgetDecayed(Now);
+	for (const TPair<FString, FEntry>& Entry : Entries)
+	{
+		if (Now < Entry.Value.SuppressedUntil)
+		{
+			SuppressedSessionIds.Add(Entry.Key);
+		}
+	}
+	return SuppressedSessionIds;
+}
+
+void FGhostSessionCache::RecordSuppressedResults(int32 NumSuppressed)
+{
+	if (NumSuppressed > 0)
+	{
+		MultiplayerSessionsGhostSessions::NumSuppressedResults += NumSuppressed;
+		++MultiplayerSessionsGhostSessions::NumSearchesWithSuppressed;
+	}
+}
+
+void FGhostSessionCache::ForgetDecayed(double Now)
+{
+	const int32 NumBefore = Entries.Num();
+	for (auto It = Entries.CreateIterator(); It; ++It)
+	{
+		if (Now >= It.Value().ForgetAt)
+		{
+			It.RemoveCurrent();
+		}
+	}
+	MultiplayerSessionsGhostSessions::NumTracked -= NumBefore - Entries.Num();
+}
@@ -0,0 +1,85 @@
+/// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "LobbyReservationBeaconClient.h"
+#include "LobbyReservationBeaconHostObject.h"
+#include "MultiplayerSessions.h"
+
+const TCHAR* ALobbyReservationBeaconClient::ReservationTokenOption = TEXT("ReservationToken");
+
+bool ALobbyReservationBeaconClient::RequestReservation(const FString& ConnectInfo, int32 NumSlots, const TArray<FUniqueNetIdRepl>& PartyMembers, bool bWaitIfFull)
+{
+	RequestedPartyMembers = PartyMembers;
+	bWaitIfFullRequested = bWaitIfFull;
+	NumRequestedSlots = FMath::Max(NumSlots, PartyMembers.Num() + 1);
+
+	FURL URL(nullptr, *ConnectInfo, TRAVEL_Absolute);
+	if (!URL.Valid || !InitClient(URL))
+	{
+		UE_LOG(LogMultiplayerSessions, Warning, TEXT("Could not connect reservation beacon to %s"), *ConnectInfo);
+		return false;
+	}
+	return true;
+}
+
+void ALobbyReservationBeaconClient::OnConnected()
+{
+	Super::OnConnected();
+
+	ServerRequestReservation(NumRequestedSlots, RequestedPartyMembers, bWaitIfFullRequested);
+}
+
+void ALobbyReservationBeaconClient::OnFailure()
+{
+	/// No answer is not a "full": the host may be on a build without the beacon, the caller decides whether to join anyway
+	FinishRequest(false, false, FString());
+
+	Super::OnFailure();
+}
+
+bool ALobbyReservationBeaconClient::ServerRequestReservation_Validate(int32 NumSlots, const TArray<FUniqueNetIdRepl>& PartyMembers, bool bWaitIfFull)
+{
+	/// Only what no client of ours would send; a party too big for this lobby is refused by the host object, not kicked
+	return NumSlots > PartyMembers.Num();
+}
+
+void ALobbyReservationBeaconClient::ServerRequestReservation_Implementation(int32 NumSlots, const TArray<FUniqueNetIdRepl>& PartyMembers, bool bWaitIfFull)
+{
+	FString ReservationToken;
+	ALobbyReservationBeaconHostObject* HostObject = Cast<ALobbyReservationBeaconHostObject>(GetBeaconOwner());
+	const bool bAccepted = HostObject && HostObject->ProcessReservationRequest(NumSlots, PartyMembers, ReservationToken);
+
+	/// The host answers from its waitlist later, see ALobbyReservationBeaconHostObject::ProcessWaitlist
+	/// A party bigger than the whole lobby would never leave it
+	if (!bAccepted && bWaitIfFull && HostObject && HostObject->CanEverFit(NumSlots) && HostObject->AddToWaitlist(this, NumSlots, PartyMembers))
+	{
+		return;
+	}
+
+	ClientReservationResponse(bAccepted, ReservationToken);
+}
+
+void ALobbyReservationBeaconClient::ClientReservationResponse_Implementation(bool bAccepted, const FString& ReservationToken)
+{
+	FinishRequest(true, bAccepted, ReservationToken);
+
+	/// The beacon has done its job; the game connection is made by the travel that follows
+	DestroyBeacon();
+}
+
+void ALobbyReservationBeaconClient::ClientWaitlistPosition_Implementation(int32 Position)
+{
+	UE_LOG(LogMultiplayerSessions, Log, TEXT("Lobby is full, waiting for a slot: position %d"), Position);
+	OnWaitlistPosition.Broadcast(Position);
+}
+
+void ALobbyReservationBeaconClient::FinishRequest(bool bHostReached, bool bAccepted, const FString& ReservationToken)
+{
+	if (bRequestFinished)
+	{
+		return;
+	}
+	bRequestFinished = true;
+
+	OnReservationResponse.Broadcast(bHostReached, bAccepted, ReservationToken);
+}
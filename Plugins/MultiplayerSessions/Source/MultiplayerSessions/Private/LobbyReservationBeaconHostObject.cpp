@@ -0,0 +1,284 @@
+/// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "LobbyReservationBeaconHostObject.h"
+#include "LobbyReservationBeaconClient.h"
+#include "MultiplayerSessions.h"
+#include "OnlineBeaconHost.h"
+#include "TimerManager.h"
+
+ALobbyReservationBeaconHostObject::ALobbyReservationBeaconHostObject()
+{
+	ClientBeaconActorClass = ALobbyReservationBeaconClient::StaticClass();
+	BeaconTypeName = ClientBeaconActorClass->GetName();
+}
+
+ALobbyReservationBeaconHostObject* ALobbyReservationBeaconHostObject::StartListening(UWorld* World)
+{
+	AOnlineBeaconHost* BeaconHost = World->SpawnActor<AOnlineBeaconHost>();
+	if (BeaconHost == nullptr || !BeaconHost->InitHost())
+	{
+		UE_LOG(LogMultiplayerSessions, Warning, TEXT("Reservation beacon could not listen, clients will join without reserving"));
+		if (BeaconHost)
+		{
+			BeaconHost->Destroy();
+		}
+		return nullptr;
+	}
+
+	ALobbyReservationBeaconHostObject* HostObject = World->SpawnActor<ALobbyReservationBeaconHostObject>();
+	HostObject->BeaconHost = BeaconHost;
+	BeaconHost->RegisterHost(HostObject);
+	BeaconHost->PauseBeaconRequests(false);
+
+	UE_LOG(LogMultiplayerSessions, Log, TEXT("Reservation beacon listening on port %d"), BeaconHost->GetListenPort());
+	return HostObject;
+}
+
+void ALobbyReservationBeaconHostObject::StopListening()
+{
+	GetWorldTimerManager().ClearTimer(ExpiryTimerHandle);
+	Reservations.Reset();
+
+	/// Nobody is going to leave a lobby that is going away
+	for (const FWaitlistEntry& Entry : Waitlist)
+	{
+		if (Entry.Client.IsValid())
+		{
+			Entry.Client->ClientReservationResponse(false, FString());
+		}
+	}
+	Waitlist.Reset();
+
+	if (BeaconHost)
+	{
+		BeaconHost->UnregisterHost(BeaconTypeName);
+		BeaconHost->DestroyBeacon();
+		BeaconHost = nullptr;
+	}
+	Destroy();
+}
+
+bool ALobbyReservationBeaconHostObject::ProcessReservationRequest(int32 NumSlots, const TArray<FUniqueNetIdRepl>& PartyMembers, FString& OutReservationToken)
+{
+	ExpireReservations();
+
+	if (!CanEverFit(NumSlots))
+	{
+		UE_LOG(LogMultiplayerSessions, Log, TEXT("Reservation for %d rejected, the lobby holds %d"), NumSlots, GetMaxSlots.Execute());
+		return false;
+	}
+
+	const int32 UnreservedOpenSlots = GetUnreservedOpenSlots();
+	if (NumSlots > UnreservedOpenSlots)
+	{
+		UE_LOG(LogMultiplayerSessions, Log, TEXT("Reservation for %d rejected, %d slots open"), NumSlots, UnreservedOpenSlots);
+		return false;
+	}
+
+	OutReservationToken = FGuid::NewGuid().ToString(EGuidFormats::Digits);
+	FReservation& Reservation = Reservations.Add(OutReservationToken);
+	Reservation.RemainingSlots = NumSlots;
+	Reservation.PartyMembers = PartyMembers;
+	Reservation.ExpiryTime = FPlatformTime::Seconds() + ReservationTimeout;
+
+	StartExpiryTimer();
+
+	UE_LOG(LogMultiplayerSessions, Log, TEXT("Reserved %d slots (%s), %d left"), NumSlots, *OutReservationToken, UnreservedOpenSlots - NumSlots);
+	return true;
+}
+
+bool ALobbyReservationBeaconHostObject::CanEverFit(int32 NumSlots)
+{
+	return !GetMaxSlots.IsBound() || NumSlots <= GetMaxSlots.Execute();
+}
+
+bool ALobbyReservationBeaconHostObject::CanPlayerLogin(const FString& ReservationToken, const FUniqueNetIdRepl& UniqueId)
+{
+	ExpireReservations();
+
+	FString Key;
+	const FReservation* Reservation = FindReservation(ReservationToken, UniqueId, Key);
+	if (Reservation && Reservation->RemainingSlots > 0)
+	{
+		return true;
+	}
+
+	/// Players without a reservation can't take slots that are held for someone else
+	return GetUnreservedOpenSlots() > 0;
+}
+
+void ALobbyReservationBeaconHostObject::ConsumeReservation(const FString& ReservationToken, const FUniqueNetIdRepl& UniqueId)
+{
+	FString Key;
+	FReservation* Reservation = FindReservation(ReservationToken, UniqueId, Key);
+	if (Reservation == nullptr)
+	{
+		return;
+	}
+
+	Reservation->PartyMembers.Remove(UniqueId);
+	if (--Reservation->RemainingSlots <= 0)
+	{
+		Reservations.Remove(Key);
+	}
+}
+
+ALobbyReservationBeaconHostObject::FReservation* ALobbyReservationBeaconHostObject::FindReservation(const FString& ReservationToken, const FUniqueNetIdRepl& UniqueId, FString& OutKey)
+{
+	if (!ReservationToken.IsEmpty())
+	{
+		if (FReservation* Reservation = Reservations.Find(ReservationToken))
+		{
+			OutKey = ReservationToken;
+			return Reservation;
+		}
+	}
+
+	if (UniqueId.IsValid())
+	{
+		for (TPair<FString, FReservation>& Pair : Reservations)
+		{
+			if (Pair.Value.PartyMembers.Contains(UniqueId))
+			{
+				OutKey = Pair.Key;
+				return &Pair.Value;
+			}
+		}
+	}
+	return nullptr;
+}
+
+int32 ALobbyReservationBeaconHostObject::GetUnreservedOpenSlots()
+{
+	const int32 OpenSlots = GetOpenSlots.IsBound() ? GetOpenSlots.Execute() : 0;
+	return OpenSlots - GetReservedSlots();
+}
+
+int32 ALobbyReservationBeaconHostObject::GetReservedSlots() const
+{
+	int32 ReservedSlots = 0;
+	for (const TPair<FString, FReservation>& Pair : Reservations)
+	{
+		ReservedSlots += Pair.Value.RemainingSlots;
+	}
+	return ReservedSlots;
+}
+
+bool ALobbyReservationBeaconHostObject::ExpireReservations()
+{
+	bool bExpiredAny = false;
+	const double Now = FPlatformTime::Seconds();
+	for (auto It = Reservations.CreateIterator(); It; ++It)
+	{
+		if (Now > It->Value.ExpiryTime)
+		{
+			UE_LOG(LogMultiplayerSessions, Log, TEXT("Reservation %s expired with %d slots unused"), *It->Key, It->Value.RemainingSlots);
+			It.RemoveCurrent();
+			bExpiredAny = true;
+		}
+	}
+	return bExpiredAny;
+}
+
+void ALobbyReservationBeaconHostObject::StartExpiryTimer()
+{
+	if (!GetWorldTimerManager().IsTimerActive(ExpiryTimerHandle))
+	{
+		GetWorldTimerManager().SetTimer(ExpiryTimerHandle, this, &ThisClass::OnExpiryTimer, 1.f, true);
+	}
+}
+
+void ALobbyReservationBeaconHostObject::OnExpiryTimer()
+{
+	/// Slots of players that never showed up go to whoever is waiting; ProcessWaitlist also times out the wait
+	ExpireReservations();
+	if (Waitlist.Num() > 0)
+	{
+		ProcessWaitlist();
+	}
+
+	if (Reservations.Num() == 0 && Waitlist.Num() == 0)
+	{
+		GetWorldTimerManager().ClearTimer(ExpiryTimerHandle);
+	}
+}
+
+bool ALobbyReservationBeaconHostObject::AddToWaitlist(ALobbyReservationBeaconClient* Client, int32 NumSlots, const TArray<FUniqueNetIdRepl>& PartyMembers)
+{
+	if (Waitlist.Num() >= MaxWaitlistLength)
+	{
+		UE_LOG(LogMultiplayerSessions, Log, TEXT("Waitlist is full (%d), turning away a request for %d"), Waitlist.Num(), NumSlots);
+		return false;
+	}
+
+	FWaitlistEntry& Entry = Waitlist.AddDefaulted_GetRef();
+	Entry.Client = Client;
+	Entry.NumSlots = NumSlots;
+	Entry.PartyMembers = PartyMembers;
+	Entry.ExpiryTime = FPlatformTime::Seconds() + WaitlistTimeout;
+	UE_LOG(LogMultiplayerSessions, Log, TEXT("Lobby is full, request for %d slots waits at position %d"), NumSlots, Waitlist.Num());
+
+	StartExpiryTimer();
+	ProcessWaitlist();
+	return true;
+}
+
+void ALobbyReservationBeaconHostObject::ProcessWaitlist()
+{
+	const double Now = FPlatformTime::Seconds();
+	Waitlist.RemoveAll([Now](const FWaitlistEntry& Entry)
+	{
+		if (!Entry.Client.IsValid())
+		{
+			return true;
+		}
+		if (Now > Entry.ExpiryTime)
+		{
+			UE_LOG(LogMultiplayerSessions, Log, TEXT("Waitlist entry for %d timed out"), Entry.NumSlots);
+			Entry.Client->ClientReservationResponse(false, FString());
+			return true;
+		}
+		return false;
+	});
+
+	/// In order: the first in line gets the next free slots
+	while (Waitlist.Num() > 0 && Waitlist[0].NumSlots <= GetUnreservedOpenSlots())
+	{
+		const FWaitlistEntry Entry = Waitlist[0];
+		Waitlist.RemoveAt(0);
+
+		FString ReservationToken;
+		if (ProcessReservationRequest(Entry.NumSlots, Entry.PartyMembers, ReservationToken))
+		{
+			UE_LOG(LogMultiplayerSessions, Log, TEXT("Waitlist: reserved %d slots for the first in line, %d still waiting"), Entry.NumSlots, Waitlist.Num());
+			Entry.Client->ClientReservationResponse(true, ReservationToken);
+		}
+	}
+
+	for (int32 Index = 0; Index < Waitlist.Num(); ++Index)
+	{
+		FWaitlistEntry& Entry = Waitlist[Index];
+		if (Entry.SentPosition != Index + 1)
+		{
+			Entry.SentPosition = Index + 1;
+			Entry.Client->ClientWaitlistPosition(Entry.SentPosition);
+		}
+	}
+}
+
+void ALobbyReservationBeaconHostObject::NotifyClientDisconnected(AOnlineBeaconClient* LeavingClientActor)
+{
+	/// A client that gave up waiting lets the ones behind it move up
+	const int32 NumRemoved = Waitlist.RemoveAll([LeavingClientActor](const FWaitlistEntry& Entry)
+	{
+		return Entry.Client.Get() == LeavingClientActor;
+	});
+
+	Super::NotifyClientDisconnected(LeavingClientActor);
+
+	if (NumRemoved > 0)
+	{
+		ProcessWaitlist();
+	}
+}
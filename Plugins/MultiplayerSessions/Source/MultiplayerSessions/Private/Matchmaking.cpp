@@ -0,0 +1,189 @@
+/// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Matchmaking.h"
+#include "SessionResultStore.h"
+#include "MultiplayerSessions.h"
+#include "HAL/IConsoleManager.h"
+
+namespace MultiplayerSessionsMatchmaking
+{
+	static int32 bEnabled = 1;
+	static FAutoConsoleVariableRef CVarEnabled(
+		TEXT("MultiplayerSessions.Matchmaking.Enable"),
+		bEnabled,
+		TEXT("Join from the menu by matchmaking in widening stages instead of one broad search."));
+
+	static FString Stages;
+	static FAutoConsoleVariableRef CVarStages(
+		TEXT("MultiplayerSessions.Matchmaking.Stages"),
+		Stages,
+		TEXT("Matchmaking stages, tightest first: \"Duration,MaxSearchResults,bSameRegion,MaxPingInMs,MinFillRatio\" per stage, separated by ';'. Empty uses the built-in stages."));
+
+	static FAutoConsoleCommand CmdReport(
+		TEXT("MultiplayerSessions.Matchmaking.Report"),
+		TEXT("Logs the hit rate of every matchmaking stage, the time spent in it, and how many matchmakings it ended."),
+		FConsoleCommandDelegate::CreateLambda([]()
+		{
+			FMatchmakingStats::Get().Report();
+		}));
+}
+
+bool FMatchmakingStage::IsEnabled()
+{
+	return MultiplayerSessionsMatchmaking::bEnabled != 0;
+}
+
+void FMatchmakingStage::SelectCandidates(const FSessionResultStore& SearchResults, TArray<int32>& OutCandidates) const
+{
+	OutCandidates.Reset();
+	for (int32 Index = 0; Index < SearchResults.Num(); ++Index)
+	{
+		const int32 MaxPlayers = SearchResults.GetMaxPlayers(Index);
+		const int32 NumPlayers = SearchResults.GetNumPlayers(Index);
+		if (NumPlayers >= MaxPlayers || SearchResults.GetAttributes(Index).LobbyState == ESessionLobbyState::Ending)
+		{
+			continue;
+		}
+
+		if (MinFillRatio > 0.f && NumPlayers < MinFillRatio * MaxPlayers)
+		{
+			continue;
+		}
+
+		/// Presence lobbies often come without a ping; those are left to the QoS probe of the join
+		const int32 PingInMs = SearchResults.GetPingInMs(Index);
+		if (MaxPingInMs > 0 && PingInMs > MaxPingInMs && PingInMs < MAX_QUERY_PING)
+		{
+			continue;
+		}
+
+		OutCandidates.Add(Index);
+	}
+}
+
+TArray<FMatchmakingStage> FMatchmakingStage::GetDefaultStages()
+{
+	TArray<FMatchmakingStage> DefaultStages;
+	if (!MultiplayerSessionsMatchmaking::Stages.IsEmpty())
+	{
+		if (ParseStages(MultiplayerSessionsMatchmaking::Stages, DefaultStages))
+		{
+			return DefaultStages;
+		}
+		UE_LOG(LogMultiplayerSessions, Warning, TEXT("MultiplayerSessions.Matchmaking.Stages doesn't parse, using the built-in stages: %s"), *MultiplayerSessionsMatchmaking::Stages);
+	}
+
+	/// Duration, MaxSearchResults, bSameRegion, MaxPingInMs, MinFillRatio
+	DefaultStages.Add({ 4.f, 20, true, 60, 0.5f });
+	DefaultStages.Add({ 6.f, 50, true, 120, 0.f });
+	DefaultStages.Add({ 8.f, 100, false, 200, 0.f });
+	DefaultStages.Add({ 12.f, 200, false, 0, 0.f });
+	return DefaultStages;
+}
+
+bool FMatchmakingStage::ParseStages(const FString& String, TArray<FMatchmakingStage>& OutStages)
+{
+	OutStages.Reset();
+
+	TArray<FString> StageStrings;
+	String.ParseIntoArray(StageStrings, TEXT(";"));
+	for (const FString& StageString : StageStrings)
+	{
+		TArray<FString> Fields;
+		StageString.ParseIntoArray(Fields, TEXT(","));
+		if (Fields.Num() != 5)
+		{
+			OutStages.Reset();
+			return false;
+		}
+
+		FMatchmakingStage& Stage = OutStages.AddDefaulted_GetRef();
+		Stage.Duration = FCString::Atof(*Fields[0].TrimStartAndEnd());
+		Stage.MaxSearchResults = FCString::Atoi(*Fields[1].TrimStartAndEnd());
+		Stage.bSameRegion = FCString::ToBool(*Fields[2].TrimStartAndEnd());
+		Stage.MaxPingInMs = FCString::Atoi(*Fields[3].TrimStartAndEnd());
+		Stage.MinFillRatio = FCString::Atof(*Fields[4].TrimStartAndEnd());
+		if (Stage.Duration <= 0.f || Stage.MaxSearchResults <= 0)
+		{
+			OutStages.Reset();
+			return false;
+		}
+	}
+	return OutStages.Num() > 0;
+}
+
+FMatchmakingStats& FMatchmakingStats::Get()
+{
+	static FMatchmakingStats Stats;
+	return Stats;
+}
+
+FMatchmakingStats::FStageStats& FMatchmakingStats::GetStage(int32 StageIndex)
+{
+	if (StageIndex >= Stages.Num())
+	{
+		Stages.SetNum(StageIndex + 1);
+	}
+	return Stages[StageIndex];
+}
+
+void FMatchmakingStats::RecordSearch(int32 StageIndex, int32 NumResults, int32 NumCandidates)
+{
+	FStageStats& Stage = GetStage(StageIndex);
+	++Stage.NumSearches;
+	Stage.NumResults += NumResults;
+	if (NumCandidates > 0)
+	{
+		++Stage.NumSearchesWithCandidates;
+	}
+}
+
+void FMatchmakingStats::RecordStage(int32 StageIndex, double Seconds, bool bMatched)
+{
+	FStageStats& Stage = GetStage(StageIndex);
+	++Stage.NumEntered;
+	Stage.Seconds += Seconds;
+	if (bMatched)
+	{
+		++Stage.NumMatched;
+	}
+}
+
+void FMatchmakingStats::RecordMatchmaking(bool bMatched, bool bCanceled, double Seconds)
+{
+	++NumMatchmakings;
+	if (bCanceled)
+	{
+		++NumCanceled;
+	}
+	else if (bMatched)
+	{
+		++NumMatched;
+		SecondsToMatch += Seconds;
+	}
+	else
+	{
+		++NumExhausted;
+	}
+}
+
+void FMatchmakingStats::Report() const
+{
+	UE_LOG(LogMultiplayerSessions, Display, TEXT("Matchmaking: %d started, %d matched (%.1f s to match on average), %d ran out of stages, %d canceled"),
+		NumMatchmakings, NumMatched, NumMatched > 0 ? SecondsToMatch / NumMatched : 0.0, NumExhausted, NumCanceled);
+
+	for (int32 StageIndex = 0; StageIndex < Stages.Num(); ++StageIndex)
+	{
+		const FStageStats& Stage = Stages[StageIndex];
+		UE_LOG(LogMultiplayerSessions, Display, TEXT("Matchmaking stage %d: entered %d times, %d searches, %.0f%% hit, %.1f results per search, %.1f s spent (%.1f s per entry), matched %d"),
+			StageIndex,
+			Stage.NumEntered,
+			Stage.NumSearches,
+			Stage.NumSearches > 0 ? 100.0 * Stage.NumSearchesWithCandidates / Stage.NumSearches : 0.0,
+			Stage.NumSearches > 0 ? static_cast<double>(Stage.NumResults) / Stage.NumSearches : 0.0,
+			Stage.Seconds,
+			Stage.NumEntered > 0 ? Stage.Seconds / Stage.NumEntered : 0.0,
+			Stage.NumMatched);
+	}
+}
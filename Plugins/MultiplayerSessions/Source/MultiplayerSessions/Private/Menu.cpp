@@ -4,9 +4,11 @@
 #include "Menu.h"
 #include "Components/Button.h"
 #include "MultiplayerSessionsSubsystem.h"
+#include "MultiplayerSessionsTrace.h"
+#include "MultiplayerSessionsHitchWatchdog.h"
+#include "ServerBrowser.h"
 #include "OnlineSessionSettings.h"
 #include "Interfaces/OnlineSessionInterface.h"
-#include "OnlineSubsystem.h"
 
 void UMenu::MenuSetup(int32 NumberOfPublicConnections, FString TypeOfMatch, FString LobbyPath)
 {
@@ -60,14 +62,17 @@ void UMenu::MenuSetup(int32 NumberOfPublicConnections, FString TypeOfMatch, FStr
 	}
 
 	/// check if the multiplayer session subsystem is valid
-	/// if it is valid, then we can bind the callbacks to the delegates in the subsystem
+	/// The menu doesn't bind to the subsystem's delegates; each click chains on the future of its own call
 	if (MultiplayerSessionsSubsystem)
 	{
-		MultiplayerSessionsSubsystem->MultiplayerOnCreateSessionComplete.AddDynamic(this, &ThisClass::OnCreateSession);
-		MultiplayerSessionsSubsystem->MultiplayerOnFindSessionsComplete.AddUObject(this, &ThisClass::OnFindSessions);
-		MultiplayerSessionsSubsystem->MultiplayerOnJoinSessionComplete.AddUObject(this, &ThisClass::OnJoinSession);
-		MultiplayerSessionsSubsystem->MultiplayerOnDestroySessionComplete.AddDynamic(this, &ThisClass::OnDestroySession);
-		MultiplayerSessionsSubsystem->MultiplayerOnStartSessionComplete.AddDynamic(this, &ThisClass::OnStartSession);
+		/// Accepting a friend's invite from the menu follows them into their session
+		MultiplayerSessionsSubsystem->StartListeningForPartyInvites();
+
+		/// Progress, not a result, so it is the one delegate the menu binds; once, however often MenuSetup runs
+		if (!MultiplayerSessionsSubsystem->MultiplayerOnWaitlistPosition.IsBoundToObject(this))
+		{
+			MultiplayerSessionsSubsystem->MultiplayerOnWaitlistPosition.AddUObject(this, &ThisClass::OnWaitlistPosition);
+		}
 	}
 }
 
@@ -95,6 +100,13 @@ bool UMenu::Initialize()
 	{
 		JoinButton->OnClicked.AddDynamic(this, &ThisClass::JoinButtonClicked);
 	}
+
+	/// Check if the menu blueprint has a server browser
+	/// If it does, joining goes through the row the player picks
+	if (ServerBrowser)
+	{
+		ServerBrowser->OnJoinRequested.AddUObject(this, &ThisClass::OnServerBrowserJoinRequested);
+	}
 	
 	return true;
 }
@@ -125,7 +137,11 @@ void UMenu::OnCreateSession(bool bWasSuccessful)
 		UWorld* World = GetWorld();
 		if (World)
 		{
-			World->ServerTravel(PathToLobby);
+			/// Carry the correlation id to the lobby so the listen server's own login is traced with the same id
+			const FGuid& CorrelationId = MultiplayerSessionsSubsystem ? MultiplayerSessionsSubsystem->GetTraceCorrelationId() : FGuid();
+			MultiplayerSessionsTrace::TracePhase(CorrelationId, TEXT("Travel"), EMultiplayerSessionsTraceEdge::Begin);
+			MULTIPLAYERSESSIONS_TRAVEL_HITCH_SCOPE(ServerTravel);
+			World->ServerTravel(MultiplayerSessionsTrace::AddCorrelationIdToURL(PathToLobby, CorrelationId));
 		}
 		
 	}
@@ -145,7 +161,7 @@ void UMenu::OnCreateSession(bool bWasSuccessful)
 	}
 }
 
-void UMenu::OnFindSessions(const TArray<FOnlineSessionSearchResult>& SearchResults, bool bWasSuccessful)
+void UMenu::OnFindSessions(const TSharedRef<FSessionResultStore>& SearchResults, bool bWasSuccessful)
 {
 	/// Check if MultiplayerSessionSubsystem is valid
 	/// If it is not valid, then we will simply return out of the function
@@ -153,34 +169,38 @@ void UMenu::OnFindSessions(const TArray<FOnlineSessionSearchResult>& SearchResul
 	{
 		return;
 	}
+
+	/// With a server browser, list everything that was found and let the player pick
+	/// Join becomes a refresh button
+	if (ServerBrowser)
+	{
+		ServerBrowser->SetSearchResults(SearchResults);
+		JoinButton->SetIsEnabled(true);
+		return;
+	}
 	
-	/// loop through the list of sessions and print out the session names
-	/// We will use the SessionSearch TSharedPtr to get the list of sessions
-	for (auto Result : SearchResults)
+	/// The subsystem only kept sessions of our match type, ranked best first, so every one of them is a candidate
+	TArray<int32> Candidates;
+	for (int32 Index = 0; Index < SearchResults->Num(); ++Index)
 	{
-		/// Get the session name
-		FString Id = Result.GetSessionIdStr();
-		/// Get the session owning player
-		FString User = Result.Session.OwningUserName;
-		
-		/// Create a variable to store the matchType value passed from the SearchResults
-		FString SettingsValue;
-		
-		/// Get the match type, using the Get function on the SessionSearch
-		Result.Session.SessionSettings.Get(FName("MatchType"), SettingsValue);
-		
-		/// Check if the match type is the same as the match type we are looking for
-		if (SettingsValue == MatchType)
-		{
-			/// Once we found a session that meets out search criteria
-			/// Call JoinSession on the MultiplayerSessionsSubsytem, passing in the found session Result
-			/// Don't need to continue looping through the searchResults, so return out of this function
-			MultiplayerSessionsSubsystem->JoinSession(Result);
-			return;
-		}
+		Candidates.Add(Index);
+	}
+
+	/// Let the MultiplayerSessionsSubsystem measure the candidates and join the closest one
+	if (Candidates.Num() > 0)
+	{
+		MultiplayerSessionsSubsystem->JoinBestSessionAsync(*SearchResults, Candidates, CancellationToken)
+			.Next([WeakThis = TWeakObjectPtr<UMenu>(this)](const FJoinSessionResult& Result)
+			{
+				if (WeakThis.IsValid() && !Result.bWasCanceled)
+				{
+					WeakThis->OnJoinSession(Result.Result);
+				}
+			});
+		return;
 	}
 	
-	if (!bWasSuccessful || SearchResults.Num() == 0)
+	if (!bWasSuccessful || SearchResults->Num() == 0)
 	{
 		/// Display a message to the user that the session was not found
 		if (GEngine)
@@ -202,47 +222,27 @@ void UMenu::OnJoinSession(EOnJoinSessionCompleteResult::Type Result)
 	/// Once the action of joining a session has been completed.
 
 
-	/// Access the OnlineSubsystem using the getter function, then check if the OnlineSubsystem is Valid
-	/// If OnlineSubsystem is Valid, access the OnlineSubsystem Interface
-	IOnlineSubsystem* Subsystem = IOnlineSubsystem::Get();
-
-	/// If the OnlineSubsystem is valid, then we can use the interface
-	if (Subsystem)
+	/// Check if MultiplayerSessionSubsystem is valid and the join succeeded (e.g. not turned away by a full lobby's reservation beacon)
+	/// The subsystem owns the session interface, so ask it for the address of the session we joined
+	if (MultiplayerSessionsSubsystem && Result == EOnJoinSessionCompleteResult::Success)
 	{
-		/// Get the Interface to the OnlineSessionInterface
-		/// The OnlineSessionInterface is used to create, join, and destroy sessions
-		/// We can access get SessionInterface and store it in our SessionInterface pointer
-		IOnlineSessionPtr SessionInterface = Subsystem->GetSessionInterface();
+		/// Store the IP address in the FString variable "Address"
+		FString Address;
 
-		/// Check if the OnlineSessionInterface is valid
-		if (SessionInterface.IsValid())
+		/// Get Address or ResolvedConnectString
+		if (MultiplayerSessionsSubsystem->GetResolvedConnectString(Address))
 		{
-			/// Store the IP address in the FString variable "Address"
-			FString Address;
-
-			/// Get Address or ResolvedConnectString
-			SessionInterface->GetResolvedConnectString(NAME_GameSession, Address);
-
-			//if (GEngine)
-			//{
-			//	GEngine->AddOnScreenDebugMessage(
-			//		-1,
-			//		15.f,
-			//		FColor::Yellow,
-			//		FString::Printf(TEXT("Connect String: %s"), *Address)
-			//	);
-			//}
-
 			/// Get the player controller by using GetGameInstance
 			APlayerController* PlayerController = GetGameInstance()->GetFirstLocalPlayerController();
 
 			/// Check if the player controller is valid
-			/// Call the ServerTravel function on the PlayerController, passing in the Address and the TravelType
+			/// Call the ClientTravel function on the PlayerController, passing in the Address and the TravelType
 			if (PlayerController)
 			{
-
-				
-				PlayerController->ClientTravel(Address, ETravelType::TRAVEL_Absolute);
+				/// The correlation id and reservation token ride along as URL options and are read back by the server in Login
+				MultiplayerSessionsTrace::TracePhase(MultiplayerSessionsSubsystem->GetTraceCorrelationId(), TEXT("Travel"), EMultiplayerSessionsTraceEdge::Begin);
+				MULTIPLAYERSESSIONS_TRAVEL_HITCH_SCOPE(ClientTravel);
+				PlayerController->ClientTravel(MultiplayerSessionsSubsystem->BuildTravelURL(Address), ETravelType::TRAVEL_Absolute);
 			}
 		}
 	}
@@ -253,14 +253,34 @@ void UMenu::OnJoinSession(EOnJoinSessionCompleteResult::Type Result)
 	}
 }
 
-void UMenu::OnDestroySession(bool bWasSuccessful)
+void UMenu::OnWaitlistPosition(int32 Position)
 {
-
+	if (GEngine)
+	{
+		/// Same key every time, so the position is updated in place
+		GEngine->AddOnScreenDebugMessage(
+			static_cast<uint64>(GetUniqueID()),
+			15.f,
+			FColor::Yellow,
+			FString::Printf(TEXT("Lobby is full, waiting for a slot: %d in line"), Position)
+		);
+	}
 }
 
-void UMenu::OnStartSession(bool bWasSuccessful)
+void UMenu::OnServerBrowserJoinRequested(const FOnlineSessionSearchResult& SessionResult)
 {
-
+	if (MultiplayerSessionsSubsystem)
+	{
+		JoinButton->SetIsEnabled(false);
+		MultiplayerSessionsSubsystem->JoinSessionAsync(SessionResult, CancellationToken)
+			.Next([WeakThis = TWeakObjectPtr<UMenu>(this)](const FJoinSessionResult& Result)
+			{
+				if (WeakThis.IsValid() && !Result.bWasCanceled)
+				{
+					WeakThis->OnJoinSession(Result.Result);
+				}
+			});
+	}
 }
 
 void UMenu::HostButtonClicked()
@@ -279,9 +299,19 @@ void UMenu::HostButtonClicked()
 	/// Check if the multiplayer session subsystem is valid
 	if (MultiplayerSessionsSubsystem)
 	{
+		/// Start a new trace correlation id; every phase of this host is tagged with it
+		MultiplayerSessionsSubsystem->BeginTraceCorrelation(TEXT("HostButtonClicked"));
 		/// Create a new session, set the match type, and set the max number of players
-		MultiplayerSessionsSubsystem->CreateSession(NumPublicConnections, MatchType);
-		
+		CancellationToken = FSessionCancellationToken();
+		MultiplayerSessionsSubsystem->CreateSessionAsync(NumPublicConnections, MatchType, CancellationToken)
+			.Next([WeakThis = TWeakObjectPtr<UMenu>(this)](const FCreateSessionResult& Result)
+			{
+				if (WeakThis.IsValid() && !Result.bWasCanceled)
+				{
+					WeakThis->OnCreateSession(Result.bWasSuccessful);
+				}
+			});
+
 	}
 }
 
@@ -299,13 +329,60 @@ void UMenu::JoinButtonClicked()
 	JoinButton->SetIsEnabled(false);
 	if (MultiplayerSessionsSubsystem)
 	{
+		/// Start a new trace correlation id; every phase of this join is tagged with it
+		MultiplayerSessionsSubsystem->BeginTraceCorrelation(TEXT("JoinButtonClicked"));
 		/// Find a session, set the max number of players, and set the match type
-		MultiplayerSessionsSubsystem->FindSessions(10000);
+		/// The join that follows, if any, goes on the same token
+		CancellationToken = FSessionCancellationToken();
+		/// Hosts from earlier runs fill the browser right away; the search replaces them when it comes back
+		if (ServerBrowser && !ServerBrowser->HasSearchResults())
+		{
+			const TSharedRef<FSessionResultStore> RecentHosts = MultiplayerSessionsSubsystem->GetRecentHostResults();
+			if (RecentHosts->Num() > 0)
+			{
+				ServerBrowser->SetSearchResults(RecentHosts);
+			}
+		}
+		/// Without a browser the player doesn't pick; matchmaking widens its search until it finds a session to join
+		if (!ServerBrowser && FMatchmakingStage::IsEnabled())
+		{
+			MultiplayerSessionsSubsystem->MatchmakeAsync(MatchType, CancellationToken)
+				.Next([WeakThis = TWeakObjectPtr<UMenu>(this)](const FJoinSessionResult& Result)
+				{
+					if (WeakThis.IsValid() && !Result.bWasCanceled)
+					{
+						WeakThis->OnJoinSession(Result.Result);
+					}
+				});
+			return;
+		}
+		/// The server browser lists every match type, otherwise only ours is worth getting back
+		MultiplayerSessionsSubsystem->FindSessionsAsync(10000, ServerBrowser ? FString() : MatchType, CancellationToken)
+			.Next([WeakThis = TWeakObjectPtr<UMenu>(this)](const FFindSessionsResult& Result)
+			{
+				if (WeakThis.IsValid() && !Result.bWasCanceled)
+				{
+					WeakThis->OnFindSessions(Result.SearchResults, Result.bWasSuccessful);
+				}
+			});
 	}
 }
 
 void UMenu::MenuTearDown()
 {
+	CancellationToken.Cancel();
+
+	/// Nobody looks at the search results once the menu is gone
+	if (ServerBrowser)
+	{
+		ServerBrowser->ClearSearchResults();
+	}
+	if (MultiplayerSessionsSubsystem)
+	{
+		MultiplayerSessionsSubsystem->ReleaseSearchResults();
+		MultiplayerSessionsSubsystem->MultiplayerOnWaitlistPosition.RemoveAll(this);
+	}
+
 	RemoveFromParent();
 	UWorld* World = GetWorld();
 	if (World)
@@ -0,0 +1,103 @@
+/// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MenuHUD.h"
+#include "Menu.h"
+#include "MultiplayerSessions.h"
+#include "Engine/AssetManager.h"
+#include "Engine/GameViewportClient.h"
+#include "Engine/StreamableManager.h"
+#include "GameFramework/PlayerController.h"
+#include "Widgets/Layout/SBox.h"
+#include "Widgets/Text/STextBlock.h"
+
+AMenuHUD::AMenuHUD()
+{
+	MenuWidgetClass = TSoftClassPtr<UMenu>(FSoftObjectPath(TEXT("/MultiplayerSessions/WPB_Menu.WPB_Menu_C")));
+	PlaceholderText = FText::FromString(TEXT("Loading..."));
+}
+
+void AMenuHUD::BeginPlay()
+{
+	Super::BeginPlay();
+
+	/// Only the local player's HUD shows a menu
+	if (GetOwningPlayerController() == nullptr || !GetOwningPlayerController()->IsLocalController() || MenuWidgetClass.IsNull())
+	{
+		return;
+	}
+
+	ShowPlaceholder();
+
+	MenuWidgetClassLoadStartTime = FPlatformTime::Seconds();
+	MenuWidgetClassHandle = UAssetManager::GetStreamableManager().RequestAsyncLoad(
+		MenuWidgetClass.ToSoftObjectPath(),
+		FStreamableDelegate::CreateUObject(this, &ThisClass::OnMenuWidgetClassLoaded),
+		FStreamableManager::AsyncLoadHighPriority);
+}
+
+void AMenuHUD::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (MenuWidgetClassHandle.IsValid())
+	{
+		MenuWidgetClassHandle->CancelHandle();
+		MenuWidgetClassHandle.Reset();
+	}
+	HidePlaceholder();
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void AMenuHUD::OnMenuWidgetClassLoaded()
+{
+	MenuWidgetClassHandle.Reset();
+	HidePlaceholder();
+
+	UClass* LoadedClass = MenuWidgetClass.Get();
+	UMenu* Menu = LoadedClass ? CreateWidget<UMenu>(GetOwningPlayerController(), LoadedClass) : nullptr;
+	if (Menu == nullptr)
+	{
+		UE_LOG(LogMultiplayerSessions, Error, TEXT("Could not load menu widget %s"), *MenuWidgetClass.ToString());
+		return;
+	}
+
+	Menu->MenuSetup(NumPublicConnections, MatchType, LobbyPath);
+
+	/// GStartTime is taken when the process starts, so this is the cold start time on the first run of the menu map
+	const double Now = FPlatformTime::Seconds();
+	UE_LOG(LogMultiplayerSessions, Display, TEXT("Menu interactive %.2f s after process start (menu widget loaded in %.1f ms)"),
+		Now - GStartTime, (Now - MenuWidgetClassLoadStartTime) * 1000.0);
+}
+
+void AMenuHUD::ShowPlaceholder()
+{
+	UGameViewportClient* ViewportClient = GetWorld()->GetGameViewport();
+	if (ViewportClient == nullptr)
+	{
+		return;
+	}
+
+	/// Plain Slate, so showing it doesn't wait on any asset
+	Placeholder = SNew(SBox)
+		.HAlign(HAlign_Center)
+		.VAlign(VAlign_Center)
+		[
+			SNew(STextBlock)
+			.Text(PlaceholderText)
+		];
+	ViewportClient->AddViewportWidgetContent(Placeholder.ToSharedRef());
+}
+
+void AMenuHUD::HidePlaceholder()
+{
+	if (!Placeholder.IsValid())
+	{
+		return;
+	}
+
+	if (UGameViewportClient* ViewportClient = GetWorld()->GetGameViewport())
+	{
+		ViewportClient->RemoveViewportWidgetContent(Placeholder.ToSharedRef());
+	}
+	Placeholder.Reset();
+}
@@ -1,9 +1,13 @@
 // Copyright Epic Games, Inc. All Rights Reserved.
 
 #include "MultiplayerSessions.h"
+#include "MultiplayerSessionsTelemetry.h"
+#include "RecentHostsCache.h"
 
 #define LOCTEXT_NAMESPACE "FMultiplayerSessionsModule"
 
+DEFINE_LOG_CATEGORY(LogMultiplayerSessions);
+
 void FMultiplayerSessionsModule::StartupModule()
 {
 	// This code will execute after your module is loaded into memory; the exact timing is specified in the .uplugin file per-module
@@ -13,6 +17,10 @@ void FMultiplayerSessionsModule::ShutdownModule()
 {
 	// This function may be called during shutdown to clean up your module.  For modules that support dynamic reloading,
 	// we call this function before unloading the module.
+
+	/// Time-to-lobby records still being appended would otherwise be lost on exit
+	FMultiplayerSessionsTelemetry::Get().Flush();
+	FRecentHostsCache::Get().Flush();
 }
 
 #undef LOCTEXT_NAMESPACE
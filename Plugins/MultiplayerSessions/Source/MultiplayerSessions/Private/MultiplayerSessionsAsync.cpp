@@ -0,0 +1,34 @@
+/// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MultiplayerSessionsAsync.h"
+
+FSessionCancellationToken::FSessionCancellationToken():
+	State(MakeShared<FState>())
+{
+}
+
+void FSessionCancellationToken::Cancel()
+{
+	if (State->bCanceled)
+	{
+		return;
+	}
+
+	State->bCanceled = true;
+	TArray<TFunction<void()>> Callbacks = MoveTemp(State->Callbacks);
+	for (TFunction<void()>& Callback : Callbacks)
+	{
+		Callback();
+	}
+}
+
+void FSessionCancellationToken::OnCanceled(TFunction<void()> Callback)
+{
+	if (State->bCanceled)
+	{
+		Callback();
+		return;
+	}
+	State->Callbacks.Add(MoveTemp(Callback));
+}
@@ -0,0 +1,188 @@
+/// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MultiplayerSessionsHitchWatchdog.h"
+#include "MultiplayerSessions.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformStackWalk.h"
+#include "UObject/Class.h"
+
+namespace MultiplayerSessionsHitchWatchdog
+{
+	static int32 bEnabled = 1;
+	static FAutoConsoleVariableRef CVarEnabled(
+		TEXT("MultiplayerSessions.HitchWatchdog.Enable"),
+		bEnabled,
+		TEXT("Time session callbacks, their listeners and travel on the game thread, and log the ones over budget."));
+
+	static float BudgetMs = 4.f;
+	static FAutoConsoleVariableRef CVarBudgetMs(
+		TEXT("MultiplayerSessions.HitchWatchdog.BudgetMs"),
+		BudgetMs,
+		TEXT("Game thread milliseconds a session callback or listener may take before it is reported."));
+
+	static float TravelBudgetMs = 16.f;
+	static FAutoConsoleVariableRef CVarTravelBudgetMs(
+		TEXT("MultiplayerSessions.HitchWatchdog.TravelBudgetMs"),
+		TravelBudgetMs,
+		TEXT("Game thread milliseconds a ServerTravel/ClientTravel call may take before it is reported."));
+
+	static float LoadMapBudgetMs = 1000.f;
+	static FAutoConsoleVariableRef CVarLoadMapBudgetMs(
+		TEXT("MultiplayerSessions.HitchWatchdog.LoadMapBudgetMs"),
+		LoadMapBudgetMs,
+		TEXT("Game thread milliseconds the map load a travel hands off to (PreLoadMap to PostLoadMapWithWorld) may take before it is reported."));
+
+	static float CallstackCooldown = 10.f;
+	static FAutoConsoleVariableRef CVarCallstackCooldown(
+		TEXT("MultiplayerSessions.HitchWatchdog.CallstackCooldown"),
+		CallstackCooldown,
+		TEXT("Seconds before the same call's callstack is captured again; walking the stack is the expensive part of a report. Negative never captures."));
+
+	/// Every call that went over budget
+	struct FHitchStats
+	{
+		int32 Count{ 0 };
+		double TotalMs{ 0.0 };
+		double MaxMs{ 0.0 };
+		double LastCallstackTime{ -DBL_MAX };
+	};
+	static TMap<FString, FHitchStats> Stats;
+
+	static const TCHAR* LexToString(ECategory Category)
+	{
+		switch (Category)
+		{
+		case ECategory::Callback: return TEXT("Callback");
+		case ECategory::Listener: return TEXT("Listener");
+		case ECategory::Travel: return TEXT("Travel");
+		case ECategory::LoadMap: return TEXT("LoadMap");
+		}
+		return TEXT("Unknown");
+	}
+
+	static float GetBudgetMs(ECategory Category)
+	{
+		switch (Category)
+		{
+		case ECategory::Travel: return TravelBudgetMs;
+		case ECategory::LoadMap: return LoadMapBudgetMs;
+		default: return BudgetMs;
+		}
+	}
+
+	/// The travel whose map load is coming up or running, see BeginTravel
+	static const TCHAR* TravelName{ nullptr };
+	static uint64 LoadMapStartCycles{ 0 };
+
+	static void Report(ECategory Category, const TCHAR* Name, double ElapsedMs, const FString& Listeners)
+	{
+		FHitchStats& HitchStats = Stats.FindOrAdd(FString::Printf(TEXT("%s %s"), LexToString(Category), Name));
+		++HitchStats.Count;
+		HitchStats.TotalMs += ElapsedMs;
+		HitchStats.MaxMs = FMath::Max(HitchStats.MaxMs, ElapsedMs);
+
+		UE_LOG(LogMultiplayerSessions, Warning, TEXT("Hitch: %s %s took %.2f ms (budget %.2f ms)%s%s"), LexToString(Category), Name, ElapsedMs,
+			GetBudgetMs(Category), Listeners.IsEmpty() ? TEXT("") : TEXT(", listeners: "), *Listeners);
+
+		const double Now = FPlatformTime::Seconds();
+		if (CallstackCooldown < 0.f || Now - HitchStats.LastCallstackTime < CallstackCooldown)
+		{
+			return;
+		}
+		HitchStats.LastCallstackTime = Now;
+
+		/// The stack at the end of the scope still shows who made the call; the watchdog's own frames are skipped
+		const SIZE_T CallstackSize = 16 * 1024;
+		ANSICHAR* Callstack = static_cast<ANSICHAR*>(FMemory::SystemMalloc(CallstackSize));
+		if (Callstack)
+		{
+			Callstack[0] = 0;
+			FPlatformStackWalk::StackWalkAndDump(Callstack, CallstackSize, 3);
+			UE_LOG(LogMultiplayerSessions, Warning, TEXT("Hitch: %s %s called from\n%s"), LexToString(Category), Name, ANSI_TO_TCHAR(Callstack));
+			FMemory::SystemFree(Callstack);
+		}
+	}
+
+	static FAutoConsoleCommand CmdReport(
+		TEXT("MultiplayerSessions.HitchWatchdog.Report"),
+		TEXT("Logs every session callback, listener, travel and map load that went over its budget, worst first."),
+		FConsoleCommandDelegate::CreateLambda([]()
+		{
+			if (Stats.Num() == 0)
+			{
+				UE_LOG(LogMultiplayerSessions, Display, TEXT("Hitch watchdog: nothing went over budget"));
+				return;
+			}
+
+			Stats.ValueSort([](const FHitchStats& A, const FHitchStats& B) { return A.MaxMs > B.MaxMs; });
+			for (const TPair<FString, FHitchStats>& Entry : Stats)
+			{
+				UE_LOG(LogMultiplayerSessions, Display, TEXT("Hitch watchdog: %-50s %4d over budget, %8.2f ms average, %8.2f ms max"),
+					*Entry.Key, Entry.Value.Count, Entry.Value.TotalMs / Entry.Value.Count, Entry.Value.MaxMs);
+			}
+		}));
+
+	bool IsEnabled()
+	{
+		return bEnabled != 0;
+	}
+
+	static double GetElapsedMsOverBudget(ECategory Category, uint64 StartCycles)
+	{
+		const double ElapsedMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles);
+		return ElapsedMs > GetBudgetMs(Category) ? ElapsedMs : 0.0;
+	}
+
+	void Check(ECategory Category, const TCHAR* Name, uint64 StartCycles)
+	{
+		const double ElapsedMs = GetElapsedMsOverBudget(Category, StartCycles);
+		if (ElapsedMs > 0.0)
+		{
+			Report(Category, Name, ElapsedMs, FString());
+		}
+	}
+
+	void Check(ECategory Category, const TCHAR* Name, uint64 StartCycles, TFunctionRef<FString()> DescribeListeners)
+	{
+		const double ElapsedMs = GetElapsedMsOverBudget(Category, StartCycles);
+		if (ElapsedMs > 0.0)
+		{
+			Report(Category, Name, ElapsedMs, DescribeListeners());
+		}
+	}
+
+	void BeginTravel(const TCHAR* Name)
+	{
+		TravelName = Name;
+	}
+
+	void BeginLoadMap()
+	{
+		/// Connecting to a host before the load isn't game thread time, so the clock starts with the load
+		LoadMapStartCycles = IsEnabled() ? FPlatformTime::Cycles64() : 0;
+	}
+
+	void EndLoadMap()
+	{
+		if (LoadMapStartCycles != 0)
+		{
+			Check(ECategory::LoadMap, TravelName ? TravelName : TEXT("LoadMap"), LoadMapStartCycles);
+		}
+		LoadMapStartCycles = 0;
+		TravelName = nullptr;
+	}
+
+	FString DescribeObjects(const TArray<UObject*>& Objects)
+	{
+		FString Description;
+		for (const UObject* Object : Objects)
+		{
+			if (Object)
+			{
+				Description += FString::Printf(TEXT("%s%s %s"), Description.IsEmpty() ? TEXT("") : TEXT(", "), *Object->GetClass()->GetName(), *Object->GetName());
+			}
+		}
+		return Description.IsEmpty() ? FString(TEXT("none bound")) : Description;
+	}
+}
@@ -4,6 +4,162 @@
 #include "MultiplayerSessionsSubsystem.h"
 #include "OnlineSubsystem.h"
 #include "OnlineSessionSettings.h"
+#include "MultiplayerSessionsTrace.h"
+#include "MultiplayerSessionsTelemetry.h"
+#include "MultiplayerSessionsHitchWatchdog.h"
+#include "LobbyReservationBeaconClient.h"
+#include "SessionQosProber.h"
+#include "RecentHostsCache.h"
+#include "OnlineBeaconHost.h"
+#include "UObject/UObjectGlobals.h"
+#include "MultiplayerSessions.h"
+#include "HAL/IConsoleManager.h"
+#include "Engine/Engine.h"
+#include "Engine/GameInstance.h"
+#include "Engine/LocalPlayer.h"
+#include "Engine/NetDriver.h"
+#include "Engine/NetConnection.h"
+#include "TimerManager.h"
+#include "Tasks/Task.h"
+#include "Async/Async.h"
+
+namespace MultiplayerSessionsReservation
+{
+	static int32 bEnabled = 1;
+	static FAutoConsoleVariableRef CVarEnabled(
+		TEXT("MultiplayerSessions.Reservations.Enable"),
+		bEnabled,
+		TEXT("Reserve a slot with the host's reservation beacon before joining its session and traveling."));
+
+	static int32 bWaitIfFull = 1;
+	static FAutoConsoleVariableRef CVarWaitIfFull(
+		TEXT("MultiplayerSessions.Reservations.WaitIfFull"),
+		bWaitIfFull,
+		TEXT("When the host is full, wait in its waitlist for a slot instead of failing the join with SessionIsFull."));
+}
+
+namespace MultiplayerSessionsJoin
+{
+	static float Timeout = 20.f;
+	static FAutoConsoleVariableRef CVarTimeout(
+		TEXT("MultiplayerSessions.Join.Timeout"),
+		Timeout,
+		TEXT("Seconds the online subsystem's join may take before it is given up and the session is treated as gone. 0 waits forever."));
+}
+
+namespace MultiplayerSessionsSearch
+{
+	static int32 bAsyncProcessing = 1;
+	static FAutoConsoleVariableRef CVarAsyncProcessing(
+		TEXT("MultiplayerSessions.Search.AsyncProcessing"),
+		bAsyncProcessing,
+		TEXT("Filter, deduplicate, rank and compact search results on a worker thread instead of in the backend's callback on the game thread."));
+}
+
+namespace MultiplayerSessionsMatchmaking
+{
+	static float RequeryInterval = 2.f;
+	static FAutoConsoleVariableRef CVarRequeryInterval(
+		TEXT("MultiplayerSessions.Matchmaking.RequeryInterval"),
+		RequeryInterval,
+		TEXT("Seconds between the searches of a matchmaking stage; a stage without time left for another search hands over to the next right away."));
+}
+
+namespace MultiplayerSessionsQos
+{
+	static int32 bEnabled = 1;
+	static FAutoConsoleVariableRef CVarEnabled(
+		TEXT("MultiplayerSessions.Qos.Enable"),
+		bEnabled,
+		TEXT("QoS probe the best candidates before JoinBestSession picks one."));
+
+	static int32 NumCandidates = 4;
+	static FAutoConsoleVariableRef CVarNumCandidates(
+		TEXT("MultiplayerSessions.Qos.NumCandidates"),
+		NumCandidates,
+		TEXT("How many of the best search results (by search ping) are probed."));
+
+	static int32 SocketBudget = 2;
+	static FAutoConsoleVariableRef CVarSocketBudget(
+		TEXT("MultiplayerSessions.Qos.SocketBudget"),
+		SocketBudget,
+		TEXT("Most UDP sockets a probe opens, however many candidates it has."));
+
+	static float WindowSeconds = 0.5f;
+	static FAutoConsoleVariableRef CVarWindowSeconds(
+		TEXT("MultiplayerSessions.Qos.WindowSeconds"),
+		WindowSeconds,
+		TEXT("How long a probe waits for answers before joining with what it has."));
+}
+
+namespace MultiplayerSessionsHostMigration
+{
+	static int32 bEnabled = 1;
+	static FAutoConsoleVariableRef CVarEnabled(
+		TEXT("MultiplayerSessions.HostMigration.Enable"),
+		bEnabled,
+		TEXT("When a listen-server host goes away, hand the lobby to the next player instead of dropping everyone."));
+
+	static float FollowDelay = 2.f;
+	static FAutoConsoleVariableRef CVarFollowDelay(
+		TEXT("MultiplayerSessions.HostMigration.FollowDelay"),
+		FollowDelay,
+		TEXT("Seconds a follower waits before its first attempt to connect to the successor, and between attempts."));
+
+	static float SuccessorTimeout = 15.f;
+	static FAutoConsoleVariableRef CVarSuccessorTimeout(
+		TEXT("MultiplayerSessions.HostMigration.SuccessorTimeout"),
+		SuccessorTimeout,
+		TEXT("Seconds followers keep trying a successor before moving on to the next one in the list."));
+
+	/// Downtime of every migration this process took part in
+	static int32 NumSucceeded = 0;
+	static int32 NumFailed = 0;
+	static double TotalDowntime = 0.0;
+	static double MaxDowntime = 0.0;
+
+	static FAutoConsoleCommand CmdReport(
+		TEXT("MultiplayerSessions.HostMigration.Report"),
+		TEXT("Logs how many host migrations this process went through and how long the lobby was down for."),
+		FConsoleCommandDelegate::CreateLambda([]()
+		{
+			UE_LOG(LogMultiplayerSessions, Display, TEXT("Host migration: %d succeeded, %d failed, downtime %.0f ms total, %.0f ms average, %.0f ms max"),
+				NumSucceeded, NumFailed, TotalDowntime * 1000.0,
+				NumSucceeded + NumFailed > 0 ? TotalDowntime * 1000.0 / (NumSucceeded + NumFailed) : 0.0, MaxDowntime * 1000.0);
+		}));
+}
+
+namespace MultiplayerSessionsOnlineStartup
+{
+	/// Time spent setting up online services, in the order it happened
+	static TArray<TPair<FString, double>> Timings;
+
+	static void Record(const FString& Step, double Seconds)
+	{
+		Timings.Emplace(Step, Seconds);
+		UE_LOG(LogMultiplayerSessions, Log, TEXT("Online startup: %s took %.2f ms"), *Step, Seconds * 1000.0);
+	}
+
+	static FAutoConsoleCommand CmdReport(
+		TEXT("MultiplayerSessions.OnlineStartupReport"),
+		TEXT("Logs how long each step of the online setup took (creating the online subsystem, getting its session interface)."),
+		FConsoleCommandDelegate::CreateLambda([]()
+		{
+			if (Timings.Num() == 0)
+			{
+				UE_LOG(LogMultiplayerSessions, Display, TEXT("Online startup: nothing set up yet, no session has been used"));
+				return;
+			}
+
+			double TotalSeconds = 0.0;
+			for (const TPair<FString, double>& Timing : Timings)
+			{
+				UE_LOG(LogMultiplayerSessions, Display, TEXT("Online startup: %-40s %8.2f ms"), *Timing.Key, Timing.Value * 1000.0);
+				TotalSeconds += Timing.Value;
+			}
+			UE_LOG(LogMultiplayerSessions, Display, TEXT("Online startup: %-40s %8.2f ms"), TEXT("Total"), TotalSeconds * 1000.0);
+		}));
+}
 
 UMultiplayerSessionsSubsystem::UMultiplayerSessionsSubsystem():
 
@@ -30,29 +186,114 @@ UMultiplayerSessionsSubsystem::UMultiplayerSessionsSubsystem():
 	/// create a delegate object that will be used to bind the callback function to the delegate, using the CreateUObject function to create a new instance of the delegate object
 	StartSessionCompleteDelegate(FOnStartSessionCompleteDelegate::CreateUObject(this, &ThisClass::OnStartSessionComplete))
 {
+	/// The session interface is not touched here: the constructor also runs for the CDO at module load,
+	/// and getting the interface creates the online subsystem (e.g. initializes Steam). See ResolveSessionInterface.
+}
+
+
+bool UMultiplayerSessionsSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	return !IsRunningCommandlet() && Super::ShouldCreateSubsystem(Outer);
+}
+
+
+bool UMultiplayerSessionsSubsystem::ResolveSessionInterface() const
+{
+	if (bSessionInterfaceResolved)
+	{
+		return SessionInterface.IsValid();
+	}
+	bSessionInterfaceResolved = true;
+
+	MULTIPLAYERSESSIONS_TRACE_SCOPE(MultiplayerSessions_ResolveSessionInterface);
+
 	/// Access the OnlineSubsystem using the getter function, then check if the OnlineSubsystem is Valid
-	/// If OnlineSubsystem is Valid, access the OnlineSubsystem Interface
+	/// The first call creates the default online subsystem, which is where most of the online startup cost is
+	double StartTime = FPlatformTime::Seconds();
 	IOnlineSubsystem* Subsystem = IOnlineSubsystem::Get();
-	
+	MultiplayerSessionsOnlineStartup::Record(
+		FString::Printf(TEXT("Online subsystem %s"), Subsystem ? *Subsystem->GetSubsystemName().ToString() : TEXT("(none)")),
+		FPlatformTime::Seconds() - StartTime);
+
 	/// If the OnlineSubsystem is valid, then we can use the interface
 	if (Subsystem)
 	{
 		/// Get the Interface to the OnlineSessionInterface
 		/// The OnlineSessionInterface is used to create, join, and destroy sessions
 		/// We can access get SessionInterface and store it in our SessionInterface pointer
+		StartTime = FPlatformTime::Seconds();
 		SessionInterface = Subsystem->GetSessionInterface();
+		MultiplayerSessionsOnlineStartup::Record(TEXT("Session interface"), FPlatformTime::Seconds() - StartTime);
+
+		bIsLANBackend = Subsystem->GetSubsystemName() == NULL_SUBSYSTEM;
+	}
+
+	return SessionInterface.IsValid();
+}
+
+
+void UMultiplayerSessionsSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	/// The subsystem lives for the whole game instance, so it sees the map load at the end of every host/join
+	PreLoadMapHandle = FCoreUObjectDelegates::PreLoadMap.AddUObject(this, &ThisClass::OnPreLoadMap);
+	PostLoadMapHandle = FCoreUObjectDelegates::PostLoadMapWithWorld.AddUObject(this, &ThisClass::OnPostLoadMapWithWorld);
+
+	if (GEngine)
+	{
+		NetworkFailureHandle = GEngine->OnNetworkFailure().AddUObject(this, &ThisClass::OnNetworkFailure);
+		TravelFailureHandle = GEngine->OnTravelFailure().AddUObject(this, &ThisClass::OnTravelFailure);
+	}
+
+	/// Mapped, not read, so it costs next to nothing at startup
+	if (FRecentHostsCache::IsEnabled())
+	{
+		FRecentHostsCache::Get().Load();
+	}
+}
+
+
+void UMultiplayerSessionsSubsystem::Deinitialize()
+{
+	FCoreUObjectDelegates::PreLoadMap.Remove(PreLoadMapHandle);
+	FCoreUObjectDelegates::PostLoadMapWithWorld.Remove(PostLoadMapHandle);
+	if (GEngine)
+	{
+		GEngine->OnNetworkFailure().Remove(NetworkFailureHandle);
+		GEngine->OnTravelFailure().Remove(TravelFailureHandle);
 	}
+	StopMatchmaking(false, true);
+	QosProber.Reset();
+	RecentHostsProber.Reset();
+
+	/// Nothing will answer them anymore
+	PendingCreateSession.Complete(FCreateSessionResult());
+	PendingFindSessions.Complete(FFindSessionsResult());
+	PendingJoinSession.Complete(FJoinSessionResult());
+	PendingDestroySession.Complete(FDestroySessionResult());
+
+	Super::Deinitialize();
 }
 
 
 void UMultiplayerSessionsSubsystem::CreateSession(int32 NumPublicConnections, FString MatchType)
 {
+	MULTIPLAYERSESSIONS_TRACE_SCOPE(MultiplayerSessions_CreateSession);
+
 	/// Check if the OnlineSubsystem is Valid
-	if (!SessionInterface.IsValid())
+	if (!ResolveSessionInterface())
 	{
 		/// If the OnlineSubsystem is not valid, then we cannot create a session
+		CompleteCreateSession(false);
 		return;
 	}
+
+	/// Session calls made without going through the menu still get an id so their phases line up in Insights
+	if (!TraceCorrelationId.IsValid())
+	{
+		BeginTraceCorrelation(TEXT("CreateSession"));
+	}
 	
 	/// Check if there is already a session in progress with the same name
 	auto ExistingSession = SessionInterface->GetNamedSession(NAME_GameSession);
@@ -64,7 +305,9 @@ void UMultiplayerSessionsSubsystem::CreateSession(int32 NumPublicConnections, FS
 		LastNumPublicConnections = NumPublicConnections;
 		LastMatchType = MatchType;
 
+		/// The create continues in OnDestroySessionComplete; creating now would fail on the session that is still there
 		DestroySession();
+		return;
 	}
 
 	/// Once we create a session, we need to add the CreateSessionCompleteDelegate to the AddOnCreateSessionCompleteDelegate_Handle list
@@ -76,39 +319,95 @@ void UMultiplayerSessionsSubsystem::CreateSession(int32 NumPublicConnections, FS
 	/// Container for all settings describing a single online session
 	LastSessionSettings = MakeShareable(new FOnlineSessionSettings());
 	/// Check if the subsystem is null, then we are on a local machine, so we are using a LAN match
-	LastSessionSettings->bIsLANMatch = IOnlineSubsystem::Get()->GetSubsystemName() == "NULL" ? true : false; 
+	LastSessionSettings->bIsLANMatch = bIsLANBackend;
 	LastSessionSettings->NumPublicConnections = NumPublicConnections; /// Set the number of public connections to the value passed in
 	LastSessionSettings->bAllowJoinInProgress = true; /// Allow players to join sessions that are in progress
 	LastSessionSettings->bAllowJoinViaPresence = true; /// Allow players to join sessions using presence
 	LastSessionSettings->bShouldAdvertise = true; /// Advertise the session to other players
 	LastSessionSettings->bUsesPresence = true; /// Use presence to join sessions
 	LastSessionSettings->bUseLobbiesIfAvailable = true; /// Whether to use lobbies if they are available or not
-	LastSessionSettings->Set(FName("MatchType"), MatchType, EOnlineDataAdvertisementType::ViaOnlineServiceAndPing); /// Set the match type to the value passed in
-	LastSessionSettings->BuildUniqueId = 1; /// Set the build unique id to 1
+	/// Match type, region, build, player counts and lobby state, packed into one integer setting
+	FSessionAttributes Attributes = FSessionAttributes::MakeLocal();
+	if (!LexTryParseString(Attributes.MatchType, *MatchType))
+	{
+		UE_LOG(LogMultiplayerSessions, Warning, TEXT("Unknown match type %s, advertised as %s"), *MatchType, LexToString(Attributes.MatchType));
+	}
+	Attributes.MaxPlayers = static_cast<uint8>(FMath::Clamp(NumPublicConnections, 0, static_cast<int32>(MAX_uint8)));
+	Attributes.NumPlayers = 1;
+	Attributes.LobbyState = ESessionLobbyState::Waiting;
+	Attributes.Write(*LastSessionSettings);
+	LastSessionSettings->BuildUniqueId = MultiplayerSessionsSchema::GetBuildUniqueId();
+	/// Advertise the reservation beacon port, so clients can reserve a slot before they travel
+	LastSessionSettings->Set(SETTING_BEACONPORT, GetDefault<AOnlineBeaconHost>()->ListenPort, EOnlineDataAdvertisementType::ViaOnlineService);
+	LastSessionSettings->Set(FSessionQosProber::PortSettingKey, FSessionQosResponder::GetConfiguredPort(), EOnlineDataAdvertisementType::ViaOnlineService);
 
 	const ULocalPlayer* LocalPlayer = GetWorld()->GetFirstLocalPlayerFromController(); /// Get the first local player from the controller
 	
 	/// Check if create session is successful, if it's not successful, then we will clear the delegate handle from the list
+	MultiplayerSessionsTrace::TracePhase(TraceCorrelationId, TEXT("CreateSession"), EMultiplayerSessionsTraceEdge::Begin);
 	if (!SessionInterface->CreateSession(*LocalPlayer->GetPreferredUniqueNetId(), NAME_GameSession, *LastSessionSettings))
 	{
 		SessionInterface->ClearOnCreateSessionCompleteDelegate_Handle(CreateSessionCompleteDelegateHandle);
+		MultiplayerSessionsTrace::TracePhase(TraceCorrelationId, TEXT("CreateSession"), EMultiplayerSessionsTraceEdge::End);
 
 		/// Broadcast our own custom delegate
 		/// Broadcast the OnCreateSessionComplete delegate, passing in false because the session was not created
-		MultiplayerOnCreateSessionComplete.Broadcast(false);
+		CompleteCreateSession(false);
+	}
+}
+
+
+void UMultiplayerSessionsSubsystem::FindSessions(int32 MaxSearchResults, const FString& MatchType)
+{
+	FSessionAttributeFilter Filter = FSessionAttributeFilter::MakeCompatible();
+	if (!MatchType.IsEmpty())
+	{
+		/// A match type nobody can host would filter for Unknown and find hosts whose match type didn't parse either
+		ESessionMatchType TypedMatchType;
+		if (!LexTryParseString(TypedMatchType, *MatchType))
+		{
+			UE_LOG(LogMultiplayerSessions, Warning, TEXT("FindSessions: unknown match type \"%s\""), *MatchType);
+			CompleteFindSessions(MakeShared<FSessionResultStore>(), false);
+			return;
+		}
+		Filter.WithMatchType(TypedMatchType);
+	}
+	FindSessions(MaxSearchResults, Filter);
+}
+
+
+void UMultiplayerSessionsSubsystem::FindSessions(int32 MaxSearchResults, const FSessionAttributeFilter& Filter)
+{
+	/// The caller's own search replaces the one matchmaking would have made
+	if (IsMatchmaking())
+	{
+		StopMatchmaking(false, true);
+		CompleteJoinSession(EOnJoinSessionCompleteResult::UnknownError);
 	}
+	StartSessionSearch(MaxSearchResults, Filter, false);
 }
 
 
-void UMultiplayerSessionsSubsystem::FindSessions(int32 MaxSearchResults)
+void UMultiplayerSessionsSubsystem::StartSessionSearch(int32 MaxSearchResults, const FSessionAttributeFilter& Filter, bool bForMatchmaking)
 {
+	MULTIPLAYERSESSIONS_TRACE_SCOPE(MultiplayerSessions_FindSessions);
+
+	bMatchmakingSearch = bForMatchmaking;
+
 	///** Find game sessions **///
 
 	/// Check if the OnlineSessionInterface is valid, if not return out of the function
-	if (!SessionInterface.IsValid())
+	if (!ResolveSessionInterface())
 	{
+		CompleteFindSessions(MakeShared<FSessionResultStore>(), false);
 		return;
 	}
+
+	/// Session calls made without going through the menu still get an id so their phases line up in Insights
+	if (!TraceCorrelationId.IsValid())
+	{
+		BeginTraceCorrelation(TEXT("FindSessions"));
+	}
 	
 	/// Add the FindSessionsCompleteDelegate to the OnlineSessionInterface using the AddOnFindSessionsCompleteDelegate_Handle list
 	/// When the session is found, the OnFindSessionsComplete function will be called, which is bound the OnFindSessionsCompleteDelegate
@@ -116,23 +415,46 @@ void UMultiplayerSessionsSubsystem::FindSessions(int32 MaxSearchResults)
 
 	/// Setup session search settings which are required to find a session and call the session interface function FindSessions
 	/// We will use the FOnlineSessionSearch as a TSharedPtr to store the online session search settings
+	/// The previous search's results are replaced, don't hold both while this one comes in
+	ReleaseSearchResults();
 	LastSessionSearch = MakeShareable(new FOnlineSessionSearch());
+	LastSearchFilter = Filter;
+	++SearchSerial;
+
+	/// The recent hosts the browser is showing get measured while the backend searches
+	PreProbeRecentHosts();
 
 	/// Set the search settings
 	LastSessionSearch->MaxSearchResults = MaxSearchResults;
 	/// Check if the subsystem is null, then we are on a local machine, so we are using a LAN match
-	LastSessionSearch->bIsLanQuery = IOnlineSubsystem::Get()->GetSubsystemName() == "NULL" ? true : false; 
+	LastSessionSearch->bIsLanQuery = bIsLANBackend;
 	/// Set QuerySettings to make sure we only search for sessions using presence
 	LastSessionSearch->QuerySettings.Set(SEARCH_PRESENCE, true, EOnlineComparisonOp::Equals);
 
+	/// Let the backend drop the other match types (and regions) instead of returning them to be filtered here
+	FName QueryKey;
+	int64 QueryValue = 0;
+	if (Filter.GetQuerySetting(QueryKey, QueryValue))
+	{
+		LastSessionSearch->QuerySettings.Set(QueryKey, QueryValue, EOnlineComparisonOp::Equals);
+	}
+
+	/// Matchmaking never joins a full lobby, so it doesn't need them back
+	if (bForMatchmaking)
+	{
+		LastSessionSearch->QuerySettings.Set(SEARCH_MINSLOTSAVAILABLE, 1, EOnlineComparisonOp::GreaterThanEquals);
+	}
+
 	/// Get the LocalPlayer by using GetWorld() and then GetFirstLocalPlayerController()
 	/// This will return the first local player controller, which we can then access the GetPrefferedUniqueNetId function on to pass to the FindSessions function
 	const ULocalPlayer* LocalPlayer = GetWorld()->GetFirstLocalPlayerFromController();
 
 	/// Call the FindSessions function on the OnlineSessionInterface, passing in the FUniqueNetId and the SessionSearch TSharedPtr
 	/// This will return a list of sessions that match the search settings we set earlier
+	MultiplayerSessionsTrace::TracePhase(TraceCorrelationId, TEXT("FindSessions"), EMultiplayerSessionsTraceEdge::Begin);
 	if (!SessionInterface->FindSessions(*LocalPlayer->GetPreferredUniqueNetId(), LastSessionSearch.ToSharedRef()))
 	{
+		MultiplayerSessionsTrace::TracePhase(TraceCorrelationId, TEXT("FindSessions"), EMultiplayerSessionsTraceEdge::End);
 		//if (GEngine)
 		//{
 		//	GEngine->AddOnScreenDebugMessage(
@@ -146,24 +468,276 @@ void UMultiplayerSessionsSubsystem::FindSessions(int32 MaxSearchResults)
 		SessionInterface->ClearOnFindSessionsCompleteDelegate_Handle(FindSessionsCompleteDelegateHandle);
 
 		/// Broadcast our own custom delegate
-		/// Passing in an empty TArray of type FOnlineSessionSearchResult and false because the session was not found
-		MultiplayerOnFindSessionsComplete.Broadcast(TArray<FOnlineSessionSearchResult>(), false);
+		/// Passing in an empty result store and false because the session was not found
+		CompleteFindSessions(MakeShared<FSessionResultStore>(), false);
 	}
 	
 }
 
 
-void UMultiplayerSessionsSubsystem::JoinSession(const FOnlineSessionSearchResult& SessionResult)
+void UMultiplayerSessionsSubsystem::JoinSession(const FOnlineSessionSearchResult& SessionResult, int32 NumReservedSlots)
+{
+	/// A plain join brings nobody along
+	StopMatchmaking(false, true);
+	PendingPartyMembers.Reset();
+	ReserveAndJoinSession(SessionResult, NumReservedSlots);
+}
+
+
+void UMultiplayerSessionsSubsystem::JoinSessionWithParty(const FOnlineSessionSearchResult& SessionResult, const TArray<FUniqueNetIdRef>& PartyMembers)
+{
+	/// One reservation for the whole party; the members are invited once we are in, see OnJoinSessionComplete
+	StopMatchmaking(false, true);
+	PendingPartyMembers = PartyMembers;
+	ReserveAndJoinSession(SessionResult, 1 + PartyMembers.Num());
+}
+
+
+void UMultiplayerSessionsSubsystem::JoinBestSession(const FSessionResultStore& SearchResults, const TArray<int32>& CandidateIndices)
+{
+	if (CandidateIndices.Num() == 0 || (QosProber.IsValid() && QosProber->IsRunning()))
+	{
+		return;
+	}
+	StopMatchmaking(false, true);
+
+	/// Full sessions can't be joined, however close; they are only kept if nothing else is left
+	TArray<int32> SortedIndices = CandidateIndices.FilterByPredicate([&SearchResults](int32 Index)
+	{
+		return SearchResults.GetNumPlayers(Index) < SearchResults.GetMaxPlayers(Index);
+	});
+	if (SortedIndices.Num() == 0)
+	{
+		SortedIndices = CandidateIndices;
+	}
+
+	/// Best search ping first, ties in ranked order; results without one go last
+	SortedIndices.StableSort([&SearchResults](int32 A, int32 B)
+	{
+		auto SortKey = [&SearchResults](int32 Index)
+		{
+			const int32 PingInMs = SearchResults.GetPingInMs(Index);
+			return PingInMs > 0 && PingInMs < MAX_QUERY_PING ? PingInMs : MAX_int32;
+		};
+		return SortKey(A) < SortKey(B);
+	});
+	SortedIndices.SetNum(FMath::Min(SortedIndices.Num(), FMath::Max(MultiplayerSessionsQos::NumCandidates, 1)));
+
+	/// Only the sessions that can be picked are rebuilt in full
+	QosCandidates.Reset();
+	for (const int32 Index : SortedIndices)
+	{
+		QosCandidates.Add(SearchResults.GetSearchResult(Index));
+	}
+
+	if (!MultiplayerSessionsQos::bEnabled || QosCandidates.Num() == 1 || !ResolveSessionInterface())
+	{
+		const FOnlineSessionSearchResult Best = QosCandidates[0];
+		QosCandidates.Reset();
+		JoinSession(Best);
+		return;
+	}
+
+	/// Hosts that don't advertise a responder, or whose address isn't an IP (Steam P2P), get an empty address and no probe
+	TArray<FString> ProbeAddresses;
+	for (const FOnlineSessionSearchResult& Candidate : QosCandidates)
+	{
+		int32 QosPort = 0;
+		FString ConnectString;
+		const bool bCanProbe = Candidate.Session.SessionSettings.Get(FSessionQosProber::PortSettingKey, QosPort)
+			&& GetResolvedConnectString(Candidate, ConnectString);
+		ProbeAddresses.Add(bCanProbe ? FSessionQosProber::MakeProbeAddress(ConnectString, QosPort) : FString());
+	}
+
+	MultiplayerSessionsTrace::TracePhase(TraceCorrelationId, TEXT("QosProbe"), EMultiplayerSessionsTraceEdge::Begin);
+	QosProber = MakeShared<FSessionQosProber>();
+	QosProber->Start(ProbeAddresses, MultiplayerSessionsQos::SocketBudget, MultiplayerSessionsQos::WindowSeconds,
+		FOnSessionQosProbeComplete::CreateUObject(this, &ThisClass::OnQosProbeComplete));
+}
+
+
+void UMultiplayerSessionsSubsystem::OnQosProbeComplete(const TArray<int32>& RttsInMs)
+{
+	MULTIPLAYERSESSIONS_HITCH_SCOPE(Callback, OnQosProbeComplete);
+	MultiplayerSessionsTrace::TracePhase(TraceCorrelationId, TEXT("QosProbe"), EMultiplayerSessionsTraceEdge::End);
+
+	/// Candidates are in search ping order, so with no answers at all the first one is still the best guess
+	int32 BestIndex = 0;
+	int32 BestRttInMs = MAX_int32;
+	for (int32 Index = 0; Index < QosCandidates.Num() && Index < RttsInMs.Num(); ++Index)
+	{
+		UE_LOG(LogMultiplayerSessions, Log, TEXT("QoS candidate %s: search ping %d ms, probed %d ms"),
+			*QosCandidates[Index].GetSessionIdStr(), QosCandidates[Index].PingInMs, RttsInMs[Index]);
+
+		if (RttsInMs[Index] != INDEX_NONE && RttsInMs[Index] < BestRttInMs)
+		{
+			BestIndex = Index;
+			BestRttInMs = RttsInMs[Index];
+		}
+	}
+
+	const FOnlineSessionSearchResult Best = QosCandidates[BestIndex];
+	QosCandidates.Reset();
+	QosProber.Reset();
+	JoinSession(Best);
+}
+
+
+void UMultiplayerSessionsSubsystem::StartListeningForPartyInvites()
+{
+	if (SessionUserInviteAcceptedDelegateHandle.IsValid() || !ResolveSessionInterface())
+	{
+		return;
+	}
+
+	SessionUserInviteAcceptedDelegateHandle = SessionInterface->AddOnSessionUserInviteAcceptedDelegate_Handle(
+		FOnSessionUserInviteAcceptedDelegate::CreateUObject(this, &ThisClass::OnSessionUserInviteAccepted));
+}
+
+
+void UMultiplayerSessionsSubsystem::ReserveAndJoinSession(const FOnlineSessionSearchResult& SessionResult, int32 NumReservedSlots)
 {
 	/// Check if the OnlineSessionInterface is valid, if not return out of the function
-	if (!SessionInterface.IsValid())
+	if (!ResolveSessionInterface())
 	{
 		/// Broadcast our own custom delegate
 		/// Passing in EOnJoinSessionCompleteResult with type UnknownError
-		MultiplayerOnJoinSessionComplete.Broadcast(EOnJoinSessionCompleteResult::UnknownError);
+		CompleteJoinSession(EOnJoinSessionCompleteResult::UnknownError);
+		return;
+	}
+
+	DirectJoinAddress.Reset();
+
+	/// A recent host from disk has to be found again before it can be joined; the join goes on in OnRecentHostFound
+	if (!SessionResult.Session.SessionInfo.IsValid())
+	{
+		FString SessionId;
+		FString ConnectString;
+		SessionResult.Session.SessionSettings.Get(FRecentHostsCache::SessionIdSettingKey, SessionId);
+		SessionResult.Session.SessionSettings.Get(FRecentHostsCache::ConnectStringSettingKey, ConnectString);
+		const FUniqueNetIdPtr SessionNetId = SessionId.IsEmpty() ? nullptr : SessionInterface->CreateSessionIdFromString(SessionId);
+		const ULocalPlayer* LocalPlayer = GetWorld()->GetFirstLocalPlayerFromController();
+		const FUniqueNetIdPtr LocalUserId = LocalPlayer ? LocalPlayer->GetPreferredUniqueNetId().GetUniqueNetId() : nullptr;
+		if (!SessionNetId.IsValid() || !LocalUserId.IsValid())
+		{
+			CompleteJoinSession(EOnJoinSessionCompleteResult::SessionDoesNotExist);
+			return;
+		}
+
+		/// The backend can't look sessions up (already found out by an earlier join); connect to where the host last was
+		if (bRecentHostLookupUnsupported)
+		{
+			JoinRecentHostDirectly(SessionId, ConnectString);
+			return;
+		}
+
+		PendingRecentHostId = SessionId;
+		JoiningSessionId = SessionId;
+		MultiplayerSessionsTrace::TracePhase(TraceCorrelationId, TEXT("FindRecentHost"), EMultiplayerSessionsTraceEdge::Begin);
+
+		/// A lookup the backend doesn't implement (Null, Steam) fails before FindSessionById returns; a real one answers later
+		bFindingRecentHost = true;
+		const bool bLookupStarted = SessionInterface->FindSessionById(*LocalUserId, *SessionNetId, *LocalUserId,
+			FOnSingleSessionResultCompleteDelegate::CreateUObject(this, &ThisClass::OnRecentHostFound, SessionId, ConnectString, NumReservedSlots));
+		bFindingRecentHost = false;
+		if (!bLookupStarted && PendingRecentHostId == SessionId)
+		{
+			bRecentHostLookupUnsupported = true;
+			OnRecentHostFound(0, false, FOnlineSessionSearchResult(), SessionId, ConnectString, NumReservedSlots);
+		}
+		return;
+	}
+
+	/// Ask the host to hold our slots first; the join continues in OnReservationResponse
+	JoiningSessionId = SessionResult.GetSessionIdStr();
+	ReservationToken.Reset();
+	if (MultiplayerSessionsReservation::bEnabled && RequestReservation(SessionResult, NumReservedSlots))
+	{
+		return;
+	}
+
+	JoinReservedSession(SessionResult);
+}
+
+
+bool UMultiplayerSessionsSubsystem::RequestReservation(const FOnlineSessionSearchResult& SessionResult, int32 NumSlots)
+{
+	FString BeaconAddress;
+	if (!SessionInterface->GetResolvedConnectString(SessionResult, NAME_BeaconPort, BeaconAddress))
+	{
+		return false;
+	}
+
+	/// A request still waiting for its answer is superseded by this one
+	if (ReservationBeacon.IsValid())
+	{
+		ReservationBeacon->OnReservationResponse.RemoveAll(this);
+		ReservationBeacon->OnWaitlistPosition.RemoveAll(this);
+		ReservationBeacon->DestroyBeacon();
+	}
+
+	ReservationBeacon = GetWorld()->SpawnActor<ALobbyReservationBeaconClient>();
+	if (!ReservationBeacon.IsValid())
+	{
+		return false;
+	}
+
+	PendingJoinResult = SessionResult;
+	ReservationBeacon->OnReservationResponse.AddUObject(this, &ThisClass::OnReservationResponse);
+	ReservationBeacon->OnWaitlistPosition.AddUObject(this, &ThisClass::OnWaitlistPosition);
+
+	/// The host holds the party's slots for these ids, so the members can log in without a token of their own
+	TArray<FUniqueNetIdRepl> PartyMemberIds;
+	for (const FUniqueNetIdRef& PartyMember : PendingPartyMembers)
+	{
+		PartyMemberIds.Emplace(PartyMember);
+	}
+
+	MultiplayerSessionsTrace::TracePhase(TraceCorrelationId, TEXT("Reservation"), EMultiplayerSessionsTraceEdge::Begin);
+	if (!ReservationBeacon->RequestReservation(BeaconAddress, NumSlots, PartyMemberIds, MultiplayerSessionsReservation::bWaitIfFull != 0))
+	{
+		MultiplayerSessionsTrace::TracePhase(TraceCorrelationId, TEXT("Reservation"), EMultiplayerSessionsTraceEdge::End);
+		ReservationBeacon->OnReservationResponse.RemoveAll(this);
+		ReservationBeacon->OnWaitlistPosition.RemoveAll(this);
+		ReservationBeacon->DestroyBeacon();
+		ReservationBeacon.Reset();
+		return false;
+	}
+	return true;
+}
+
+
+void UMultiplayerSessionsSubsystem::OnReservationResponse(bool bHostReached, bool bAccepted, const FString& InReservationToken)
+{
+	MULTIPLAYERSESSIONS_HITCH_SCOPE(Callback, OnReservationResponse);
+	MultiplayerSessionsTrace::TracePhase(TraceCorrelationId, TEXT("Reservation"), EMultiplayerSessionsTraceEdge::End);
+	ReservationBeacon.Reset();
+
+	/// The host answered and has no room, or we waited in line for too long: don't join and travel only to be rejected at login
+	if (bHostReached && !bAccepted)
+	{
+		CompleteJoinSession(EOnJoinSessionCompleteResult::SessionIsFull);
 		return;
 	}
 
+	/// Without an answer (e.g. a host without the beacon), join anyway and let the login decide
+	ReservationToken = InReservationToken;
+	JoinReservedSession(PendingJoinResult);
+}
+
+
+void UMultiplayerSessionsSubsystem::OnWaitlistPosition(int32 Position)
+{
+	MULTIPLAYERSESSIONS_HITCH_SCOPE(Callback, OnWaitlistPosition);
+	MultiplayerSessionsTrace::TracePhase(TraceCorrelationId, TEXT("Waitlist"), EMultiplayerSessionsTraceEdge::Instant);
+	MultiplayerSessionsHitchWatchdog::Broadcast(TEXT("MultiplayerOnWaitlistPosition"), MultiplayerOnWaitlistPosition, Position);
+}
+
+
+void UMultiplayerSessionsSubsystem::JoinReservedSession(const FOnlineSessionSearchResult& SessionResult)
+{
+	MULTIPLAYERSESSIONS_TRACE_SCOPE(MultiplayerSessions_JoinSession);
+
 	/// Add the JoinSessionCompleteDelegate to the OnlineSessionInterface using the AddOnJoinSessionCompleteDelegate_Handle list
 	/// When the session is joined, the OnJoinSessionComplete function will be called, which is bound the OnJoinSessionCompleteDelegate
 	JoinSessionCompleteDelegateHandle = SessionInterface->AddOnJoinSessionCompleteDelegate_Handle(JoinSessionCompleteDelegate);
@@ -174,8 +748,18 @@ void UMultiplayerSessionsSubsystem::JoinSession(const FOnlineSessionSearchResult
 
 	/// Call the JoinSession function on the OnlineSessionInterface, passing in the FUniqueNetId and the SessionSearch TSharedPtr
 	/// This will return a list of sessions that match the search settings we set earlier
+	MultiplayerSessionsTrace::TracePhase(TraceCorrelationId, TEXT("JoinSession"), EMultiplayerSessionsTraceEdge::Begin);
+
+	/// Armed before the call, some backends complete the join from within it
+	if (MultiplayerSessionsJoin::Timeout > 0.f)
+	{
+		GetGameInstance()->GetTimerManager().SetTimer(JoinTimeoutTimerHandle, this, &ThisClass::OnJoinTimeout, MultiplayerSessionsJoin::Timeout, false);
+	}
+
 	if (!SessionInterface->JoinSession(*LocalPlayer->GetPreferredUniqueNetId(), NAME_GameSession, SessionResult))
 	{
+		MultiplayerSessionsTrace::TracePhase(TraceCorrelationId, TEXT("JoinSession"), EMultiplayerSessionsTraceEdge::End);
+		GetGameInstance()->GetTimerManager().ClearTimer(JoinTimeoutTimerHandle);
 		/// If the JoinSession function fails, then we will clear the delegate handle from the list
 		SessionInterface->ClearOnJoinSessionCompleteDelegate_Handle(JoinSessionCompleteDelegateHandle);
 
@@ -191,115 +775,979 @@ void UMultiplayerSessionsSubsystem::JoinSession(const FOnlineSessionSearchResult
 
 		/// Broadcast our own custom delegate
 		/// Passing in EOnJoinSessionCompleteResult with type UnknownError
-		MultiplayerOnJoinSessionComplete.Broadcast((EOnJoinSessionCompleteResult::UnknownError));
+		CompleteJoinSession(EOnJoinSessionCompleteResult::UnknownError);
 	}
 }
 
 
 void UMultiplayerSessionsSubsystem::DestroySession()
 {
-	if (!SessionInterface.IsValid())
+	if (!ResolveSessionInterface())
 	{
-		MultiplayerOnDestroySessionComplete.Broadcast(false);
+		CompleteDestroySession(false);
 		return;
 	}
 
 	DestroySessionCompleteDelegateHandle = SessionInterface->AddOnDestroySessionCompleteDelegate_Handle(DestroySessionCompleteDelegate);
 
+	MultiplayerSessionsTrace::TracePhase(TraceCorrelationId, TEXT("DestroySession"), EMultiplayerSessionsTraceEdge::Begin);
 	if (!SessionInterface->DestroySession(NAME_GameSession))
 	{
-		SessionInterface->ClearOnDestroySessionCompleteDelegate_Handle(DestroySessionCompleteDelegateHandle);
-		MultiplayerOnDestroySessionComplete.Broadcast(false);
+		OnDestroySessionComplete(NAME_GameSession, false);
 	}
 }
 
 
-void UMultiplayerSessionsSubsystem::StartSession()
+TFuture<FCreateSessionResult> UMultiplayerSessionsSubsystem::CreateSessionAsync(int32 NumPublicConnections, FString MatchType,
+	const FSessionCancellationToken& CancellationToken)
+{
+	TFuture<FCreateSessionResult> Future = PendingCreateSession.Begin(CancellationToken);
+	CreateSession(NumPublicConnections, MoveTemp(MatchType));
+	return Future;
+}
+
+
+TFuture<FFindSessionsResult> UMultiplayerSessionsSubsystem::FindSessionsAsync(int32 MaxSearchResults, const FString& MatchType,
+	const FSessionCancellationToken& CancellationToken)
 {
+	TFuture<FFindSessionsResult> Future = PendingFindSessions.Begin(CancellationToken);
+	const uint32 CallId = PendingFindSessions.GetCallId();
+	FindSessions(MaxSearchResults, MatchType);
+
+	CancellationToken.OnCanceled([WeakThis = TWeakObjectPtr<ThisClass>(this), CallId]()
+	{
+		ThisClass* This = WeakThis.Get();
+		if (This == nullptr || !This->PendingFindSessions.IsPending(CallId))
+		{
+			return;
+		}
 
+		/// Whatever the search still finds, or the results still being ranked, are dropped with it
+		if (This->LastSessionSearch.IsValid())
+		{
+			MultiplayerSessionsTrace::TracePhase(This->TraceCorrelationId, TEXT("FindSessions"), EMultiplayerSessionsTraceEdge::End);
+			This->SessionInterface->ClearOnFindSessionsCompleteDelegate_Handle(This->FindSessionsCompleteDelegateHandle);
+			This->SessionInterface->CancelFindSessions();
+			This->LastSessionSearch.Reset();
+		}
+		++This->SearchSerial;
+		This->CompleteFindSessions(MakeShared<FSessionResultStore>(), false);
+	});
+	return Future;
 }
 
 
-void UMultiplayerSessionsSubsystem::OnCreateSessionComplete(FName SessionName, bool bWasSuccessful)
+TFuture<FJoinSessionResult> UMultiplayerSessionsSubsystem::JoinSessionAsync(const FOnlineSessionSearchResult& SessionResult,
+	const FSessionCancellationToken& CancellationToken)
 {
-	/// Fired off when creating a session is complete
-	if (SessionInterface)
+	/// A probe still running for a superseded call would join on top of this one
+	CancelPendingJoin();
+
+	TFuture<FJoinSessionResult> Future = PendingJoinSession.Begin(CancellationToken);
+	const uint32 CallId = PendingJoinSession.GetCallId();
+	JoinSession(SessionResult);
+
+	CancellationToken.OnCanceled([WeakThis = TWeakObjectPtr<ThisClass>(this), CallId]()
 	{
-		/// Clear the delegate handle from the list of delegates
-		SessionInterface->ClearOnCreateSessionCompleteDelegate_Handle(CreateSessionCompleteDelegateHandle);
-	}
-	
-	/// Broadcast our own custom delegate
-	/// Broadcast the OnCreateSessionComplete delegate, passing in bWasSuccessful as the parameter
-	MultiplayerOnCreateSessionComplete.Broadcast(bWasSuccessful);
+		ThisClass* This = WeakThis.Get();
+		if (This && This->PendingJoinSession.IsPending(CallId) && This->CancelPendingJoin())
+		{
+			This->CompleteJoinSession(EOnJoinSessionCompleteResult::UnknownError);
+		}
+	});
+	return Future;
 }
 
 
-void UMultiplayerSessionsSubsystem::OnFindSessionsComplete(bool bWasSuccessful)
+TFuture<FJoinSessionResult> UMultiplayerSessionsSubsystem::JoinBestSessionAsync(const FSessionResultStore& SearchResults,
+	const TArray<int32>& CandidateIndices, const FSessionCancellationToken& CancellationToken)
 {
+	/// The probe of a superseded call would otherwise keep this one from starting
+	CancelPendingJoin();
 
-	/// Fired off when finding a session is successful
-	if (SessionInterface)
+	TFuture<FJoinSessionResult> Future = PendingJoinSession.Begin(CancellationToken);
+	const uint32 CallId = PendingJoinSession.GetCallId();
+	if (CandidateIndices.Num() == 0)
 	{
-		/// Clear the delegate handle from the list of delegates
-		SessionInterface->ClearOnFindSessionsCompleteDelegate_Handle(FindSessionsCompleteDelegateHandle);
+		CompleteJoinSession(EOnJoinSessionCompleteResult::SessionDoesNotExist);
+		return Future;
 	}
-	
+	JoinBestSession(SearchResults, CandidateIndices);
 
-	/// Check if the search was successful, if it was successful but the results are empty
-	/// Then we will broadcast our own custom delegate with an empty TArray of type FOnlineSessionSearchResult and false as the parameter
-	/// We will return out of the function because we didn't find any valid search results
-	if (LastSessionSearch->SearchResults.Num() <=0)
+	CancellationToken.OnCanceled([WeakThis = TWeakObjectPtr<ThisClass>(this), CallId]()
 	{
-		/// Broadcast our own custom delegate
-		/// Passing in an empty TArray of type FOnlineSessionSearchResult and false because a session was not found
-		//if (GEngine)
-		//{
-		//	GEngine->AddOnScreenDebugMessage(
-		//		-1,
-		//		15.f,
-		//		FColor::Red,
-		//		FString::Printf(TEXT("No Session Found!"))
-		//	);
-		//}
-		MultiplayerOnFindSessionsComplete.Broadcast(TArray<FOnlineSessionSearchResult>(), false);
-		return;
+		ThisClass* This = WeakThis.Get();
+		if (This && This->PendingJoinSession.IsPending(CallId) && This->CancelPendingJoin())
+		{
+			This->CompleteJoinSession(EOnJoinSessionCompleteResult::UnknownError);
+		}
+	});
+	return Future;
+}
+
+
+TFuture<FJoinSessionResult> UMultiplayerSessionsSubsystem::MatchmakeAsync(const FString& MatchType,
+	const FSessionCancellationToken& CancellationToken, const TArray<FMatchmakingStage>& Stages)
+{
+	/// A probe still running, or the matchmaking of a superseded call, would join on top of this one
+	CancelPendingJoin();
+	StopMatchmaking(false, true);
+
+	/// Matchmaking's searches take the place of the caller's own
+	PendingFindSessions.Complete(FFindSessionsResult());
+
+	TFuture<FJoinSessionResult> Future = PendingJoinSession.Begin(CancellationToken);
+	const uint32 CallId = PendingJoinSession.GetCallId();
+
+	MatchmakingStages = Stages.Num() > 0 ? Stages : FMatchmakingStage::GetDefaultStages();
+	if (!LexTryParseString(MatchmakingMatchType, *MatchType))
+	{
+		UE_LOG(LogMultiplayerSessions, Warning, TEXT("Matchmaking for unknown match type %s"), *MatchType);
+	}
+	if (!TraceCorrelationId.IsValid())
+	{
+		BeginTraceCorrelation(TEXT("Matchmake"));
+	}
+	MatchmakingStartTime = FPlatformTime::Seconds();
+	EnterMatchmakingStage(0);
+
+	CancellationToken.OnCanceled([WeakThis = TWeakObjectPtr<ThisClass>(this), CallId]()
+	{
+		ThisClass* This = WeakThis.Get();
+		if (This == nullptr || !This->PendingJoinSession.IsPending(CallId))
+		{
+			return;
+		}
+
+		if (This->IsMatchmaking())
+		{
+			This->StopMatchmaking(false, true);
+			This->CompleteJoinSession(EOnJoinSessionCompleteResult::UnknownError);
+		}
+		else if (This->CancelPendingJoin())
+		{
+			This->CompleteJoinSession(EOnJoinSessionCompleteResult::UnknownError);
+		}
+	});
+	return Future;
+}
+
+
+void UMultiplayerSessionsSubsystem::EnterMatchmakingStage(int32 StageIndex)
+{
+	MatchmakingStageIndex = StageIndex;
+	MatchmakingStageStartTime = FPlatformTime::Seconds();
+	MatchmakingStagePhase = FString::Printf(TEXT("MatchmakingStage%d"), StageIndex);
+	MultiplayerSessionsTrace::TracePhase(TraceCorrelationId, *MatchmakingStagePhase, EMultiplayerSessionsTraceEdge::Begin);
+
+	const FMatchmakingStage& Stage = MatchmakingStages[StageIndex];
+	UE_LOG(LogMultiplayerSessions, Log, TEXT("Matchmaking stage %d: %.0f s, %d results, %s region, ping %d ms, %.0f%% full"),
+		StageIndex, Stage.Duration, Stage.MaxSearchResults, Stage.bSameRegion ? TEXT("same") : TEXT("any"), Stage.MaxPingInMs, Stage.MinFillRatio * 100.f);
+
+	SearchMatchmakingStage();
+}
+
+
+void UMultiplayerSessionsSubsystem::SearchMatchmakingStage()
+{
+	if (!IsMatchmaking())
+	{
+		return;
+	}
+
+	const FMatchmakingStage& Stage = MatchmakingStages[MatchmakingStageIndex];
+	FSessionAttributeFilter Filter = FSessionAttributeFilter::MakeCompatible().WithMatchType(MatchmakingMatchType);
+	const ESessionRegion LocalRegion = MultiplayerSessionsSchema::GetLocalRegion();
+	if (Stage.bSameRegion && LocalRegion != ESessionRegion::Unknown)
+	{
+		Filter.WithRegion(LocalRegion);
+	}
+
+	MatchmakingSearchStartTime = FPlatformTime::Seconds();
+	StartSessionSearch(Stage.MaxSearchResults, Filter, true);
+}
+
+
+void UMultiplayerSessionsSubsystem::OnMatchmakingSearchComplete(const TSharedRef<FSessionResultStore>& SearchResults)
+{
+	if (!IsMatchmaking())
+	{
+		return;
+	}
+
+	const FMatchmakingStage& Stage = MatchmakingStages[MatchmakingStageIndex];
+	TArray<int32> Candidates;
+	Stage.SelectCandidates(*SearchResults, Candidates);
+	FMatchmakingStats::Get().RecordSearch(MatchmakingStageIndex, SearchResults->Num(), Candidates.Num());
+
+	if (Candidates.Num() > 0)
+	{
+		UE_LOG(LogMultiplayerSessions, Log, TEXT("Matchmaking stage %d: %d of %d sessions fit, %.1f s after matchmaking started"),
+			MatchmakingStageIndex, Candidates.Num(), SearchResults->Num(), FPlatformTime::Seconds() - MatchmakingStartTime);
+		StopMatchmaking(true, false);
+		JoinBestSession(*SearchResults, Candidates);
+		return;
+	}
+
+	/// Search the stage again if it has time for it, otherwise widen now rather than wait its time out
+	const double Now = FPlatformTime::Seconds();
+	const double NextSearchTime = MatchmakingSearchStartTime + MultiplayerSessionsMatchmaking::RequeryInterval;
+	if (NextSearchTime < MatchmakingStageStartTime + Stage.Duration)
+	{
+		GetGameInstance()->GetTimerManager().SetTimer(MatchmakingTimerHandle, this, &ThisClass::SearchMatchmakingStage,
+			FMath::Max(NextSearchTime - Now, 0.01), false);
+		return;
+	}
+
+	const int32 StageIndex = MatchmakingStageIndex;
+	MultiplayerSessionsTrace::TracePhase(TraceCorrelationId, *MatchmakingStagePhase, EMultiplayerSessionsTraceEdge::End);
+	FMatchmakingStats::Get().RecordStage(StageIndex, Now - MatchmakingStageStartTime, false);
+	if (MatchmakingStages.IsValidIndex(StageIndex + 1))
+	{
+		EnterMatchmakingStage(StageIndex + 1);
+		return;
+	}
+
+	UE_LOG(LogMultiplayerSessions, Log, TEXT("Matchmaking: no session after %d stages, %.1f s"), MatchmakingStages.Num(), Now - MatchmakingStartTime);
+	MatchmakingStageIndex = INDEX_NONE;
+	FMatchmakingStats::Get().RecordMatchmaking(false, false, Now - MatchmakingStartTime);
+	CompleteJoinSession(EOnJoinSessionCompleteResult::SessionDoesNotExist);
+}
+
+
+void UMultiplayerSessionsSubsystem::StopMatchmaking(bool bMatched, bool bCanceled)
+{
+	if (!IsMatchmaking())
+	{
+		return;
+	}
+
+	if (UGameInstance* GameInstance = GetGameInstance())
+	{
+		GameInstance->GetTimerManager().ClearTimer(MatchmakingTimerHandle);
+	}
+
+	/// The stage's search is dropped with it
+	if (bMatchmakingSearch && LastSessionSearch.IsValid())
+	{
+		MultiplayerSessionsTrace::TracePhase(TraceCorrelationId, TEXT("FindSessions"), EMultiplayerSessionsTraceEdge::End);
+		SessionInterface->ClearOnFindSessionsCompleteDelegate_Handle(FindSessionsCompleteDelegateHandle);
+		SessionInterface->CancelFindSessions();
+		LastSessionSearch.Reset();
+		++SearchSerial;
+	}
+	bMatchmakingSearch = false;
+
+	const double Now = FPlatformTime::Seconds();
+	MultiplayerSessionsTrace::TracePhase(TraceCorrelationId, *MatchmakingStagePhase, EMultiplayerSessionsTraceEdge::End);
+	FMatchmakingStats::Get().RecordStage(MatchmakingStageIndex, Now - MatchmakingStageStartTime, bMatched);
+	FMatchmakingStats::Get().RecordMatchmaking(bMatched, bCanceled, Now - MatchmakingStartTime);
+	MatchmakingStageIndex = INDEX_NONE;
+}
+
+
+TFuture<FDestroySessionResult> UMultiplayerSessionsSubsystem::DestroySessionAsync(const FSessionCancellationToken& CancellationToken)
+{
+	TFuture<FDestroySessionResult> Future = PendingDestroySession.Begin(CancellationToken);
+	DestroySession();
+	return Future;
+}
+
+
+void UMultiplayerSessionsSubsystem::CompleteCreateSession(bool bWasSuccessful)
+{
+	FCreateSessionResult Result;
+	Result.bWasSuccessful = bWasSuccessful;
+	if (!PendingCreateSession.IsPending())
+	{
+		MultiplayerSessionsHitchWatchdog::Broadcast(TEXT("MultiplayerOnCreateSessionComplete"), MultiplayerOnCreateSessionComplete, bWasSuccessful);
+		return;
+	}
+
+	MULTIPLAYERSESSIONS_HITCH_SCOPE(Listener, CreateSessionAsync_Continuation);
+	PendingCreateSession.Complete(MoveTemp(Result));
+}
+
+
+void UMultiplayerSessionsSubsystem::CompleteFindSessions(const TSharedRef<FSessionResultStore>& SearchResults, bool bWasSuccessful)
+{
+	/// A matchmaking stage's search is nobody else's business
+	if (bMatchmakingSearch)
+	{
+		bMatchmakingSearch = false;
+		OnMatchmakingSearchComplete(SearchResults);
+		return;
+	}
+
+	FFindSessionsResult Result;
+	Result.bWasSuccessful = bWasSuccessful;
+	Result.SearchResults = SearchResults;
+	if (!PendingFindSessions.IsPending())
+	{
+		MultiplayerSessionsHitchWatchdog::Broadcast(TEXT("MultiplayerOnFindSessionsComplete"), MultiplayerOnFindSessionsComplete, SearchResults, bWasSuccessful);
+		return;
+	}
+
+	MULTIPLAYERSESSIONS_HITCH_SCOPE(Listener, FindSessionsAsync_Continuation);
+	PendingFindSessions.Complete(MoveTemp(Result));
+}
+
+
+void UMultiplayerSessionsSubsystem::CompleteJoinSession(EOnJoinSessionCompleteResult::Type JoinResult)
+{
+	FJoinSessionResult Result;
+	Result.bWasSuccessful = JoinResult == EOnJoinSessionCompleteResult::Success;
+	Result.Result = JoinResult;
+	if (!PendingJoinSession.IsPending())
+	{
+		MultiplayerSessionsHitchWatchdog::Broadcast(TEXT("MultiplayerOnJoinSessionComplete"), MultiplayerOnJoinSessionComplete, JoinResult);
+		return;
+	}
+
+	MULTIPLAYERSESSIONS_HITCH_SCOPE(Listener, JoinSessionAsync_Continuation);
+	PendingJoinSession.Complete(MoveTemp(Result));
+}
+
+
+void UMultiplayerSessionsSubsystem::CompleteDestroySession(bool bWasSuccessful)
+{
+	FDestroySessionResult Result;
+	Result.bWasSuccessful = bWasSuccessful;
+	if (!PendingDestroySession.IsPending())
+	{
+		MultiplayerSessionsHitchWatchdog::Broadcast(TEXT("MultiplayerOnDestroySessionComplete"), MultiplayerOnDestroySessionComplete, bWasSuccessful);
+		return;
+	}
+
+	MULTIPLAYERSESSIONS_HITCH_SCOPE(Listener, DestroySessionAsync_Continuation);
+	PendingDestroySession.Complete(MoveTemp(Result));
+}
+
+
+bool UMultiplayerSessionsSubsystem::CancelPendingJoin()
+{
+	if (!PendingRecentHostId.IsEmpty())
+	{
+		/// The lookup can't be stopped; its answer is dropped
+		MultiplayerSessionsTrace::TracePhase(TraceCorrelationId, TEXT("FindRecentHost"), EMultiplayerSessionsTraceEdge::End);
+		PendingRecentHostId.Reset();
+		return true;
+	}
+
+	if (QosProber.IsValid() && QosProber->IsRunning())
+	{
+		MultiplayerSessionsTrace::TracePhase(TraceCorrelationId, TEXT("QosProbe"), EMultiplayerSessionsTraceEdge::End);
+		QosProber->Cancel();
+		QosProber.Reset();
+		QosCandidates.Reset();
+		return true;
+	}
+
+	if (ReservationBeacon.IsValid())
+	{
+		MultiplayerSessionsTrace::TracePhase(TraceCorrelationId, TEXT("Reservation"), EMultiplayerSessionsTraceEdge::End);
+		ReservationBeacon->OnReservationResponse.RemoveAll(this);
+		ReservationBeacon->OnWaitlistPosition.RemoveAll(this);
+		ReservationBeacon->DestroyBeacon();
+		ReservationBeacon.Reset();
+		return true;
+	}
+	return false;
+}
+
+
+void UMultiplayerSessionsSubsystem::StartSession()
+{
+
+}
+
+
+void UMultiplayerSessionsSubsystem::UpdateAdvertisedAttributes(ESessionLobbyState LobbyState, int32 NumPlayers)
+{
+	if (!LastSessionSettings.IsValid() || !ResolveSessionInterface() || SessionInterface->GetNamedSession(NAME_GameSession) == nullptr)
+	{
+		return;
+	}
+
+	uint64 Packed;
+	FSessionAttributes::Read(*LastSessionSettings, Packed);
+	FSessionAttributes Attributes = FSessionAttributes::Unpack(Packed);
+	Attributes.LobbyState = LobbyState;
+	Attributes.NumPlayers = static_cast<uint8>(FMath::Clamp(NumPlayers, 0, static_cast<int32>(MAX_uint8)));
+	if (Attributes.Pack() == Packed)
+	{
+		return;
+	}
+
+	Attributes.Write(*LastSessionSettings);
+	SessionInterface->UpdateSession(NAME_GameSession, *LastSessionSettings, true);
+}
+
+
+bool UMultiplayerSessionsSubsystem::GetResolvedConnectString(FString& OutAddress) const
+{
+	MULTIPLAYERSESSIONS_TRACE_SCOPE(MultiplayerSessions_GetResolvedConnectString);
+	MultiplayerSessionsTrace::TracePhase(TraceCorrelationId, TEXT("ResolveConnectString"), EMultiplayerSessionsTraceEdge::Instant);
+
+	if (!ResolveSessionInterface())
+	{
+		return false;
+	}
+
+	/// A recent host joined without a session, see JoinRecentHostDirectly
+	if (!DirectJoinAddress.IsEmpty())
+	{
+		OutAddress = DirectJoinAddress;
+		return true;
+	}
+
+	/// Get Address or ResolvedConnectString of the session we joined
+	return SessionInterface->GetResolvedConnectString(NAME_GameSession, OutAddress);
+}
+
+
+FString UMultiplayerSessionsSubsystem::BuildTravelURL(const FString& Address) const
+{
+	FString URL = MultiplayerSessionsTrace::AddCorrelationIdToURL(Address, TraceCorrelationId);
+	if (!ReservationToken.IsEmpty())
+	{
+		URL += FString::Printf(TEXT("?%s=%s"), ALobbyReservationBeaconClient::ReservationTokenOption, *ReservationToken);
+	}
+	return URL;
+}
+
+
+bool UMultiplayerSessionsSubsystem::GetResolvedConnectString(const FOnlineSessionSearchResult& SessionResult, FString& OutAddress) const
+{
+	if (!ResolveSessionInterface())
+	{
+		return false;
+	}
+
+	return SessionInterface->GetResolvedConnectString(SessionResult, NAME_GamePort, OutAddress);
+}
+
+
+const FGuid& UMultiplayerSessionsSubsystem::BeginTraceCorrelation(const TCHAR* Trigger)
+{
+	TraceCorrelationId = FGuid::NewGuid();
+	FMultiplayerSessionsTelemetry::Get().BeginFlow(TraceCorrelationId, Trigger);
+	MultiplayerSessionsTrace::TracePhase(TraceCorrelationId, Trigger, EMultiplayerSessionsTraceEdge::Instant);
+	return TraceCorrelationId;
+}
+
+
+void UMultiplayerSessionsSubsystem::EndTraceCorrelation(const TCHAR* Phase)
+{
+	if (!TraceCorrelationId.IsValid())
+	{
+		return;
+	}
+
+	MultiplayerSessionsTrace::TracePhase(TraceCorrelationId, Phase, EMultiplayerSessionsTraceEdge::Instant);
+	FMultiplayerSessionsTelemetry::Get().EndFlow(TraceCorrelationId, Phase);
+
+	/// The flow is over; later session calls and travels start their own instead of being traced under this one
+	TraceCorrelationId.Invalidate();
+}
+
+
+const FOnlineSessionSettings* UMultiplayerSessionsSubsystem::GetCurrentSessionSettings() const
+{
+	if (!ResolveSessionInterface())
+	{
+		return nullptr;
+	}
+
+	/// The session interface keeps the settings of the named session for as long as it exists
+	return SessionInterface->GetSessionSettings(NAME_GameSession);
+}
+
+
+void UMultiplayerSessionsSubsystem::OnCreateSessionComplete(FName SessionName, bool bWasSuccessful)
+{
+	MULTIPLAYERSESSIONS_HITCH_SCOPE(Callback, OnCreateSessionComplete);
+	MULTIPLAYERSESSIONS_TRACE_SCOPE(MultiplayerSessions_OnCreateSessionComplete);
+	MultiplayerSessionsTrace::TracePhase(TraceCorrelationId, TEXT("CreateSession"), EMultiplayerSessionsTraceEdge::End);
+
+	/// Fired off when creating a session is complete
+	if (SessionInterface)
+	{
+		/// Clear the delegate handle from the list of delegates
+		SessionInterface->ClearOnCreateSessionCompleteDelegate_Handle(CreateSessionCompleteDelegateHandle);
+	}
+
+	/// A migration successor hosts the lobby itself; the menu on the entry map mustn't travel on its own
+	if (MigrationRole == EHostMigrationRole::Successor)
+	{
+		if (bWasSuccessful)
+		{
+			MultiplayerSessionsTrace::TracePhase(TraceCorrelationId, TEXT("Travel"), EMultiplayerSessionsTraceEdge::Begin);
+			MULTIPLAYERSESSIONS_TRAVEL_HITCH_SCOPE(ServerTravel);
+			GetWorld()->ServerTravel(MultiplayerSessionsTrace::AddCorrelationIdToURL(LobbyMapPath + TEXT("?listen"), TraceCorrelationId));
+		}
+		else
+		{
+			FinishHostMigration(false);
+		}
+		return;
+	}
+	
+	/// Broadcast our own custom delegate
+	/// Broadcast the OnCreateSessionComplete delegate, passing in bWasSuccessful as the parameter
+	CompleteCreateSession(bWasSuccessful);
+}
+
+
+void UMultiplayerSessionsSubsystem::OnFindSessionsComplete(bool bWasSuccessful)
+{
+	MULTIPLAYERSESSIONS_HITCH_SCOPE(Callback, OnFindSessionsComplete);
+	MULTIPLAYERSESSIONS_TRACE_SCOPE(MultiplayerSessions_OnFindSessionsComplete);
+	MultiplayerSessionsTrace::TracePhase(TraceCorrelationId, TEXT("FindSessions"), EMultiplayerSessionsTraceEdge::End);
+
+	/// Fired off when finding a session is successful
+	if (SessionInterface)
+	{
+		/// Clear the delegate handle from the list of delegates
+		SessionInterface->ClearOnFindSessionsCompleteDelegate_Handle(FindSessionsCompleteDelegateHandle);
+	}
+
+	/// Take the full results out of the search, and let go of the search before anything else happens
+	TArray<FOnlineSessionSearchResult> SearchResults;
+	if (LastSessionSearch.IsValid())
+	{
+		SearchResults = MoveTemp(LastSessionSearch->SearchResults);
+	}
+	LastSessionSearch.Reset();
+
+	const double StartTime = FPlatformTime::Seconds();
+	const int32 NumRawResults = SearchResults.Num();
+	MultiplayerSessionsTrace::TracePhase(TraceCorrelationId, TEXT("ProcessSearchResults"), EMultiplayerSessionsTraceEdge::Begin);
+
+	/// Sessions that just failed to join are most likely still gone
+	TSet<FString> SuppressedSessionIds = GhostSessions.GetSuppressedSessionIds();
+
+	if (!MultiplayerSessionsSearch::bAsyncProcessing)
+	{
+		int32 NumSuppressed = 0;
+		TSharedRef<FSessionResultStore> Ranked = FSessionResultStore::BuildRanked(MoveTemp(SearchResults), LastSearchFilter, SuppressedSessionIds, &NumSuppressed);
+		FGhostSessionCache::RecordSuppressedResults(NumSuppressed);
+		FinishFindSessions(Ranked, bWasSuccessful);
+		UE_LOG(LogMultiplayerSessions, Log, TEXT("Search results: %d raw, %d ghosts suppressed, processed in %.2f ms on the game thread"),
+			NumRawResults, NumSuppressed, (FPlatformTime::Seconds() - StartTime) * 1000.0);
+		return;
+	}
+
+	/// Only the result store comes back to the game thread; a newer or canceled search makes it stale
+	const uint32 Serial = SearchSerial;
+	UE::Tasks::Launch(UE_SOURCE_LOCATION, [WeakThis = TWeakObjectPtr<ThisClass>(this), SearchResults = MoveTemp(SearchResults),
+		SuppressedSessionIds = MoveTemp(SuppressedSessionIds), Filter = LastSearchFilter, Serial, bWasSuccessful, StartTime]() mutable
+	{
+		const SIZE_T RawResultsSize = FSessionResultStore::GetAllocatedSize(SearchResults);
+		int32 NumSuppressed = 0;
+		TSharedRef<FSessionResultStore> Ranked = FSessionResultStore::BuildRanked(MoveTemp(SearchResults), Filter, SuppressedSessionIds, &NumSuppressed);
+		const double WorkerSeconds = FPlatformTime::Seconds() - StartTime;
+		UE_LOG(LogMultiplayerSessions, Verbose, TEXT("Search results: %.1f KB as full results, %d ghosts suppressed"), RawResultsSize / 1024.0, NumSuppressed);
+
+		AsyncTask(ENamedThreads::GameThread, [WeakThis, Ranked, Serial, bWasSuccessful, WorkerSeconds, NumSuppressed]()
+		{
+			ThisClass* This = WeakThis.Get();
+			if (This == nullptr)
+			{
+				return;
+			}
+
+			/// A newer or canceled search makes these stale; the phase still ends here
+			if (This->SearchSerial != Serial)
+			{
+				MultiplayerSessionsTrace::TracePhase(This->TraceCorrelationId, TEXT("ProcessSearchResults"), EMultiplayerSessionsTraceEdge::End);
+				return;
+			}
+
+			const double FinishStartTime = FPlatformTime::Seconds();
+			FGhostSessionCache::RecordSuppressedResults(NumSuppressed);
+			This->FinishFindSessions(Ranked, bWasSuccessful);
+			UE_LOG(LogMultiplayerSessions, Log, TEXT("Search results: processed in %.2f ms on a worker, %.2f ms on the game thread to hand over"),
+				WorkerSeconds * 1000.0, (FPlatformTime::Seconds() - FinishStartTime) * 1000.0);
+		});
+	});
+	UE_LOG(LogMultiplayerSessions, Verbose, TEXT("Search results: %d raw, handed to a worker in %.2f ms"),
+		NumRawResults, (FPlatformTime::Seconds() - StartTime) * 1000.0);
+}
+
+
+void UMultiplayerSessionsSubsystem::FinishFindSessions(const TSharedRef<FSessionResultStore>& SearchResults, bool bWasSuccessful)
+{
+	MULTIPLAYERSESSIONS_HITCH_SCOPE(Callback, FinishFindSessions);
+	MultiplayerSessionsTrace::TracePhase(TraceCorrelationId, TEXT("ProcessSearchResults"), EMultiplayerSessionsTraceEdge::End);
+
+	ApplyRecentHostRtts(*SearchResults);
+	if (bWasSuccessful)
+	{
+		RememberSearchResults(*SearchResults);
+	}
+
+	LastSearchResults = SearchResults;
+	UE_LOG(LogMultiplayerSessions, Log, TEXT("Search results: %d sessions, %.1f KB resident"), SearchResults->Num(), SearchResults->GetAllocatedSize() / 1024.0);
+
+	/// Check if the search was successful, if it was successful but the results are empty
+	/// Then we will broadcast our own custom delegate with an empty result store and false as the parameter
+	if (SearchResults->Num() <= 0)
+	{
+		CompleteFindSessions(SearchResults, false);
+		return;
+	}
+
+	/// Broadcast our own custom delegate
+	/// Broadcast the OnFindSessionsComplete delegate, passing in bWasSuccessful as the parameter
+	CompleteFindSessions(SearchResults, bWasSuccessful);
+}
+
+
+TSharedRef<FSessionResultStore> UMultiplayerSessionsSubsystem::GetRecentHostResults() const
+{
+	if (!FRecentHostsCache::IsEnabled())
+	{
+		return MakeShared<FSessionResultStore>();
+	}
+
+	TSharedRef<FSessionResultStore> RecentHosts = FRecentHostsCache::Get().MakeResultStore(GhostSessions.GetSuppressedSessionIds());
+	ApplyRecentHostRtts(*RecentHosts);
+	return RecentHosts;
+}
+
+
+void UMultiplayerSessionsSubsystem::PreProbeRecentHosts()
+{
+	if (!FRecentHostsCache::IsEnabled() || (RecentHostsProber.IsValid() && RecentHostsProber->IsRunning()))
+	{
+		return;
+	}
+
+	/// Only hosts that advertised a responder and resolved to an address can be probed before they are found again
+	TArray<FString> ProbeAddresses;
+	PreProbedSessionIds.Reset();
+	for (const FRecentHostRecord& Record : FRecentHostsCache::Get().GetRecords())
+	{
+		if (ProbeAddresses.Num() >= FRecentHostsCache::GetNumToPreProbe())
+		{
+			break;
+		}
+
+		const FString ConnectString = FRecentHostsCache::GetConnectString(Record);
+		if (Record.QosPort > 0 && !ConnectString.IsEmpty())
+		{
+			ProbeAddresses.Add(FSessionQosProber::MakeProbeAddress(ConnectString, Record.QosPort));
+			PreProbedSessionIds.Add(FRecentHostsCache::GetSessionId(Record));
+		}
+	}
+
+	if (ProbeAddresses.Num() == 0)
+	{
+		return;
 	}
 
-	
-	/// Broadcast our own custom delegate
-	/// Broadcast the OnCreateSessionComplete delegate, passing in bWasSuccessful as the parameter
-	MultiplayerOnFindSessionsComplete.Broadcast(LastSessionSearch->SearchResults, bWasSuccessful);
+	RecentHostsProber = MakeShared<FSessionQosProber>();
+	RecentHostsProber->Start(ProbeAddresses, MultiplayerSessionsQos::SocketBudget, MultiplayerSessionsQos::WindowSeconds,
+		FOnSessionQosProbeComplete::CreateUObject(this, &ThisClass::OnRecentHostsProbeComplete));
+}
+
+
+void UMultiplayerSessionsSubsystem::OnRecentHostsProbeComplete(const TArray<int32>& RttsInMs)
+{
+	MULTIPLAYERSESSIONS_HITCH_SCOPE(Callback, OnRecentHostsProbeComplete);
+
+	RecentHostRtts.Reset();
+	for (int32 Index = 0; Index < PreProbedSessionIds.Num() && Index < RttsInMs.Num(); ++Index)
+	{
+		if (RttsInMs[Index] != INDEX_NONE)
+		{
+			RecentHostRtts.Add(PreProbedSessionIds[Index], RttsInMs[Index]);
+			FRecentHostsCache::Get().UpdatePing(PreProbedSessionIds[Index], RttsInMs[Index]);
+		}
+	}
+	UE_LOG(LogMultiplayerSessions, Log, TEXT("Recent hosts: %d of %d answered the probe"), RecentHostRtts.Num(), PreProbedSessionIds.Num());
+
+	PreProbedSessionIds.Reset();
+	RecentHostsProber.Reset();
+
+	/// A search that came back first still gets the measured pings, for the join that follows
+	if (LastSearchResults.IsValid())
+	{
+		ApplyRecentHostRtts(*LastSearchResults);
+	}
+}
+
+
+void UMultiplayerSessionsSubsystem::ApplyRecentHostRtts(FSessionResultStore& SearchResults) const
+{
+	if (RecentHostRtts.Num() == 0)
+	{
+		return;
+	}
+
+	for (int32 Index = 0; Index < SearchResults.Num(); ++Index)
+	{
+		if (const int32* RttInMs = RecentHostRtts.Find(SearchResults.GetSessionIdStr(Index)))
+		{
+			SearchResults.SetPingInMs(Index, *RttInMs);
+		}
+	}
+}
+
+
+void UMultiplayerSessionsSubsystem::RememberSearchResults(const FSessionResultStore& SearchResults)
+{
+	if (!FRecentHostsCache::IsEnabled())
+	{
+		return;
+	}
+
+	/// The results are ranked, so the first ones are the best
+	const int32 NumToRemember = FMath::Min(SearchResults.Num(), FRecentHostsCache::GetMaxPerSearch());
+	TArray<FOnlineSessionSearchResult> Results;
+	TArray<FString> ConnectStrings;
+	Results.Reserve(NumToRemember);
+	ConnectStrings.Reserve(NumToRemember);
+	for (int32 Index = 0; Index < NumToRemember; ++Index)
+	{
+		FOnlineSessionSearchResult& Result = Results.Add_GetRef(SearchResults.GetSearchResult(Index));
+		FString& ConnectString = ConnectStrings.AddDefaulted_GetRef();
+		GetResolvedConnectString(Result, ConnectString);
+	}
+	FRecentHostsCache::Get().RecordHosts(Results, ConnectStrings);
+}
+
+
+void UMultiplayerSessionsSubsystem::OnRecentHostFound(int32 LocalUserNum, bool bWasSuccessful, const FOnlineSessionSearchResult& SearchResult,
+	FString SessionId, FString ConnectString, int32 NumReservedSlots)
+{
+	MULTIPLAYERSESSIONS_HITCH_SCOPE(Callback, OnRecentHostFound);
+
+	/// Canceled, or superseded by another join
+	if (PendingRecentHostId != SessionId)
+	{
+		return;
+	}
+	PendingRecentHostId.Reset();
+	MultiplayerSessionsTrace::TracePhase(TraceCorrelationId, TEXT("FindRecentHost"), EMultiplayerSessionsTraceEdge::End);
+
+	/// Failing inside FindSessionById is a backend without the lookup, which says nothing about the host
+	if (bFindingRecentHost && (!bWasSuccessful || !SearchResult.IsValid()))
+	{
+		bRecentHostLookupUnsupported = true;
+	}
+	if (bRecentHostLookupUnsupported)
+	{
+		UE_LOG(LogMultiplayerSessions, Log, TEXT("The online subsystem can't look up sessions by id, connecting to recent host %s directly"), *SessionId);
+		JoiningSessionId.Reset();
+		JoinRecentHostDirectly(SessionId, ConnectString);
+		return;
+	}
+
+	if (!bWasSuccessful || !SearchResult.IsValid())
+	{
+		UE_LOG(LogMultiplayerSessions, Log, TEXT("Recent host %s is gone"), *SessionId);
+		FRecentHostsCache::Get().Forget(SessionId);
+		GhostSessions.RecordFailure(SessionId, EGhostSessionReason::SessionDoesNotExist);
+		JoiningSessionId.Reset();
+		CompleteJoinSession(EOnJoinSessionCompleteResult::SessionDoesNotExist);
+		return;
+	}
+
+	ReserveAndJoinSession(SearchResult, NumReservedSlots);
+}
+
+
+void UMultiplayerSessionsSubsystem::JoinRecentHostDirectly(const FString& SessionId, const FString& ConnectString)
+{
+	if (ConnectString.IsEmpty())
+	{
+		CompleteJoinSession(EOnJoinSessionCompleteResult::CouldNotRetrieveAddress);
+		return;
+	}
+
+	/// No session is joined, so there is no reservation beacon to ask either; the host's login decides
+	DirectJoinAddress = ConnectString;
+	ReservationToken.Reset();
+	TravelingSessionId = SessionId;
+	CompleteJoinSession(EOnJoinSessionCompleteResult::Success);
+}
+
+
+void UMultiplayerSessionsSubsystem::ReleaseSearchResults()
+{
+	if (LastSearchResults.IsValid())
+	{
+		UE_LOG(LogMultiplayerSessions, Verbose, TEXT("Released %d search results (%.1f KB)"), LastSearchResults->Num(), LastSearchResults->GetAllocatedSize() / 1024.0);
+		LastSearchResults.Reset();
+	}
 }
 
 
 void UMultiplayerSessionsSubsystem::OnJoinSessionComplete(FName SessionName, EOnJoinSessionCompleteResult::Type Result)
 {
+	MULTIPLAYERSESSIONS_HITCH_SCOPE(Callback, OnJoinSessionComplete);
+	MULTIPLAYERSESSIONS_TRACE_SCOPE(MultiplayerSessions_OnJoinSessionComplete);
+	MultiplayerSessionsTrace::TracePhase(TraceCorrelationId, TEXT("JoinSession"), EMultiplayerSessionsTraceEdge::End);
+
 	/// Fired off when joining a session is complete
 	if (SessionInterface)
 	{
 		/// Clear the delegate handle from the list of delegates
 		SessionInterface->ClearOnJoinSessionCompleteDelegate_Handle(JoinSessionCompleteDelegateHandle);
 	}
+	GetGameInstance()->GetTimerManager().ClearTimer(JoinTimeoutTimerHandle);
+
+	/// Joined a listing with no address to travel to; the session is no use, so leave it and fail the join
+	FString JoinedAddress;
+	if (Result == EOnJoinSessionCompleteResult::Success && !GetResolvedConnectString(JoinedAddress))
+	{
+		SessionInterface->DestroySession(SessionName);
+		Result = EOnJoinSessionCompleteResult::CouldNotRetrieveAddress;
+	}
+
+	/// A session that is gone stays out of the next searches; one that worked is forgiven
+	EGhostSessionReason GhostReason;
+	if (FGhostSessionCache::GetReason(Result, GhostReason))
+	{
+		GhostSessions.RecordFailure(JoiningSessionId, GhostReason);
+	}
+	else if (Result == EOnJoinSessionCompleteResult::Success)
+	{
+		GhostSessions.RecordSuccess(JoiningSessionId);
+		TravelingSessionId = JoiningSessionId;
+	}
+	JoiningSessionId.Reset();
+
+	/// A party member following the leader has no menu waiting for the result, so travel from here
+	if (bFollowingParty)
+	{
+		bFollowingParty = false;
+		if (Result == EOnJoinSessionCompleteResult::Success)
+		{
+			APlayerController* PlayerController = GetGameInstance()->GetFirstLocalPlayerController();
+			if (PlayerController)
+			{
+				MultiplayerSessionsTrace::TracePhase(TraceCorrelationId, TEXT("Travel"), EMultiplayerSessionsTraceEdge::Begin);
+				MULTIPLAYERSESSIONS_TRAVEL_HITCH_SCOPE(ClientTravel);
+				PlayerController->ClientTravel(BuildTravelURL(JoinedAddress), ETravelType::TRAVEL_Absolute);
+			}
+		}
+		else
+		{
+			UE_LOG(LogMultiplayerSessions, Warning, TEXT("Could not follow the party leader into the session (result %s)"), LexToString(Result));
+		}
+		return;
+	}
+
+	/// Hosts the player got into are the ones most worth listing next time
+	if (Result == EOnJoinSessionCompleteResult::Success && FRecentHostsCache::IsEnabled())
+	{
+		const FNamedOnlineSession* JoinedSession = SessionInterface ? SessionInterface->GetNamedSession(SessionName) : nullptr;
+		if (JoinedSession)
+		{
+			FRecentHostsCache::Get().RecordHost(*JoinedSession, 0, JoinedAddress, true);
+		}
+	}
+
+	/// The leader is in, bring the party along; their slots are already reserved
+	if (Result == EOnJoinSessionCompleteResult::Success && PendingPartyMembers.Num() > 0)
+	{
+		InvitePendingParty();
+	}
 	
 	/// Broadcast our own custom delegate
 	/// Broadcast the OnJoinSessionComplete delegate, passing in Result as the parameter
-	MultiplayerOnJoinSessionComplete.Broadcast(Result);
+	CompleteJoinSession(Result);
+}
+
+
+void UMultiplayerSessionsSubsystem::OnJoinTimeout()
+{
+	MULTIPLAYERSESSIONS_HITCH_SCOPE(Callback, OnJoinTimeout);
+	MultiplayerSessionsTrace::TracePhase(TraceCorrelationId, TEXT("JoinSession"), EMultiplayerSessionsTraceEdge::End);
+	UE_LOG(LogMultiplayerSessions, Warning, TEXT("Join of session %s got no answer in %.0f s, giving up"), *JoiningSessionId, MultiplayerSessionsJoin::Timeout);
+
+	/// A late answer is ignored, and whatever the backend set up for the join is torn down
+	if (SessionInterface)
+	{
+		SessionInterface->ClearOnJoinSessionCompleteDelegate_Handle(JoinSessionCompleteDelegateHandle);
+		SessionInterface->DestroySession(NAME_GameSession);
+	}
+
+	GhostSessions.RecordFailure(JoiningSessionId, EGhostSessionReason::Timeout);
+	JoiningSessionId.Reset();
+
+	if (bFollowingParty)
+	{
+		bFollowingParty = false;
+		return;
+	}
+	CompleteJoinSession(EOnJoinSessionCompleteResult::UnknownError);
+}
+
+
+void UMultiplayerSessionsSubsystem::InvitePendingParty()
+{
+	const ULocalPlayer* LocalPlayer = GetWorld()->GetFirstLocalPlayerFromController();
+	if (LocalPlayer == nullptr)
+	{
+		return;
+	}
+
+	MultiplayerSessionsTrace::TracePhase(TraceCorrelationId, TEXT("PartyInvite"), EMultiplayerSessionsTraceEdge::Instant);
+	if (!SessionInterface->SendSessionInviteToFriends(LocalPlayer->GetControllerId(), NAME_GameSession, PendingPartyMembers))
+	{
+		UE_LOG(LogMultiplayerSessions, Warning, TEXT("Could not invite %d party members to the session"), PendingPartyMembers.Num());
+	}
+	PendingPartyMembers.Reset();
+}
+
+
+void UMultiplayerSessionsSubsystem::OnSessionUserInviteAccepted(const bool bWasSuccessful, const int32 ControllerId, FUniqueNetIdPtr UserId, const FOnlineSessionSearchResult& InviteResult)
+{
+	MULTIPLAYERSESSIONS_HITCH_SCOPE(Callback, OnSessionUserInviteAccepted);
+	if (!bWasSuccessful || !InviteResult.IsValid())
+	{
+		return;
+	}
+
+	/// The invite carries the session, so the member joins it directly instead of searching
+	/// No reservation either: the leader's reservation holds a slot for this member's id
+	BeginTraceCorrelation(TEXT("PartyInviteAccepted"));
+	PendingPartyMembers.Reset();
+	ReservationToken.Reset();
+	bFollowingParty = true;
+	JoiningSessionId = InviteResult.GetSessionIdStr();
+	JoinReservedSession(InviteResult);
 }
 
 
 void UMultiplayerSessionsSubsystem::OnDestroySessionComplete(FName SessionName, bool bWasSuccessful)
 {
+	MULTIPLAYERSESSIONS_HITCH_SCOPE(Callback, OnDestroySessionComplete);
+	MULTIPLAYERSESSIONS_TRACE_SCOPE(MultiplayerSessions_OnDestroySessionComplete);
+	MultiplayerSessionsTrace::TracePhase(TraceCorrelationId, TEXT("DestroySession"), EMultiplayerSessionsTraceEdge::End);
+
 	if (SessionInterface)
 	{
 		SessionInterface->ClearOnDestroySessionCompleteDelegate_Handle(DestroySessionCompleteDelegateHandle);
 	}
-	if (bWasSuccessful && bCreateSessionOnDestroy)
+	if (bCreateSessionOnDestroy)
 	{
+		/// This destroy was the first half of a create; it completes when the create does
 		bCreateSessionOnDestroy = false;
-		CreateSession(LastNumPublicConnections, LastMatchType);
+		if (bWasSuccessful)
+		{
+			CreateSession(LastNumPublicConnections, LastMatchType);
+		}
+		else
+		{
+			CompleteCreateSession(false);
+		}
 	}
-	MultiplayerOnDestroySessionComplete.Broadcast(bWasSuccessful);
+	CompleteDestroySession(bWasSuccessful);
 }
 
 
@@ -307,3 +1755,265 @@ void UMultiplayerSessionsSubsystem::OnStartSessionComplete(FName SessionName, bo
 {
 
 }
+
+
+void UMultiplayerSessionsSubsystem::OnPreLoadMap(const FString& MapName)
+{
+	MULTIPLAYERSESSIONS_HITCH_SCOPE(Callback, OnPreLoadMap);
+	/// Travel ends when the new map starts loading: connecting to the host on a client, the old world's teardown on a host
+	MultiplayerSessionsTrace::TracePhase(TraceCorrelationId, TEXT("Travel"), EMultiplayerSessionsTraceEdge::End);
+	MultiplayerSessionsTrace::TracePhase(TraceCorrelationId, TEXT("LoadMap"), EMultiplayerSessionsTraceEdge::Begin);
+	MultiplayerSessionsHitchWatchdog::BeginLoadMap();
+
+	/// Nothing on the next map shows the results, and the load needs the memory more
+	ReleaseSearchResults();
+
+	/// Hosts seen or joined just now are on disk before the next map, whatever happens to the process there
+	if (FRecentHostsCache::IsEnabled())
+	{
+		FRecentHostsCache::Get().Save();
+	}
+}
+
+
+void UMultiplayerSessionsSubsystem::OnPostLoadMapWithWorld(UWorld* LoadedWorld)
+{
+	MULTIPLAYERSESSIONS_HITCH_SCOPE(Callback, OnPostLoadMapWithWorld);
+	MultiplayerSessionsTrace::TracePhase(TraceCorrelationId, TEXT("LoadMap"), EMultiplayerSessionsTraceEdge::End);
+	MultiplayerSessionsHitchWatchdog::EndLoadMap();
+
+	/// Connected to the joined host
+	if (LoadedWorld && LoadedWorld->GetNetMode() == NM_Client)
+	{
+		TravelingSessionId.Reset();
+		DirectJoinAddress.Reset();
+	}
+
+	if (MigrationRole == EHostMigrationRole::None || LoadedWorld == nullptr)
+	{
+		return;
+	}
+
+	/// Back on the entry map after losing the host: time to act on our role
+	if (bMigrationWaitingForEntryMap)
+	{
+		bMigrationWaitingForEntryMap = false;
+		AssumeMigrationRole();
+		return;
+	}
+
+	/// In the new lobby, hosting it or connected to it
+	const ENetMode NetMode = LoadedWorld->GetNetMode();
+	if ((MigrationRole == EHostMigrationRole::Successor && NetMode == NM_ListenServer)
+		|| (MigrationRole == EHostMigrationRole::Follower && NetMode == NM_Client))
+	{
+		FinishHostMigration(true);
+	}
+}
+
+
+void UMultiplayerSessionsSubsystem::SetHostSuccessors(const TArray<FHostMigrationSuccessor>& Successors, const FHostMigrationSession& Session)
+{
+	HostSuccessors = Successors;
+	HostSession = Session;
+
+	/// The lobby is the map we are on when the host sends the list; the successor hosts the same one
+	LobbyMapPath = UWorld::RemovePIEPrefix(GetWorld()->GetOutermost()->GetName());
+}
+
+
+FHostMigrationSession UMultiplayerSessionsSubsystem::GetHostMigrationSession() const
+{
+	FHostMigrationSession Session;
+	if (const FOnlineSessionSettings* SessionSettings = GetCurrentSessionSettings())
+	{
+		Session.NumPublicConnections = SessionSettings->NumPublicConnections;
+		FSessionAttributes::Read(*SessionSettings, Session.Attributes);
+	}
+	return Session;
+}
+
+
+void UMultiplayerSessionsSubsystem::OnNetworkFailure(UWorld* World, UNetDriver* NetDriver, ENetworkFailure::Type FailureType, const FString& ErrorString)
+{
+	MULTIPLAYERSESSIONS_HITCH_SCOPE(Callback, OnNetworkFailure);
+	/// Mid-migration, any failure is the successor not answering yet
+	if (MigrationRole == EHostMigrationRole::Follower && !bMigrationWaitingForEntryMap)
+	{
+		OnFollowAttemptFailed();
+		return;
+	}
+
+	/// The session was joined, but its host never answered the connection: it is most likely gone.
+	/// A host that answered and refused the login (NMT_Failure: lobby full, reservation expired) is alive and isn't blamed.
+	const bool bHostNeverAnswered = FailureType == ENetworkFailure::ConnectionTimeout
+		|| (FailureType == ENetworkFailure::PendingConnectionFailure && NetDriver && NetDriver->ServerConnection && NetDriver->ServerConnection->InTotalPackets == 0);
+	if (!TravelingSessionId.IsEmpty() && bHostNeverAnswered)
+	{
+		GhostSessions.RecordFailure(TravelingSessionId, EGhostSessionReason::Timeout);
+		TravelingSessionId.Reset();
+	}
+
+	/// Only losing the connection to the host counts; being kicked or banned doesn't
+	const bool bLostHost = FailureType == ENetworkFailure::ConnectionLost || FailureType == ENetworkFailure::ConnectionTimeout;
+	if (!MultiplayerSessionsHostMigration::bEnabled || !bLostHost || MigrationRole != EHostMigrationRole::None
+		|| World == nullptr || World->GetNetMode() != NM_Client || NetDriver == nullptr || NetDriver->NetDriverName != NAME_GameNetDriver
+		|| HostSuccessors.Num() == 0)
+	{
+		return;
+	}
+
+	UE_LOG(LogMultiplayerSessions, Log, TEXT("Lost the host (%s), migrating the lobby to one of %d successors"), *ErrorString, HostSuccessors.Num());
+
+	/// The host sent its session with the list; a follower of an earlier migration never joined one of its own to read.
+	/// Our own copy of the session is the fallback for a host that sent nothing.
+	FHostMigrationSession Session = HostSession.NumPublicConnections > 0 ? HostSession : GetHostMigrationSession();
+	MigratedNumPublicConnections = Session.NumPublicConnections > 0 ? Session.NumPublicConnections : HostSuccessors.Num() + 1;
+	MigratedMatchType = LexToString(FSessionAttributes::Unpack(Session.Attributes).MatchType);
+
+	BeginTraceCorrelation(TEXT("HostMigration"));
+	MultiplayerSessionsTrace::TracePhase(TraceCorrelationId, TEXT("HostMigration"), EMultiplayerSessionsTraceEdge::Begin);
+	MigrationStartTime = FPlatformTime::Seconds();
+	MigrationSuccessorIndex = 0;
+	MigrationAttempts = 0;
+	ReservationToken.Reset();
+
+	/// The role is known now, but acting on it waits for the engine's trip back to the default map
+	MigrationRole = EHostMigrationRole::Follower;
+	bMigrationWaitingForEntryMap = true;
+}
+
+
+void UMultiplayerSessionsSubsystem::OnTravelFailure(UWorld* World, ETravelFailure::Type FailureType, const FString& ErrorString)
+{
+	MULTIPLAYERSESSIONS_HITCH_SCOPE(Callback, OnTravelFailure);
+
+	/// A load that failed partway still blocked the game thread until here; a travel that never got to load times nothing
+	MultiplayerSessionsHitchWatchdog::EndLoadMap();
+
+	if (MigrationRole == EHostMigrationRole::Follower && !bMigrationWaitingForEntryMap)
+	{
+		OnFollowAttemptFailed();
+	}
+}
+
+
+void UMultiplayerSessionsSubsystem::AssumeMigrationRole()
+{
+	if (!HostSuccessors.IsValidIndex(MigrationSuccessorIndex))
+	{
+		FinishHostMigration(false);
+		return;
+	}
+
+	SuccessorStartTime = FPlatformTime::Seconds();
+	const ULocalPlayer* LocalPlayer = GetGameInstance()->GetFirstGamePlayer();
+	const bool bIsSuccessor = LocalPlayer && HostSuccessors[MigrationSuccessorIndex].PlayerId == LocalPlayer->GetPreferredUniqueNetId();
+
+	UE_LOG(LogMultiplayerSessions, Log, TEXT("Host migration: successor %d is %s"), MigrationSuccessorIndex,
+		bIsSuccessor ? TEXT("us, hosting the lobby") : *HostSuccessors[MigrationSuccessorIndex].ConnectString);
+
+	if (bIsSuccessor)
+	{
+		MigrationRole = EHostMigrationRole::Successor;
+		RecreateMigratedSession();
+		return;
+	}
+
+	/// The old session is gone with its host; drop our side of it so later joins don't trip over it
+	MigrationRole = EHostMigrationRole::Follower;
+	if (ResolveSessionInterface() && SessionInterface->GetNamedSession(NAME_GameSession))
+	{
+		SessionInterface->DestroySession(NAME_GameSession);
+	}
+
+	/// Give the successor a head start on creating the session and loading the map
+	GetGameInstance()->GetTimerManager().SetTimer(MigrationTimerHandle, this, &ThisClass::FollowSuccessor, MultiplayerSessionsHostMigration::FollowDelay, false);
+}
+
+
+void UMultiplayerSessionsSubsystem::RecreateMigratedSession()
+{
+	GetGameInstance()->GetTimerManager().ClearTimer(MigrationTimerHandle);
+
+	/// CreateSession replaces the joined session we still hold, and continues in OnCreateSessionComplete
+	CreateSession(MigratedNumPublicConnections, MigratedMatchType);
+}
+
+
+void UMultiplayerSessionsSubsystem::FollowSuccessor()
+{
+	++MigrationAttempts;
+	MultiplayerSessionsTrace::TracePhase(TraceCorrelationId, TEXT("Travel"), EMultiplayerSessionsTraceEdge::Begin);
+	MULTIPLAYERSESSIONS_TRAVEL_HITCH_SCOPE(ClientTravel);
+	GEngine->SetClientTravel(GetWorld(), *BuildTravelURL(HostSuccessors[MigrationSuccessorIndex].ConnectString), TRAVEL_Absolute);
+
+	/// A successor that never answers doesn't always produce a failure, so the attempt is checked on either way
+	GetGameInstance()->GetTimerManager().SetTimer(MigrationTimerHandle, this, &ThisClass::OnFollowAttemptTimedOut, MultiplayerSessionsHostMigration::SuccessorTimeout * 0.5f, false);
+}
+
+
+void UMultiplayerSessionsSubsystem::OnFollowAttemptTimedOut()
+{
+	/// Travelling again would throw away a connection that may still succeed; a failed one reports itself
+	FWorldContext* WorldContext = GEngine->GetWorldContextFromWorld(GetWorld());
+	if (WorldContext && WorldContext->PendingNetGame)
+	{
+		if (FPlatformTime::Seconds() - SuccessorStartTime <= MultiplayerSessionsHostMigration::SuccessorTimeout)
+		{
+			GetGameInstance()->GetTimerManager().SetTimer(MigrationTimerHandle, this, &ThisClass::OnFollowAttemptTimedOut, MultiplayerSessionsHostMigration::FollowDelay, false);
+			return;
+		}
+		GEngine->CancelPending(*WorldContext);
+	}
+
+	OnFollowAttemptFailed();
+}
+
+
+void UMultiplayerSessionsSubsystem::OnFollowAttemptFailed()
+{
+	FTimerManager& TimerManager = GetGameInstance()->GetTimerManager();
+
+	/// This successor had its chance; maybe it quit too, so the next one in line takes over
+	if (FPlatformTime::Seconds() - SuccessorStartTime > MultiplayerSessionsHostMigration::SuccessorTimeout)
+	{
+		++MigrationSuccessorIndex;
+		TimerManager.ClearTimer(MigrationTimerHandle);
+		AssumeMigrationRole();
+		return;
+	}
+
+	TimerManager.SetTimer(MigrationTimerHandle, this, &ThisClass::FollowSuccessor, MultiplayerSessionsHostMigration::FollowDelay, false);
+}
+
+
+void UMultiplayerSessionsSubsystem::FinishHostMigration(bool bSucceeded)
+{
+	using namespace MultiplayerSessionsHostMigration;
+
+	GetGameInstance()->GetTimerManager().ClearTimer(MigrationTimerHandle);
+	MultiplayerSessionsTrace::TracePhase(TraceCorrelationId, TEXT("HostMigration"), EMultiplayerSessionsTraceEdge::End);
+
+	const double Downtime = FPlatformTime::Seconds() - MigrationStartTime;
+	(bSucceeded ? NumSucceeded : NumFailed)++;
+	TotalDowntime += Downtime;
+	MaxDowntime = FMath::Max(MaxDowntime, Downtime);
+
+	UE_LOG(LogMultiplayerSessions, Log, TEXT("Host migration %s as %s after %.0f ms (successor %d, %d connect attempts)"),
+		bSucceeded ? TEXT("succeeded") : TEXT("failed"),
+		MigrationRole == EHostMigrationRole::Successor ? TEXT("the new host") : TEXT("a follower"),
+		Downtime * 1000.0, MigrationSuccessorIndex, MigrationAttempts);
+
+	/// The new host sends its own list once we are in
+	MigrationRole = EHostMigrationRole::None;
+	bMigrationWaitingForEntryMap = false;
+	HostSuccessors.Reset();
+	HostSession = FHostMigrationSession();
+
+	/// Nobody could take over; the player is on the main menu and can search again
+	if (!bSucceeded)
+	{
+		MultiplayerSessionsHitchWatchdog::Broadcast(TEXT("MultiplayerOnJoinSessionComplete"), MultiplayerOnJoinSessionComplete, EOnJoinSessionCompleteResult::UnknownError);
+	}
+}
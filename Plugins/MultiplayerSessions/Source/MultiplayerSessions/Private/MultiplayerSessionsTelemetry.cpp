@@ -0,0 +1,366 @@
+/// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MultiplayerSessionsTelemetry.h"
+#include "MultiplayerSessions.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+#include "Policies/CondensedJsonPrintPolicy.h"
+
+namespace MultiplayerSessionsTelemetry
+{
+	static int32 bEnabled = 1;
+	static FAutoConsoleVariableRef CVarEnabled(
+		TEXT("MultiplayerSessions.Telemetry.Enable"),
+		bEnabled,
+		TEXT("Record time-to-lobby phases of every host/join to Saved/Telemetry/TimeToLobby.jsonl."));
+
+	static FAutoConsoleCommand CmdReport(
+		TEXT("MultiplayerSessions.Telemetry.Report"),
+		TEXT("Logs where time-to-lobby goes across all recorded joins. Optional argument: path of the record file to read."),
+		FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+		{
+			FMultiplayerSessionsTelemetry::Get().Flush();
+			FMultiplayerSessionsTelemetry::Report(Args.Num() > 0 ? Args[0] : FMultiplayerSessionsTelemetry::GetRecordFilename());
+		}));
+
+	/// Name the report uses for time that no phase accounts for
+	static const TCHAR* GapName = TEXT("(between phases)");
+
+	/// Value at Percentile (0..1) of already sorted Values
+	static double GetPercentile(const TArray<double>& SortedValues, double Percentile)
+	{
+		if (SortedValues.Num() == 0)
+		{
+			return 0.0;
+		}
+		const int32 Index = FMath::Clamp(FMath::CeilToInt(Percentile * SortedValues.Num()) - 1, 0, SortedValues.Num() - 1);
+		return SortedValues[Index];
+	}
+
+	/// Logs count/mean/p50/p95/max for every named series, sorted by total time, with the share of TotalMs
+	static void LogSeries(TMap<FString, TArray<double>>& Series, double TotalMs)
+	{
+		Series.ValueSort([](const TArray<double>& A, const TArray<double>& B)
+		{
+			double SumA = 0.0;
+			double SumB = 0.0;
+			for (double Value : A) { SumA += Value; }
+			for (double Value : B) { SumB += Value; }
+			return SumA > SumB;
+		});
+
+		UE_LOG(LogMultiplayerSessions, Display, TEXT("  %-28s %7s %10s %10s %10s %10s %7s"), TEXT("Phase"), TEXT("Count"), TEXT("Mean ms"), TEXT("P50 ms"), TEXT("P95 ms"), TEXT("Max ms"), TEXT("Share"));
+		for (TPair<FString, TArray<double>>& Pair : Series)
+		{
+			TArray<double>& Values = Pair.Value;
+			Values.Sort();
+
+			double Sum = 0.0;
+			for (double Value : Values)
+			{
+				Sum += Value;
+			}
+
+			UE_LOG(LogMultiplayerSessions, Display, TEXT("  %-28s %7d %10.1f %10.1f %10.1f %10.1f %6.1f%%"),
+				*Pair.Key,
+				Values.Num(),
+				Sum / Values.Num(),
+				GetPercentile(Values, 0.5),
+				GetPercentile(Values, 0.95),
+				Values.Last(),
+				TotalMs > 0.0 ? 100.0 * Sum / TotalMs : 0.0);
+		}
+	}
+}
+
+const TCHAR* FMultiplayerSessionsTelemetry::ServerLoginTrigger = TEXT("ServerLogin");
+
+
+FMultiplayerSessionsTelemetry& FMultiplayerSessionsTelemetry::Get()
+{
+	static FMultiplayerSessionsTelemetry Telemetry;
+	return Telemetry;
+}
+
+
+FString FMultiplayerSessionsTelemetry::GetRecordFilename()
+{
+	return FPaths::ProjectSavedDir() / TEXT("Telemetry") / TEXT("TimeToLobby.jsonl");
+}
+
+
+void FMultiplayerSessionsTelemetry::BeginFlow(const FGuid& CorrelationId, const TCHAR* Trigger)
+{
+	if (!MultiplayerSessionsTelemetry::bEnabled || !CorrelationId.IsValid() || Flows.Contains(CorrelationId))
+	{
+		return;
+	}
+
+	/// A process only ever has one flow of its own in progress; an unfinished one means the player gave up or it failed
+	const bool bIsLocalFlow = FCString::Strcmp(Trigger, ServerLoginTrigger) != 0;
+	if (bIsLocalFlow)
+	{
+		if (Flows.Contains(LocalFlowId))
+		{
+			EndFlow(LocalFlowId, TEXT("Abandoned"));
+		}
+		LocalFlowId = CorrelationId;
+	}
+
+	FFlow& Flow = Flows.Add(CorrelationId);
+	Flow.Trigger = Trigger;
+	Flow.StartTime = FPlatformTime::Seconds();
+	Flow.StartDateTime = FDateTime::UtcNow();
+}
+
+
+void FMultiplayerSessionsTelemetry::RecordPhase(const FGuid& CorrelationId, const TCHAR* Phase, EMultiplayerSessionsTraceEdge Edge)
+{
+	FFlow* Flow = Flows.Find(CorrelationId);
+	if (Flow == nullptr)
+	{
+		return;
+	}
+
+	const double Now = FPlatformTime::Seconds();
+	switch (Edge)
+	{
+	case EMultiplayerSessionsTraceEdge::Begin:
+		Flow->Phases.Add({ Phase, Now, -1.0 });
+		break;
+
+	case EMultiplayerSessionsTraceEdge::End:
+		/// Close the most recent open phase of that name; an end without a begin (e.g. a load that started before the flow) is dropped
+		for (int32 Index = Flow->Phases.Num() - 1; Index >= 0; --Index)
+		{
+			FPhase& OpenPhase = Flow->Phases[Index];
+			if (OpenPhase.EndTime < 0.0 && OpenPhase.Name == Phase)
+			{
+				OpenPhase.EndTime = Now;
+				break;
+			}
+		}
+		break;
+
+	case EMultiplayerSessionsTraceEdge::Instant:
+		Flow->Phases.Add({ Phase, Now, Now });
+		break;
+	}
+}
+
+
+void FMultiplayerSessionsTelemetry::EndFlow(const FGuid& CorrelationId, const TCHAR* Result)
+{
+	FFlow Flow;
+	if (!Flows.RemoveAndCopyValue(CorrelationId, Flow))
+	{
+		return;
+	}
+
+	const double EndTime = FPlatformTime::Seconds();
+	UE_LOG(LogMultiplayerSessions, Log, TEXT("Time-to-lobby %s: %s -> %s in %.1f ms"),
+		*CorrelationId.ToString(EGuidFormats::Digits), *Flow.Trigger, Result, (EndTime - Flow.StartTime) * 1000.0);
+
+	/// A join ends in the middle of gameplay, so the JSON and the file append stay off the game thread
+	auto Write = [CorrelationId, Flow = MoveTemp(Flow), Result = FString(Result), EndTime]()
+	{
+		WriteRecord(CorrelationId, Flow, Result, EndTime);
+	};
+	PendingWrite = PendingWrite.IsValid()
+		? UE::Tasks::Launch(UE_SOURCE_LOCATION, MoveTemp(Write), UE::Tasks::Prerequisites(PendingWrite), UE::Tasks::ETaskPriority::BackgroundNormal)
+		: UE::Tasks::Launch(UE_SOURCE_LOCATION, MoveTemp(Write), UE::Tasks::ETaskPriority::BackgroundNormal);
+}
+
+
+void FMultiplayerSessionsTelemetry::Flush()
+{
+	if (PendingWrite.IsValid())
+	{
+		PendingWrite.Wait();
+	}
+}
+
+
+void FMultiplayerSessionsTelemetry::WriteRecord(const FGuid& CorrelationId, const FFlow& Flow, const FString& Result, double EndTime)
+{
+	auto ToMilliseconds = [&Flow](double Time) { return (Time - Flow.StartTime) * 1000.0; };
+
+	/// Phases nest and overlap (the listen server logs its own player in while the map loads), so each slice of the
+	/// timeline is attributed to the innermost phase covering it. Self times then add up to the total exactly.
+	TArray<double> Boundaries = { Flow.StartTime, EndTime };
+	for (const FPhase& Phase : Flow.Phases)
+	{
+		Boundaries.Add(Phase.BeginTime);
+		Boundaries.Add(Phase.EndTime < 0.0 ? EndTime : Phase.EndTime);
+	}
+	Boundaries.Sort();
+
+	TArray<double> SelfTimes;
+	SelfTimes.SetNumZeroed(Flow.Phases.Num());
+	double GapTime = 0.0;
+	for (int32 Index = 1; Index < Boundaries.Num(); ++Index)
+	{
+		const double SliceBegin = Boundaries[Index - 1];
+		const double SliceEnd = Boundaries[Index];
+		if (SliceEnd <= SliceBegin)
+		{
+			continue;
+		}
+
+		int32 InnermostPhase = INDEX_NONE;
+		for (int32 PhaseIndex = 0; PhaseIndex < Flow.Phases.Num(); ++PhaseIndex)
+		{
+			const FPhase& Phase = Flow.Phases[PhaseIndex];
+			const double PhaseEnd = Phase.EndTime < 0.0 ? EndTime : Phase.EndTime;
+			if (Phase.BeginTime <= SliceBegin && PhaseEnd >= SliceEnd
+				&& (InnermostPhase == INDEX_NONE || Phase.BeginTime >= Flow.Phases[InnermostPhase].BeginTime))
+			{
+				InnermostPhase = PhaseIndex;
+			}
+		}
+
+		if (InnermostPhase == INDEX_NONE)
+		{
+			GapTime += SliceEnd - SliceBegin;
+		}
+		else
+		{
+			SelfTimes[InnermostPhase] += SliceEnd - SliceBegin;
+		}
+	}
+
+	TArray<TSharedPtr<FJsonValue>> PhaseValues;
+	for (int32 Index = 0; Index < Flow.Phases.Num(); ++Index)
+	{
+		const FPhase& Phase = Flow.Phases[Index];
+		TSharedRef<FJsonObject> PhaseObject = MakeShared<FJsonObject>();
+		PhaseObject->SetStringField(TEXT("name"), Phase.Name);
+		PhaseObject->SetNumberField(TEXT("begin_ms"), ToMilliseconds(Phase.BeginTime));
+		PhaseObject->SetNumberField(TEXT("end_ms"), ToMilliseconds(Phase.EndTime < 0.0 ? EndTime : Phase.EndTime));
+		PhaseObject->SetNumberField(TEXT("self_ms"), SelfTimes[Index] * 1000.0);
+		PhaseObject->SetBoolField(TEXT("closed"), Phase.EndTime >= 0.0);
+		PhaseValues.Add(MakeShared<FJsonValueObject>(PhaseObject));
+	}
+
+	TSharedRef<FJsonObject> Record = MakeShared<FJsonObject>();
+	Record->SetStringField(TEXT("id"), CorrelationId.ToString(EGuidFormats::Digits));
+	Record->SetStringField(TEXT("utc"), Flow.StartDateTime.ToIso8601());
+	Record->SetStringField(TEXT("trigger"), Flow.Trigger);
+	Record->SetStringField(TEXT("result"), Result);
+	Record->SetNumberField(TEXT("total_ms"), ToMilliseconds(EndTime));
+	Record->SetNumberField(TEXT("gap_ms"), GapTime * 1000.0);
+	Record->SetArrayField(TEXT("phases"), PhaseValues);
+
+	FString Line;
+	TSharedRef<TJsonWriter<TCHAR, TCondensedJsonPrintPolicy<TCHAR>>> Writer = TJsonWriterFactory<TCHAR, TCondensedJsonPrintPolicy<TCHAR>>::Create(&Line);
+	FJsonSerializer::Serialize(Record, Writer);
+	Line += LINE_TERMINATOR;
+
+	FFileHelper::SaveStringToFile(Line, *GetRecordFilename(), FFileHelper::EEncodingOptions::ForceUTF8WithoutBOM, &IFileManager::Get(), FILEWRITE_Append);
+}
+
+
+void FMultiplayerSessionsTelemetry::Report(const FString& Filename)
+{
+	TArray<FString> Lines;
+	if (!FFileHelper::LoadFileToStringArray(Lines, *Filename))
+	{
+		UE_LOG(LogMultiplayerSessions, Warning, TEXT("No time-to-lobby records at %s"), *Filename);
+		return;
+	}
+
+	/// Client side: self time per phase of completed flows, from click to first possessed tick
+	TMap<FString, TArray<double>> ClientSelfTimes;
+	TArray<double> TotalTimes;
+	double TotalTimeSum = 0.0;
+	int32 NumAbandoned = 0;
+
+	/// Server side: duration of each phase of the server's record of the same joins
+	TMap<FString, TArray<double>> ServerDurations;
+	TSet<FString> ClientIds;
+	TSet<FString> ServerIds;
+
+	for (const FString& Line : Lines)
+	{
+		TSharedPtr<FJsonObject> Record;
+		TSharedRef<TJsonReader<TCHAR>> Reader = TJsonReaderFactory<TCHAR>::Create(Line);
+		if (Line.IsEmpty() || !FJsonSerializer::Deserialize(Reader, Record) || !Record.IsValid())
+		{
+			continue;
+		}
+
+		const FString Id = Record->GetStringField(TEXT("id"));
+		const bool bIsServerRecord = Record->GetStringField(TEXT("trigger")) == ServerLoginTrigger;
+		const TArray<TSharedPtr<FJsonValue>>& Phases = Record->GetArrayField(TEXT("phases"));
+
+		if (bIsServerRecord)
+		{
+			ServerIds.Add(Id);
+			for (const TSharedPtr<FJsonValue>& PhaseValue : Phases)
+			{
+				const TSharedPtr<FJsonObject>& Phase = PhaseValue->AsObject();
+				const double Duration = Phase->GetNumberField(TEXT("end_ms")) - Phase->GetNumberField(TEXT("begin_ms"));
+				if (Duration > 0.0)
+				{
+					ServerDurations.FindOrAdd(Phase->GetStringField(TEXT("name"))).Add(Duration);
+				}
+			}
+			continue;
+		}
+
+		if (Record->GetStringField(TEXT("result")) == TEXT("Abandoned"))
+		{
+			++NumAbandoned;
+			continue;
+		}
+
+		ClientIds.Add(Id);
+		const double TotalTime = Record->GetNumberField(TEXT("total_ms"));
+		TotalTimes.Add(TotalTime);
+		TotalTimeSum += TotalTime;
+
+		/// A phase can run more than once per join (e.g. a retried search), count it once per join
+		TMap<FString, double> RecordSelfTimes;
+		RecordSelfTimes.Add(MultiplayerSessionsTelemetry::GapName, Record->GetNumberField(TEXT("gap_ms")));
+		for (const TSharedPtr<FJsonValue>& PhaseValue : Phases)
+		{
+			const TSharedPtr<FJsonObject>& Phase = PhaseValue->AsObject();
+			RecordSelfTimes.FindOrAdd(Phase->GetStringField(TEXT("name"))) += Phase->GetNumberField(TEXT("self_ms"));
+		}
+		for (const TPair<FString, double>& Pair : RecordSelfTimes)
+		{
+			if (Pair.Value > 0.0)
+			{
+				ClientSelfTimes.FindOrAdd(Pair.Key).Add(Pair.Value);
+			}
+		}
+	}
+
+	TotalTimes.Sort();
+	UE_LOG(LogMultiplayerSessions, Display, TEXT("Time-to-lobby report for %s"), *Filename);
+	UE_LOG(LogMultiplayerSessions, Display, TEXT("  %d completed joins (%d abandoned), %d with a matching server record"),
+		TotalTimes.Num(), NumAbandoned, ClientIds.Intersect(ServerIds).Num());
+
+	if (TotalTimes.Num() > 0)
+	{
+		UE_LOG(LogMultiplayerSessions, Display, TEXT("  Total: mean %.1f ms, p50 %.1f ms, p95 %.1f ms, max %.1f ms"),
+			TotalTimeSum / TotalTimes.Num(),
+			MultiplayerSessionsTelemetry::GetPercentile(TotalTimes, 0.5),
+			MultiplayerSessionsTelemetry::GetPercentile(TotalTimes, 0.95),
+			TotalTimes.Last());
+		UE_LOG(LogMultiplayerSessions, Display, TEXT("Client, self time per phase (share of all time-to-lobby):"));
+		MultiplayerSessionsTelemetry::LogSeries(ClientSelfTimes, TotalTimeSum);
+	}
+
+	if (ServerDurations.Num() > 0)
+	{
+		UE_LOG(LogMultiplayerSessions, Display, TEXT("Server, phase durations (share of all time-to-lobby):"));
+		MultiplayerSessionsTelemetry::LogSeries(ServerDurations, TotalTimeSum);
+	}
+}
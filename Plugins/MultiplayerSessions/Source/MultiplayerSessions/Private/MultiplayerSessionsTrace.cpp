@@ -0,0 +1,60 @@
+/// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MultiplayerSessionsTrace.h"
+#include "MultiplayerSessions.h"
+#include "MultiplayerSessionsTelemetry.h"
+#include "Kismet/GameplayStatics.h"
+
+UE_TRACE_CHANNEL_DEFINE(MultiplayerSessionsChannel);
+
+/// Timing event read by analyzers; the bookmark below makes the same information visible in Timing Insights as is
+UE_TRACE_EVENT_BEGIN(MultiplayerSessions, JoinPhase)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(uint8, Edge)
+	UE_TRACE_EVENT_FIELD(UE::Trace::WideString, Phase)
+	UE_TRACE_EVENT_FIELD(UE::Trace::WideString, CorrelationId)
+UE_TRACE_EVENT_END()
+
+namespace MultiplayerSessionsTrace
+{
+	const TCHAR* CorrelationIdOption = TEXT("MSCorrelationId");
+
+	void TracePhase(const FGuid& CorrelationId, const TCHAR* Phase, EMultiplayerSessionsTraceEdge Edge)
+	{
+		/// Time-to-lobby telemetry is recorded whether or not a trace is running
+		FMultiplayerSessionsTelemetry::Get().RecordPhase(CorrelationId, Phase, Edge);
+
+		if (!UE_TRACE_CHANNELEXPR_IS_ENABLED(MultiplayerSessionsChannel))
+		{
+			return;
+		}
+
+		const FString CorrelationIdString = CorrelationId.ToString(EGuidFormats::Digits);
+
+		UE_TRACE_LOG(MultiplayerSessions, JoinPhase, MultiplayerSessionsChannel)
+			<< JoinPhase.Cycle(FPlatformTime::Cycles64())
+			<< JoinPhase.Edge(static_cast<uint8>(Edge))
+			<< JoinPhase.Phase(Phase, FCString::Strlen(Phase))
+			<< JoinPhase.CorrelationId(*CorrelationIdString, CorrelationIdString.Len());
+
+		static const TCHAR* EdgeNames[] = { TEXT("Begin"), TEXT("End"), TEXT("") };
+		TRACE_BOOKMARK(TEXT("MS %s %s [%s]"), Phase, EdgeNames[static_cast<uint8>(Edge)], *CorrelationIdString);
+	}
+
+	FString AddCorrelationIdToURL(const FString& URL, const FGuid& CorrelationId)
+	{
+		if (!CorrelationId.IsValid())
+		{
+			return URL;
+		}
+		return FString::Printf(TEXT("%s?%s=%s"), *URL, CorrelationIdOption, *CorrelationId.ToString(EGuidFormats::Digits));
+	}
+
+	FGuid ParseCorrelationId(const FString& Options)
+	{
+		FGuid CorrelationId;
+		FGuid::Parse(UGameplayStatics::ParseOption(Options, CorrelationIdOption), CorrelationId);
+		return CorrelationId;
+	}
+}
@@ -0,0 +1,439 @@
+/// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "RecentHostsCache.h"
+#include "SessionResultStore.h"
+#include "SessionQosProber.h"
+#include "MultiplayerSessions.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "HAL/FileManager.h"
+#include "Async/MappedFileHandle.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Tasks/Task.h"
+
+namespace MultiplayerSessionsRecentHosts
+{
+	static int32 bEnabled = 1;
+	static FAutoConsoleVariableRef CVarEnabled(
+		TEXT("MultiplayerSessions.RecentHosts.Enable"),
+		bEnabled,
+		TEXT("Remember recently seen and joined hosts on disk, to list and probe them before a search comes back."));
+
+	static int32 MaxEntries = 256;
+	static FAutoConsoleVariableRef CVarMaxEntries(
+		TEXT("MultiplayerSessions.RecentHosts.MaxEntries"),
+		MaxEntries,
+		TEXT("Most hosts kept; the least recently seen are evicted first, hosts only seen in a search before joined ones."));
+
+	static int32 MaxAgeDays = 14;
+	static FAutoConsoleVariableRef CVarMaxAgeDays(
+		TEXT("MultiplayerSessions.RecentHosts.MaxAgeDays"),
+		MaxAgeDays,
+		TEXT("Days a host is kept after it was last seen."));
+
+	static int32 MaxPerSearch = 32;
+	static FAutoConsoleVariableRef CVarMaxPerSearch(
+		TEXT("MultiplayerSessions.RecentHosts.MaxPerSearch"),
+		MaxPerSearch,
+		TEXT("How many of a search's best results are remembered."));
+
+	static int32 NumPreProbe = 8;
+	static FAutoConsoleVariableRef CVarNumPreProbe(
+		TEXT("MultiplayerSessions.RecentHosts.NumPreProbe"),
+		NumPreProbe,
+		TEXT("How many of the most recent hosts are QoS probed while a search is running."));
+
+	/// Changes made within this many seconds are written together
+	static constexpr float SaveDelay = 5.f;
+
+	/// Leads the file; a file whose header doesn't match is ignored
+	struct FFileHeader
+	{
+		uint32 Magic;
+		uint32 Version;
+		uint32 RecordSize;
+		uint32 NumRecords;
+	};
+	static constexpr uint32 FileMagic = 0x4852534D; /// "MSRH"
+
+	/// Copies Source into Dest, cut at a character boundary to leave room for the terminator
+	template <int32 DestSize>
+	static void WriteString(ANSICHAR (&Dest)[DestSize], const FString& Source)
+	{
+		FTCHARToUTF8 Converted(*Source);
+		int32 Length = FMath::Min(Converted.Length(), DestSize - 1);
+		while (Length > 0 && Length < Converted.Length() && (Converted.Get()[Length] & 0xC0) == 0x80)
+		{
+			--Length;
+		}
+		FMemory::Memcpy(Dest, Converted.Get(), Length);
+		FMemory::Memzero(Dest + Length, DestSize - Length);
+	}
+
+	/// A record read from disk isn't trusted to be terminated
+	template <int32 SourceSize>
+	static FString ReadString(const ANSICHAR (&Source)[SourceSize])
+	{
+		int32 Length = 0;
+		while (Length < SourceSize && Source[Length] != 0)
+		{
+			++Length;
+		}
+		FUTF8ToTCHAR Converted(Source, Length);
+		return FString(Converted.Length(), Converted.Get());
+	}
+}
+
+static_assert(sizeof(FRecentHostRecord) == 256, "FRecentHostRecord is written to disk as is; bump FRecentHostsCache::FileVersion when it changes");
+
+const FName FRecentHostsCache::SessionIdSettingKey(TEXT("RecentHostSessionId"));
+const FName FRecentHostsCache::ConnectStringSettingKey(TEXT("RecentHostConnectString"));
+
+FRecentHostsCache& FRecentHostsCache::Get()
+{
+	static FRecentHostsCache Cache;
+	return Cache;
+}
+
+FRecentHostsCache::~FRecentHostsCache()
+{
+	if (PendingSave.IsValid())
+	{
+		PendingSave.Wait();
+	}
+	Unmap();
+}
+
+bool FRecentHostsCache::IsEnabled()
+{
+	return MultiplayerSessionsRecentHosts::bEnabled != 0;
+}
+
+int32 FRecentHostsCache::GetNumToPreProbe()
+{
+	return FMath::Max(MultiplayerSessionsRecentHosts::NumPreProbe, 0);
+}
+
+int32 FRecentHostsCache::GetMaxPerSearch()
+{
+	return FMath::Max(MultiplayerSessionsRecentHosts::MaxPerSearch, 0);
+}
+
+FString FRecentHostsCache::GetFilename()
+{
+	return FPaths::ProjectSavedDir() / TEXT("MultiplayerSessions") / TEXT("RecentHosts.bin");
+}
+
+TArrayView<const FRecentHostRecord> FRecentHostsCache::GetRecords() const
+{
+	if (MappedRegion.IsValid())
+	{
+		return TArrayView<const FRecentHostRecord>(MappedRecords, NumMappedRecords);
+	}
+	return OwnedRecords;
+}
+
+void FRecentHostsCache::Load()
+{
+	using namespace MultiplayerSessionsRecentHosts;
+
+	if (bLoaded)
+	{
+		return;
+	}
+	bLoaded = true;
+
+	const double StartTime = FPlatformTime::Seconds();
+	const FString Filename = GetFilename();
+
+	auto IsValidHeader = [](const uint8* Data, int64 Size)
+	{
+		if (Size < static_cast<int64>(sizeof(FFileHeader)))
+		{
+			return false;
+		}
+		const FFileHeader& Header = *reinterpret_cast<const FFileHeader*>(Data);
+		return Header.Magic == FileMagic && Header.Version == FileVersion && Header.RecordSize == sizeof(FRecentHostRecord)
+			&& Size >= static_cast<int64>(sizeof(FFileHeader) + static_cast<int64>(Header.NumRecords) * sizeof(FRecentHostRecord));
+	};
+
+	/// Mapped, the records are only paged in as they are read
+	MappedFile.Reset(FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*Filename));
+	if (MappedFile.IsValid())
+	{
+		MappedRegion.Reset(MappedFile->MapRegion(0, MappedFile->GetFileSize()));
+		if (MappedRegion.IsValid() && IsValidHeader(MappedRegion->GetMappedPtr(), MappedRegion->GetMappedSize()))
+		{
+			MappedRecords = reinterpret_cast<const FRecentHostRecord*>(MappedRegion->GetMappedPtr() + sizeof(FFileHeader));
+			NumMappedRecords = reinterpret_cast<const FFileHeader*>(MappedRegion->GetMappedPtr())->NumRecords;
+		}
+		else
+		{
+			Unmap();
+		}
+	}
+
+	/// Platforms without mapping (and files that are missing or from another version) fall back to reading
+	if (!MappedRegion.IsValid())
+	{
+		TArray<uint8> Bytes;
+		if (FFileHelper::LoadFileToArray(Bytes, *Filename, FILEREAD_Silent) && IsValidHeader(Bytes.GetData(), Bytes.Num()))
+		{
+			const int32 NumRecords = reinterpret_cast<const FFileHeader*>(Bytes.GetData())->NumRecords;
+			OwnedRecords.SetNumUninitialized(NumRecords);
+			FMemory::Memcpy(OwnedRecords.GetData(), Bytes.GetData() + sizeof(FFileHeader), NumRecords * sizeof(FRecentHostRecord));
+		}
+		else if (Bytes.Num() > 0)
+		{
+			UE_LOG(LogMultiplayerSessions, Log, TEXT("Recent hosts: ignoring %s, it is from another version"), *Filename);
+		}
+	}
+
+	UE_LOG(LogMultiplayerSessions, Log, TEXT("Recent hosts: %d loaded (%s) in %.2f ms"), GetRecords().Num(),
+		MappedRegion.IsValid() ? TEXT("mapped") : TEXT("read"), (FPlatformTime::Seconds() - StartTime) * 1000.0);
+}
+
+void FRecentHostsCache::RecordHost(const FOnlineSession& Session, int32 PingInMs, const FString& ConnectString, bool bJoined)
+{
+	if (!Session.SessionInfo.IsValid())
+	{
+		return;
+	}
+
+	Merge(Session, PingInMs, ConnectString, bJoined, FDateTime::UtcNow().ToUnixTimestamp());
+	MarkDirty();
+}
+
+void FRecentHostsCache::RecordHosts(const TArray<FOnlineSessionSearchResult>& Results, const TArray<FString>& ConnectStrings)
+{
+	const int64 Now = FDateTime::UtcNow().ToUnixTimestamp();
+	for (int32 Index = 0; Index < Results.Num(); ++Index)
+	{
+		if (Results[Index].Session.SessionInfo.IsValid())
+		{
+			Merge(Results[Index].Session, Results[Index].PingInMs, ConnectStrings.IsValidIndex(Index) ? ConnectStrings[Index] : FString(), false, Now);
+		}
+	}
+	MarkDirty();
+}
+
+void FRecentHostsCache::UpdatePing(const FString& SessionId, int32 PingInMs)
+{
+	const int32 Index = FindRecord(SessionId);
+	if (Index != INDEX_NONE && PingInMs > 0)
+	{
+		GetWritableRecords()[Index].PingInMs = PingInMs;
+	}
+}
+
+void FRecentHostsCache::Forget(const FString& SessionId)
+{
+	const int32 Index = FindRecord(SessionId);
+	if (Index != INDEX_NONE)
+	{
+		GetWritableRecords().RemoveAt(Index);
+		MarkDirty();
+	}
+}
+
+TSharedRef<FSessionResultStore> FRecentHostsCache::MakeResultStore(const TSet<FString>& ExcludedSessionIds) const
+{
+	TArrayView<const FRecentHostRecord> Records = GetRecords();
+
+	const FSessionAttributeFilter Compatible = FSessionAttributeFilter::MakeCompatible();
+	TArray<FOnlineSessionSearchResult> Results;
+	Results.Reserve(Records.Num());
+	for (const FRecentHostRecord& Record : Records)
+	{
+		if (!Compatible.Matches(Record.Attributes) || ExcludedSessionIds.Contains(GetSessionId(Record)))
+		{
+			continue;
+		}
+
+		FOnlineSessionSearchResult& Result = Results.AddDefaulted_GetRef();
+		Result.PingInMs = Record.PingInMs;
+
+		FOnlineSession& Session = Result.Session;
+		Session.OwningUserName = MultiplayerSessionsRecentHosts::ReadString(Record.OwningUserName);
+		Session.NumOpenPublicConnections = Record.NumOpenPublicConnections;
+		Session.SessionSettings.NumPublicConnections = Record.NumPublicConnections;
+		FSessionAttributes::Unpack(Record.Attributes).Write(Session.SessionSettings);
+		Session.SessionSettings.Set(SessionIdSettingKey, GetSessionId(Record), EOnlineDataAdvertisementType::DontAdvertise);
+		Session.SessionSettings.Set(ConnectStringSettingKey, GetConnectString(Record), EOnlineDataAdvertisementType::DontAdvertise);
+		if (Record.QosPort > 0)
+		{
+			Session.SessionSettings.Set(FSessionQosProber::PortSettingKey, Record.QosPort, EOnlineDataAdvertisementType::DontAdvertise);
+		}
+	}
+	return MakeShared<FSessionResultStore>(Results);
+}
+
+FString FRecentHostsCache::GetSessionId(const FRecentHostRecord& Record)
+{
+	return MultiplayerSessionsRecentHosts::ReadString(Record.SessionId);
+}
+
+FString FRecentHostsCache::GetConnectString(const FRecentHostRecord& Record)
+{
+	return MultiplayerSessionsRecentHosts::ReadString(Record.ConnectString);
+}
+
+void FRecentHostsCache::Merge(const FOnlineSession& Session, int32 PingInMs, const FString& ConnectString, bool bJoined, int64 Now)
+{
+	using namespace MultiplayerSessionsRecentHosts;
+
+	const FString SessionId = Session.SessionInfo->GetSessionId().ToString();
+	int32 Index = FindRecord(SessionId);
+	TArray<FRecentHostRecord>& Records = GetWritableRecords();
+	if (Index == INDEX_NONE)
+	{
+		Index = Records.AddZeroed();
+		WriteString(Records[Index].SessionId, SessionId);
+	}
+
+	FRecentHostRecord& Record = Records[Index];
+	WriteString(Record.OwningUserName, Session.OwningUserName);
+	FSessionAttributes::Read(Session.SessionSettings, Record.Attributes);
+
+	/// Keep what is known from before when this sighting didn't come with it
+	if (!ConnectString.IsEmpty())
+	{
+		WriteString(Record.ConnectString, ConnectString);
+	}
+	if (PingInMs > 0 && PingInMs < MAX_QUERY_PING)
+	{
+		Record.PingInMs = PingInMs;
+	}
+	int32 QosPort = 0;
+	if (Session.SessionSettings.Get(FSessionQosProber::PortSettingKey, QosPort))
+	{
+		Record.QosPort = QosPort;
+	}
+
+	Record.LastSeenUnixTime = Now;
+	Record.NumPublicConnections = static_cast<uint16>(FMath::Clamp(Session.SessionSettings.NumPublicConnections, 0, MAX_uint16));
+	Record.NumOpenPublicConnections = static_cast<uint16>(FMath::Clamp(Session.NumOpenPublicConnections, 0, MAX_uint16));
+	if (bJoined)
+	{
+		Record.Flags |= static_cast<uint32>(ERecentHostFlags::Joined);
+	}
+}
+
+TArray<FRecentHostRecord>& FRecentHostsCache::GetWritableRecords()
+{
+	if (MappedRegion.IsValid())
+	{
+		OwnedRecords = TArray<FRecentHostRecord>(MappedRecords, NumMappedRecords);
+		Unmap();
+	}
+	return OwnedRecords;
+}
+
+void FRecentHostsCache::MarkDirty()
+{
+	if (bDirty)
+	{
+		return;
+	}
+	bDirty = true;
+	SaveTickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda([this](float)
+	{
+		SaveTickerHandle.Reset();
+		Save();
+		return false;
+	}), MultiplayerSessionsRecentHosts::SaveDelay);
+}
+
+void FRecentHostsCache::Flush()
+{
+	Save();
+	if (PendingSave.IsValid())
+	{
+		PendingSave.Wait();
+	}
+}
+
+void FRecentHostsCache::Save()
+{
+	using namespace MultiplayerSessionsRecentHosts;
+
+	if (SaveTickerHandle.IsValid())
+	{
+		FTSTicker::GetCoreTicker().RemoveTicker(SaveTickerHandle);
+		SaveTickerHandle.Reset();
+	}
+	if (!bDirty)
+	{
+		return;
+	}
+	bDirty = false;
+
+	TArray<FRecentHostRecord>& Records = GetWritableRecords();
+
+	/// Most recently seen first, which is also the order the browser lists them in
+	const int64 OldestKept = FDateTime::UtcNow().ToUnixTimestamp() - static_cast<int64>(FMath::Max(MaxAgeDays, 0)) * 24 * 60 * 60;
+	Records.RemoveAll([OldestKept](const FRecentHostRecord& Record) { return Record.LastSeenUnixTime < OldestKept; });
+	Records.StableSort([](const FRecentHostRecord& A, const FRecentHostRecord& B) { return A.LastSeenUnixTime > B.LastSeenUnixTime; });
+
+	/// Evict from the oldest end, sparing joined hosts while there are others to evict
+	const int32 NumToKeep = FMath::Max(MaxEntries, 0);
+	for (int32 Index = Records.Num() - 1; Index >= 0 && Records.Num() > NumToKeep; --Index)
+	{
+		if (!(Records[Index].Flags & static_cast<uint32>(ERecentHostFlags::Joined)))
+		{
+			Records.RemoveAt(Index, 1, false);
+		}
+	}
+	if (Records.Num() > NumToKeep)
+	{
+		Records.SetNum(NumToKeep);
+	}
+
+	FFileHeader Header;
+	Header.Magic = FileMagic;
+	Header.Version = FileVersion;
+	Header.RecordSize = sizeof(FRecentHostRecord);
+	Header.NumRecords = Records.Num();
+
+	TArray<uint8> Bytes;
+	Bytes.Reserve(sizeof(FFileHeader) + Records.Num() * sizeof(FRecentHostRecord));
+	Bytes.Append(reinterpret_cast<const uint8*>(&Header), sizeof(FFileHeader));
+	Bytes.Append(reinterpret_cast<const uint8*>(Records.GetData()), Records.Num() * sizeof(FRecentHostRecord));
+
+	/// Written aside and moved over, so a crash mid-write leaves the old file; off the game thread, after the previous save
+	auto Write = [Bytes = MoveTemp(Bytes)]()
+	{
+		const FString Filename = GetFilename();
+		const FString TempFilename = Filename + TEXT(".tmp");
+		if (!FFileHelper::SaveArrayToFile(Bytes, *TempFilename) || !IFileManager::Get().Move(*Filename, *TempFilename, true, true))
+		{
+			UE_LOG(LogMultiplayerSessions, Warning, TEXT("Recent hosts: could not save %s"), *Filename);
+		}
+	};
+	PendingSave = PendingSave.IsValid()
+		? UE::Tasks::Launch(UE_SOURCE_LOCATION, MoveTemp(Write), UE::Tasks::Prerequisites(PendingSave), UE::Tasks::ETaskPriority::BackgroundNormal)
+		: UE::Tasks::Launch(UE_SOURCE_LOCATION, MoveTemp(Write), UE::Tasks::ETaskPriority::BackgroundNormal);
+}
+
+void FRecentHostsCache::Unmap()
+{
+	MappedRecords = nullptr;
+	NumMappedRecords = 0;
+	MappedRegion.Reset();
+	MappedFile.Reset();
+}
+
+int32 FRecentHostsCache::FindRecord(const FString& SessionId) const
+{
+	TArrayView<const FRecentHostRecord> Records = GetRecords();
+	for (int32 Index = 0; Index < Records.Num(); ++Index)
+	{
+		if (GetSessionId(Records[Index]) == SessionId)
+		{
+			return Index;
+		}
+	}
+	return INDEX_NONE;
+}
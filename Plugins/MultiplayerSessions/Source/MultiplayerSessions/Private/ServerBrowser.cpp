@@ -0,0 +1,356 @@
+/// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ServerBrowser.h"
+#include "Components/Button.h"
+#include "Components/ListView.h"
+#include "Components/TextBlock.h"
+#include "ServerBrowserItem.h"
+#include "ServerBrowserEntry.h"
+#include "SessionPingService.h"
+#include "MultiplayerSessionsSubsystem.h"
+#include "RecentHostsCache.h"
+#include "Engine/GameInstance.h"
+#include "MultiplayerSessionsTrace.h"
+
+namespace ServerBrowserSort
+{
+	/// Whether A is listed before B when sorting by Key
+	static bool IsBefore(const UServerBrowserItem& A, const UServerBrowserItem& B, EServerBrowserSortKey Key, bool bAscending)
+	{
+		int32 Compare = 0;
+		switch (Key)
+		{
+		case EServerBrowserSortKey::Ping:
+			Compare = A.PingInMs - B.PingInMs;
+			break;
+		case EServerBrowserSortKey::Players:
+			Compare = A.NumPlayers - B.NumPlayers;
+			break;
+		case EServerBrowserSortKey::MatchType:
+			Compare = A.MatchType.Compare(B.MatchType, ESearchCase::IgnoreCase);
+			break;
+		default:
+			break;
+		}
+
+		/// Equal rows keep the order they were found in, so re-sorting doesn't shuffle them
+		if (Compare == 0)
+		{
+			return A.ResultIndex < B.ResultIndex;
+		}
+		return bAscending ? Compare < 0 : Compare > 0;
+	}
+}
+
+bool UServerBrowser::Initialize()
+{
+	if (!Super::Initialize())
+	{
+		return false;
+	}
+
+	if (SessionList)
+	{
+		SessionList->OnItemDoubleClicked().AddUObject(this, &ThisClass::OnItemDoubleClicked);
+	}
+	if (SortByPingButton)
+	{
+		SortByPingButton->OnClicked.AddDynamic(this, &ThisClass::SortByPingClicked);
+	}
+	if (SortByPlayersButton)
+	{
+		SortByPlayersButton->OnClicked.AddDynamic(this, &ThisClass::SortByPlayersClicked);
+	}
+	if (SortByMatchTypeButton)
+	{
+		SortByMatchTypeButton->OnClicked.AddDynamic(this, &ThisClass::SortByMatchTypeClicked);
+	}
+	if (JoinSelectedButton)
+	{
+		JoinSelectedButton->OnClicked.AddDynamic(this, &ThisClass::JoinSelectedClicked);
+	}
+
+	return true;
+}
+
+void UServerBrowser::NativeConstruct()
+{
+	Super::NativeConstruct();
+
+	if (PingRefreshInterval > 0.f)
+	{
+		PingService = MakeShared<FSessionPingService>(MaxConcurrentPings, PingTimeToLive, PingTimeout);
+		PingService->OnPingUpdated.AddUObject(this, &ThisClass::OnPingUpdated);
+	}
+}
+
+void UServerBrowser::NativeDestruct()
+{
+	/// Probes still in flight hold a weak pointer, they are dropped when they come back
+	PingService.Reset();
+
+	Super::NativeDestruct();
+}
+
+void UServerBrowser::NativeTick(const FGeometry& MyGeometry, float InDeltaTime)
+{
+	Super::NativeTick(MyGeometry, InDeltaTime);
+
+	/// Spread creating the row objects over several frames
+	if (Items.Num() < NumSearchResults())
+	{
+		PopulateNextBatch();
+	}
+
+	if (PingService.IsValid())
+	{
+		TimeUntilPingRefresh -= InDeltaTime;
+		if (TimeUntilPingRefresh <= 0.f)
+		{
+			TimeUntilPingRefresh = PingRefreshInterval;
+			RefreshVisiblePings();
+		}
+	}
+}
+
+void UServerBrowser::SetSearchResults(const TSharedRef<FSessionResultStore>& InSearchResults)
+{
+	ClearSearchResults();
+	SearchResults = InSearchResults;
+
+	/// Show the first rows right away instead of an empty list for a frame
+	PopulateNextBatch();
+}
+
+void UServerBrowser::ClearSearchResults()
+{
+	/// Keep the row objects for the next search, a refresh would otherwise create and collect thousands of them
+	FreeItems.Append(Items);
+	Items.Reset();
+	ItemsBySessionId.Reset();
+	SearchResults.Reset();
+
+	if (PingService.IsValid())
+	{
+		PingService->CancelQueued();
+	}
+
+	if (SessionList)
+	{
+		SessionList->ClearListItems();
+	}
+	UpdateStatusText();
+}
+
+void UServerBrowser::SortBy(EServerBrowserSortKey Key)
+{
+	bSortAscending = Key == SortKey ? !bSortAscending : true;
+	SortKey = Key;
+	ApplySort();
+}
+
+void UServerBrowser::PopulateNextBatch()
+{
+	MULTIPLAYERSESSIONS_TRACE_SCOPE(ServerBrowser_PopulateNextBatch);
+
+	const int32 FirstIndex = Items.Num();
+	const int32 EndIndex = FMath::Min(FirstIndex + ItemsPerFrame, NumSearchResults());
+	TArray<UServerBrowserItem*> Batch;
+	Batch.Reserve(EndIndex - FirstIndex);
+	for (int32 Index = FirstIndex; Index < EndIndex; ++Index)
+	{
+		UServerBrowserItem* Item = FreeItems.Num() > 0 ? FreeItems.Pop(false) : NewObject<UServerBrowserItem>(this);
+		Item->ResultIndex = Index;
+		Item->SessionId = SearchResults->GetSessionIdStr(Index);
+		Item->OwningUserName = FString(SearchResults->GetOwningUserName(Index));
+		Item->MatchType = LexToString(SearchResults->GetAttributes(Index).MatchType);
+		Item->MaxPlayers = SearchResults->GetMaxPlayers(Index);
+		Item->NumPlayers = SearchResults->GetNumPlayers(Index);
+		Item->PingInMs = SearchResults->GetPingInMs(Index);
+		Batch.Add(Item);
+		ItemsBySessionId.Add(Item->SessionId, Item);
+
+		/// A ping measured for an earlier search is more recent than the one in the result
+		int32 CachedPingInMs;
+		if (PingService.IsValid() && PingService->GetCachedPing(Item->SessionId, CachedPingInMs) && CachedPingInMs != INDEX_NONE)
+		{
+			Item->PingInMs = CachedPingInMs;
+		}
+
+		/// Unsorted rows are shown in the order they were found
+		if (SortKey == EServerBrowserSortKey::None && SessionList)
+		{
+			SessionList->AddItem(Item);
+		}
+	}
+
+	if (SortKey == EServerBrowserSortKey::None)
+	{
+		Items.Append(Batch);
+		UpdateStatusText();
+		return;
+	}
+
+	/// Sorted rows: only the batch is sorted, then merged into the rows already sorted in one pass over the pointers.
+	/// The list view gets the merged array and only rebuilds the rows on screen.
+	const EServerBrowserSortKey Key = SortKey;
+	const bool bAscending = bSortAscending;
+	Batch.Sort([Key, bAscending](const UServerBrowserItem& A, const UServerBrowserItem& B) { return ServerBrowserSort::IsBefore(A, B, Key, bAscending); });
+
+	TArray<UServerBrowserItem*> Merged;
+	Merged.Reserve(Items.Num() + Batch.Num());
+	int32 ItemIndex = 0;
+	int32 BatchIndex = 0;
+	while (ItemIndex < Items.Num() || BatchIndex < Batch.Num())
+	{
+		const bool bTakeBatch = ItemIndex == Items.Num()
+			|| (BatchIndex < Batch.Num() && ServerBrowserSort::IsBefore(*Batch[BatchIndex], *Items[ItemIndex], Key, bAscending));
+		Merged.Add(bTakeBatch ? Batch[BatchIndex++] : Items[ItemIndex++]);
+	}
+	Items = MoveTemp(Merged);
+
+	if (SessionList)
+	{
+		SessionList->SetListItems(Items);
+	}
+	UpdateStatusText();
+}
+
+void UServerBrowser::ApplySort()
+{
+	MULTIPLAYERSESSIONS_TRACE_SCOPE(ServerBrowser_ApplySort);
+
+	if (SortKey != EServerBrowserSortKey::None)
+	{
+		const EServerBrowserSortKey Key = SortKey;
+		const bool bAscending = bSortAscending;
+		Items.Sort([Key, bAscending](const UServerBrowserItem& A, const UServerBrowserItem& B) { return ServerBrowserSort::IsBefore(A, B, Key, bAscending); });
+	}
+
+	if (SessionList)
+	{
+		SessionList->SetListItems(Items);
+	}
+}
+
+void UServerBrowser::UpdateStatusText()
+{
+	if (StatusText)
+	{
+		StatusText->SetText(FText::Format(FText::FromString(TEXT("Showing {0} of {1} sessions")), FText::AsNumber(Items.Num()), FText::AsNumber(NumSearchResults())));
+	}
+}
+
+void UServerBrowser::RefreshVisiblePings()
+{
+	MULTIPLAYERSESSIONS_TRACE_SCOPE(ServerBrowser_RefreshVisiblePings);
+
+	const UGameInstance* GameInstance = GetGameInstance();
+	const UMultiplayerSessionsSubsystem* MultiplayerSessionsSubsystem = GameInstance ? GameInstance->GetSubsystem<UMultiplayerSessionsSubsystem>() : nullptr;
+	if (SessionList == nullptr || MultiplayerSessionsSubsystem == nullptr)
+	{
+		return;
+	}
+
+	/// Rows that scrolled away since the last refresh are not worth probing anymore
+	PingService->CancelQueued();
+
+	/// The list view only has entry widgets for the rows on screen (plus a few for scrolling)
+	for (UUserWidget* EntryWidget : SessionList->GetDisplayedEntryWidgets())
+	{
+		const IUserObjectListEntry* Entry = Cast<IUserObjectListEntry>(EntryWidget);
+		UServerBrowserItem* Item = Entry ? Entry->GetListItem<UServerBrowserItem>() : nullptr;
+		if (Item == nullptr || !IsValidResultIndex(Item->ResultIndex))
+		{
+			continue;
+		}
+
+		int32 CachedPingInMs;
+		if (PingService->GetCachedPing(Item->SessionId, CachedPingInMs))
+		{
+			ApplyPing(Item, CachedPingInMs);
+			continue;
+		}
+
+		/// A recent host from disk can't be resolved, but remembers the address it had
+		FString Address;
+		const FString* CachedAddress = SearchResults->FindStringSetting(Item->ResultIndex, FRecentHostsCache::ConnectStringSettingKey);
+		if (CachedAddress && !CachedAddress->IsEmpty())
+		{
+			PingService->RequestPing(Item->SessionId, *CachedAddress);
+		}
+		else if (MultiplayerSessionsSubsystem->GetResolvedConnectString(SearchResults->GetSearchResult(Item->ResultIndex), Address))
+		{
+			PingService->RequestPing(Item->SessionId, Address);
+		}
+	}
+}
+
+void UServerBrowser::OnPingUpdated(const FString& SessionId, int32 PingInMs)
+{
+	if (UServerBrowserItem** Item = ItemsBySessionId.Find(SessionId))
+	{
+		ApplyPing(*Item, PingInMs);
+	}
+}
+
+void UServerBrowser::ApplyPing(UServerBrowserItem* Item, int32 PingInMs)
+{
+	/// No answer keeps the ping from the search, the host may just drop echo requests
+	if (PingInMs == INDEX_NONE || PingInMs == Item->PingInMs)
+	{
+		return;
+	}
+
+	Item->PingInMs = PingInMs;
+	if (IsValidResultIndex(Item->ResultIndex))
+	{
+		SearchResults->SetPingInMs(Item->ResultIndex, PingInMs);
+	}
+
+	/// Rows stay where they are while sorted by ping, reordering under the cursor would be worse than a slightly stale order
+	if (SessionList)
+	{
+		if (UServerBrowserEntry* Entry = Cast<UServerBrowserEntry>(SessionList->GetEntryWidgetFromItem(Item)))
+		{
+			Entry->UpdateFromItem(Item);
+		}
+	}
+}
+
+void UServerBrowser::SortByPingClicked()
+{
+	SortBy(EServerBrowserSortKey::Ping);
+}
+
+void UServerBrowser::SortByPlayersClicked()
+{
+	SortBy(EServerBrowserSortKey::Players);
+}
+
+void UServerBrowser::SortByMatchTypeClicked()
+{
+	SortBy(EServerBrowserSortKey::MatchType);
+}
+
+void UServerBrowser::JoinSelectedClicked()
+{
+	if (SessionList)
+	{
+		RequestJoin(SessionList->GetSelectedItem<UServerBrowserItem>());
+	}
+}
+
+void UServerBrowser::OnItemDoubleClicked(UObject* Item)
+{
+	RequestJoin(Cast<UServerBrowserItem>(Item));
+}
+
+void UServerBrowser::RequestJoin(const UServerBrowserItem* Item)
+{
+	if (Item && IsValidResultIndex(Item->ResultIndex))
+	{
+		OnJoinRequested.Broadcast(SearchResults->GetSearchResult(Item->ResultIndex));
+	}
+}
@@ -0,0 +1,39 @@
+/// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ServerBrowserEntry.h"
+#include "Components/TextBlock.h"
+#include "ServerBrowserItem.h"
+
+void UServerBrowserEntry::NativeOnListItemObjectSet(UObject* ListItemObject)
+{
+	IUserObjectListEntry::NativeOnListItemObjectSet(ListItemObject);
+
+	UpdateFromItem(Cast<UServerBrowserItem>(ListItemObject));
+}
+
+void UServerBrowserEntry::UpdateFromItem(const UServerBrowserItem* Item)
+{
+	if (Item == nullptr)
+	{
+		return;
+	}
+
+	/// Entries are recycled, so every field is overwritten, never appended to
+	if (ServerNameText)
+	{
+		ServerNameText->SetText(FText::FromString(Item->OwningUserName));
+	}
+	if (MatchTypeText)
+	{
+		MatchTypeText->SetText(FText::FromString(Item->MatchType));
+	}
+	if (PlayersText)
+	{
+		PlayersText->SetText(FText::Format(FText::FromString(TEXT("{0}/{1}")), FText::AsNumber(Item->NumPlayers), FText::AsNumber(Item->MaxPlayers)));
+	}
+	if (PingText)
+	{
+		PingText->SetText(FText::AsNumber(Item->PingInMs));
+	}
+}
@@ -0,0 +1,155 @@
+/// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SessionAttributeSchema.h"
+#include "OnlineSessionSettings.h"
+#include "HAL/IConsoleManager.h"
+
+namespace MultiplayerSessionsSchema
+{
+	static int32 BuildVersion = 1;
+	static FAutoConsoleVariableRef CVarBuildVersion(
+		TEXT("MultiplayerSessions.Schema.BuildVersion"),
+		BuildVersion,
+		TEXT("Network compatible build version (0-65535) advertised by hosts; sessions of another build version aren't listed. Bump it with every incompatible release."));
+
+	static FString Region;
+	static FAutoConsoleVariableRef CVarRegion(
+		TEXT("MultiplayerSessions.Schema.Region"),
+		Region,
+		TEXT("Region this player advertises when hosting (NorthAmerica, Europe, Asia, ...); empty is Unknown."));
+
+	const FName SettingKey(TEXT("MSA"));
+	const FName MatchQueryKey(TEXT("MSQM"));
+	const FName RegionQueryKey(TEXT("MSQR"));
+
+	uint16 GetBuildVersion()
+	{
+		return static_cast<uint16>(FMath::Clamp(BuildVersion, 0, static_cast<int32>(MAX_uint16)));
+	}
+
+	int32 GetBuildUniqueId()
+	{
+		return (static_cast<int32>(SchemaVersion) << 16) | GetBuildVersion();
+	}
+
+	ESessionRegion GetLocalRegion()
+	{
+		ESessionRegion LocalRegion = ESessionRegion::Unknown;
+		LexTryParseString(LocalRegion, *Region);
+		return LocalRegion;
+	}
+
+	/// Shared by the LexToString/LexTryParseString overloads; Names is in enum order
+	template <typename EnumType, int32 NumNames>
+	static const TCHAR* ToString(EnumType Value, const TCHAR* const (&Names)[NumNames])
+	{
+		static_assert(NumNames == static_cast<int32>(EnumType::Num), "One name per value");
+		const int32 Index = static_cast<int32>(Value);
+		return Index >= 0 && Index < NumNames ? Names[Index] : Names[0];
+	}
+
+	template <typename EnumType, int32 NumNames>
+	static bool TryParse(EnumType& OutValue, const TCHAR* String, const TCHAR* const (&Names)[NumNames])
+	{
+		for (int32 Index = 1; Index < NumNames; ++Index)
+		{
+			if (FCString::Stricmp(String, Names[Index]) == 0)
+			{
+				OutValue = static_cast<EnumType>(Index);
+				return true;
+			}
+		}
+		OutValue = static_cast<EnumType>(0);
+		return false;
+	}
+
+	static const TCHAR* const MatchTypeNames[] = { TEXT("Unknown"), TEXT("FreeForAll"), TEXT("TeamDeathmatch"), TEXT("CaptureTheFlag") };
+	static const TCHAR* const RegionNames[] = { TEXT("Unknown"), TEXT("NorthAmerica"), TEXT("SouthAmerica"), TEXT("Europe"), TEXT("Asia"), TEXT("Oceania"), TEXT("Africa"), TEXT("MiddleEast") };
+	static const TCHAR* const LobbyStateNames[] = { TEXT("Unknown"), TEXT("Waiting"), TEXT("InProgress"), TEXT("Ending") };
+}
+
+const TCHAR* LexToString(ESessionMatchType MatchType)
+{
+	return MultiplayerSessionsSchema::ToString(MatchType, MultiplayerSessionsSchema::MatchTypeNames);
+}
+
+const TCHAR* LexToString(ESessionRegion Region)
+{
+	return MultiplayerSessionsSchema::ToString(Region, MultiplayerSessionsSchema::RegionNames);
+}
+
+const TCHAR* LexToString(ESessionLobbyState LobbyState)
+{
+	return MultiplayerSessionsSchema::ToString(LobbyState, MultiplayerSessionsSchema::LobbyStateNames);
+}
+
+bool LexTryParseString(ESessionMatchType& OutMatchType, const TCHAR* String)
+{
+	return MultiplayerSessionsSchema::TryParse(OutMatchType, String, MultiplayerSessionsSchema::MatchTypeNames);
+}
+
+bool LexTryParseString(ESessionRegion& OutRegion, const TCHAR* String)
+{
+	return MultiplayerSessionsSchema::TryParse(OutRegion, String, MultiplayerSessionsSchema::RegionNames);
+}
+
+FSessionAttributes FSessionAttributes::MakeLocal()
+{
+	FSessionAttributes Attributes;
+	Attributes.SchemaVersion = MultiplayerSessionsSchema::SchemaVersion;
+	Attributes.BuildVersion = MultiplayerSessionsSchema::GetBuildVersion();
+	Attributes.Region = MultiplayerSessionsSchema::GetLocalRegion();
+	return Attributes;
+}
+
+void FSessionAttributes::Write(FOnlineSessionSettings& Settings) const
+{
+	using namespace MultiplayerSessionsSchema;
+
+	const uint64 Packed = Pack();
+	Settings.Set(SettingKey, static_cast<int64>(Packed), EOnlineDataAdvertisementType::ViaOnlineServiceAndPing);
+	Settings.Set(MatchQueryKey, static_cast<int64>(Packed & MatchQueryMask), EOnlineDataAdvertisementType::ViaOnlineService);
+	Settings.Set(RegionQueryKey, static_cast<int64>(Packed & RegionQueryMask), EOnlineDataAdvertisementType::ViaOnlineService);
+}
+
+bool FSessionAttributes::Read(const FOnlineSessionSettings& Settings, uint64& OutPacked)
+{
+	OutPacked = 0;
+	const FOnlineSessionSetting* Setting = Settings.Settings.Find(MultiplayerSessionsSchema::SettingKey);
+	if (Setting == nullptr || Setting->Data.GetType() != EOnlineKeyValuePairDataType::Int64)
+	{
+		return false;
+	}
+
+	int64 Packed = 0;
+	Setting->Data.GetValue(Packed);
+	OutPacked = static_cast<uint64>(Packed);
+	return true;
+}
+
+FSessionAttributeFilter FSessionAttributeFilter::MakeCompatible()
+{
+	return FSessionAttributeFilter()
+		.WithSchemaVersion(MultiplayerSessionsSchema::SchemaVersion)
+		.WithBuildVersion(MultiplayerSessionsSchema::GetBuildVersion());
+}
+
+bool FSessionAttributeFilter::GetQuerySetting(FName& OutKey, int64& OutValue) const
+{
+	using namespace MultiplayerSessionsSchema;
+
+	if ((Mask & RegionQueryMask) == RegionQueryMask)
+	{
+		OutKey = RegionQueryKey;
+		OutValue = static_cast<int64>(Value & RegionQueryMask);
+		return true;
+	}
+	if ((Mask & MatchQueryMask) == MatchQueryMask)
+	{
+		OutKey = MatchQueryKey;
+		OutValue = static_cast<int64>(Value & MatchQueryMask);
+		return true;
+	}
+	return false;
+}
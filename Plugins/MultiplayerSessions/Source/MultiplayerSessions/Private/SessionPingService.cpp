@@ -0,0 +1,116 @@
+/// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SessionPingService.h"
+#include "MultiplayerSessions.h"
+#include "Icmp.h"
+
+FSessionPingService::FSessionPingService(int32 InMaxConcurrentProbes, double InTimeToLive, float InProbeTimeout):
+	MaxConcurrentProbes(FMath::Max(InMaxConcurrentProbes, 1)),
+	TimeToLive(InTimeToLive),
+	ProbeTimeout(InProbeTimeout)
+{
+}
+
+bool FSessionPingService::GetCachedPing(const FString& SessionId, int32& OutPingInMs) const
+{
+	const FCachedPing* CachedPing = Cache.Find(SessionId);
+	if (CachedPing == nullptr || FPlatformTime::Seconds() - CachedPing->Time > TimeToLive)
+	{
+		return false;
+	}
+
+	OutPingInMs = CachedPing->PingInMs;
+	return true;
+}
+
+void FSessionPingService::RequestPing(const FString& SessionId, const FString& Address)
+{
+	int32 CachedPingInMs;
+	if (GetCachedPing(SessionId, CachedPingInMs) || InFlight.Contains(SessionId)
+		|| Queue.ContainsByPredicate([&SessionId](const FQueuedProbe& Probe) { return Probe.SessionId == SessionId; }))
+	{
+		return;
+	}
+
+	/// Strip the port, the echo goes to the host
+	FString Host = Address;
+	int32 PortSeparator;
+	if (Host.FindLastChar(TEXT(':'), PortSeparator) && !Host.StartsWith(TEXT("[")))
+	{
+		Host.LeftInline(PortSeparator);
+	}
+
+	Queue.Add({ SessionId, Host });
+	StartQueuedProbes();
+}
+
+void FSessionPingService::CancelQueued()
+{
+	Queue.Reset();
+}
+
+void FSessionPingService::StartQueuedProbes()
+{
+	while (InFlight.Num() < MaxConcurrentProbes && Queue.Num() > 0)
+	{
+		const FQueuedProbe Probe = Queue[0];
+		Queue.RemoveAt(0, 1, false);
+		InFlight.Add(Probe.SessionId);
+
+		/// The browser can be closed while a probe is out, so the callback must not keep the service alive
+		TWeakPtr<FSessionPingService> WeakThis = AsShared();
+		const FString SessionId = Probe.SessionId;
+		FIcmp::IcmpEcho(Probe.Address, ProbeTimeout, [WeakThis, SessionId](FIcmpEchoResult Result)
+		{
+			if (TSharedPtr<FSessionPingService> This = WeakThis.Pin())
+			{
+				This->OnProbeComplete(SessionId, Result);
+			}
+		});
+	}
+}
+
+void FSessionPingService::OnProbeComplete(const FString& SessionId, const FIcmpEchoResult& Result)
+{
+	InFlight.Remove(SessionId);
+
+	const double Now = FPlatformTime::Seconds();
+	if (!Cache.Contains(SessionId) && Cache.Num() >= MaxCachedPings)
+	{
+		EvictCachedPings(Now);
+	}
+
+	FCachedPing& CachedPing = Cache.FindOrAdd(SessionId);
+	CachedPing.Time = Now;
+	CachedPing.PingInMs = Result.Status == EIcmpResponseStatus::Success ? FMath::RoundToInt(Result.Time * 1000.f) : INDEX_NONE;
+
+	UE_LOG(LogMultiplayerSessions, Verbose, TEXT("Ping %s (%s): status %d, %d ms"),
+		*SessionId, *Result.ResolvedAddress, static_cast<int32>(Result.Status), CachedPing.PingInMs);
+
+	OnPingUpdated.Broadcast(SessionId, CachedPing.PingInMs);
+	StartQueuedProbes();
+}
+
+void FSessionPingService::EvictCachedPings(double Now)
+{
+	for (auto It = Cache.CreateIterator(); It; ++It)
+	{
+		if (Now - It.Value().Time > TimeToLive)
+		{
+			It.RemoveCurrent();
+		}
+	}
+
+	/// Still full of fresh answers: the oldest go first, they are the rows scrolled away from longest ago
+	if (Cache.Num() >= MaxCachedPings)
+	{
+		Cache.ValueSort([](const FCachedPing& A, const FCachedPing& B) { return A.Time > B.Time; });
+		TArray<FString> SessionIds;
+		Cache.GenerateKeyArray(SessionIds);
+		for (int32 Index = MaxCachedPings - 1; Index < SessionIds.Num(); ++Index)
+		{
+			Cache.Remove(SessionIds[Index]);
+		}
+	}
+}
@@ -0,0 +1,307 @@
+/// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SessionQosProber.h"
+#include "MultiplayerSessions.h"
+#include "Sockets.h"
+#include "SocketSubsystem.h"
+#include "IPAddress.h"
+#include "HAL/IConsoleManager.h"
+
+namespace MultiplayerSessionsQos
+{
+	static int32 Port = 15001;
+	static FAutoConsoleVariableRef CVarPort(
+		TEXT("MultiplayerSessions.Qos.Port"),
+		Port,
+		TEXT("UDP port the host answers QoS probes on. Advertised in the session settings."));
+
+	/// What goes over the wire, both ways; the responder sends it back as it came
+	struct FQosPacket
+	{
+		uint32 Magic;
+		uint32 Nonce;
+		int32 Index;
+	};
+
+	static constexpr uint32 QosMagic = 0x534F514D; /// "MQOS"
+
+	static bool ReadPacket(const uint8* Data, int32 Size, FQosPacket& OutPacket)
+	{
+		if (Size != sizeof(FQosPacket))
+		{
+			return false;
+		}
+		FMemory::Memcpy(&OutPacket, Data, sizeof(FQosPacket));
+		return OutPacket.Magic == QosMagic;
+	}
+
+	/// Stand-in hosts for MultiplayerSessions.Qos.LoopbackTest
+	static TUniquePtr<FSessionQosResponder> LoopbackResponder;
+	static TSharedPtr<FSessionQosProber> LoopbackProber;
+
+	static void RunLoopbackTest(const TArray<FString>& Args)
+	{
+		const int32 NumHosts = Args.Num() > 0 ? FMath::Clamp(FCString::Atoi(*Args[0]), 1, 16) : 4;
+
+		/// A lobby in this process may already be answering on the port, which works just as well
+		LoopbackResponder = MakeUnique<FSessionQosResponder>();
+		if (!LoopbackResponder->Start(Port))
+		{
+			UE_LOG(LogMultiplayerSessions, Log, TEXT("QoS loopback test: probing whatever already listens on port %d"), Port);
+		}
+
+		/// NumHosts candidates that answer, plus one with nothing behind it that has to time out
+		TArray<FString> Addresses;
+		for (int32 Index = 0; Index < NumHosts; ++Index)
+		{
+			Addresses.Add(FString::Printf(TEXT("127.0.0.1:%d"), Port));
+		}
+		Addresses.Add(FString::Printf(TEXT("127.0.0.1:%d"), Port + 1));
+
+		LoopbackProber = MakeShared<FSessionQosProber>();
+		LoopbackProber->Start(Addresses, 2, 0.5f, FOnSessionQosProbeComplete::CreateLambda([Addresses](const TArray<int32>& RttsInMs)
+		{
+			for (int32 Index = 0; Index < RttsInMs.Num(); ++Index)
+			{
+				UE_LOG(LogMultiplayerSessions, Display, TEXT("QoS loopback test: %s %s"), *Addresses[Index],
+					RttsInMs[Index] == INDEX_NONE ? TEXT("no answer") : *FString::Printf(TEXT("%d ms"), RttsInMs[Index]));
+			}
+			LoopbackResponder.Reset();
+			LoopbackProber.Reset();
+		}));
+	}
+
+	static FAutoConsoleCommand CmdLoopbackTest(
+		TEXT("MultiplayerSessions.Qos.LoopbackTest"),
+		TEXT("Probes stand-in hosts on 127.0.0.1 and logs their RTTs. Usage: MultiplayerSessions.Qos.LoopbackTest [NumHosts]"),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&RunLoopbackTest));
+}
+
+const FName FSessionQosProber::PortSettingKey(TEXT("MSQOSPORT"));
+
+FSessionQosProber::~FSessionQosProber()
+{
+	Cancel();
+}
+
+FString FSessionQosProber::MakeProbeAddress(const FString& ConnectString, int32 QosPort)
+{
+	/// Swap the game port for the responder's
+	FString Host = ConnectString;
+	int32 PortSeparator;
+	if (Host.FindLastChar(TEXT(':'), PortSeparator) && !Host.StartsWith(TEXT("[")))
+	{
+		Host.LeftInline(PortSeparator);
+	}
+	return FString::Printf(TEXT("%s:%d"), *Host, QosPort);
+}
+
+void FSessionQosProber::Start(const TArray<FString>& Addresses, int32 SocketBudget, float WindowSeconds, FOnSessionQosProbeComplete InOnComplete)
+{
+	Cancel();
+	OnComplete = MoveTemp(InOnComplete);
+
+	ISocketSubsystem* SocketSubsystem = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM);
+	const int32 NumSockets = FMath::Clamp(SocketBudget, 1, FMath::Max(Addresses.Num(), 1));
+	for (int32 Index = 0; SocketSubsystem && Index < NumSockets; ++Index)
+	{
+		FSocket* Socket = SocketSubsystem->CreateSocket(NAME_DGram, TEXT("MultiplayerSessions QoS probe"), FNetworkProtocolTypes::IPv4);
+		if (Socket)
+		{
+			Socket->SetNonBlocking(true);
+			Sockets.Add(Socket);
+		}
+	}
+
+	/// Every candidate goes out right away; the sockets are shared round robin, replies are told apart by their index
+	Nonce = FMath::Rand() ^ static_cast<uint32>(FPlatformTime::Cycles());
+	NumPending = 0;
+	Targets.SetNum(Addresses.Num());
+	for (int32 Index = 0; Index < Addresses.Num() && Sockets.Num() > 0; ++Index)
+	{
+		FTarget& Target = Targets[Index];
+		Target.Address = SocketSubsystem->GetAddressFromString(Addresses[Index]);
+		if (!Target.Address.IsValid() || !Target.Address->IsValid())
+		{
+			UE_LOG(LogMultiplayerSessions, Verbose, TEXT("Can't QoS probe %s, not an IP address"), *Addresses[Index]);
+			continue;
+		}
+
+		Target.SocketIndex = Index % Sockets.Num();
+		const MultiplayerSessionsQos::FQosPacket Packet{ MultiplayerSessionsQos::QosMagic, Nonce, Index };
+		int32 BytesSent = 0;
+		Target.SendTime = FPlatformTime::Seconds();
+		if (Sockets[Target.SocketIndex]->SendTo(reinterpret_cast<const uint8*>(&Packet), sizeof(Packet), BytesSent, *Target.Address)
+			&& BytesSent == sizeof(Packet))
+		{
+			++NumPending;
+		}
+	}
+
+	Deadline = FPlatformTime::Seconds() + WindowSeconds;
+	if (NumPending == 0)
+	{
+		Finish();
+		return;
+	}
+	TickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateSP(this, &FSessionQosProber::Tick));
+}
+
+void FSessionQosProber::Cancel()
+{
+	OnComplete.Unbind();
+	if (TickerHandle.IsValid())
+	{
+		FTSTicker::GetCoreTicker().RemoveTicker(TickerHandle);
+		TickerHandle.Reset();
+	}
+	CloseSockets();
+}
+
+bool FSessionQosProber::Tick(float DeltaTime)
+{
+	/// Replies are read once per frame, so an RTT can be a frame long; every candidate is off by the same amount
+	for (int32 SocketIndex = 0; SocketIndex < Sockets.Num(); ++SocketIndex)
+	{
+		ReceiveReplies(SocketIndex);
+	}
+
+	if (NumPending == 0 || FPlatformTime::Seconds() >= Deadline)
+	{
+		Finish();
+		return false;
+	}
+	return true;
+}
+
+void FSessionQosProber::ReceiveReplies(int32 SocketIndex)
+{
+	ISocketSubsystem* SocketSubsystem = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM);
+	TSharedRef<FInternetAddr> From = SocketSubsystem->CreateInternetAddr();
+	uint8 Buffer[64];
+	int32 BytesRead = 0;
+	while (Sockets[SocketIndex]->RecvFrom(Buffer, sizeof(Buffer), BytesRead, *From))
+	{
+		MultiplayerSessionsQos::FQosPacket Packet;
+		if (!MultiplayerSessionsQos::ReadPacket(Buffer, BytesRead, Packet) || Packet.Nonce != Nonce || !Targets.IsValidIndex(Packet.Index))
+		{
+			continue;
+		}
+
+		FTarget& Target = Targets[Packet.Index];
+		if (Target.SocketIndex == SocketIndex && Target.RttInMs == INDEX_NONE)
+		{
+			Target.RttInMs = FMath::RoundToInt((FPlatformTime::Seconds() - Target.SendTime) * 1000.0);
+			--NumPending;
+		}
+	}
+}
+
+void FSessionQosProber::Finish()
+{
+	/// The owner usually lets go of the prober from the completion delegate
+	TSharedRef<FSessionQosProber> KeepAlive = AsShared();
+
+	if (TickerHandle.IsValid())
+	{
+		FTSTicker::GetCoreTicker().RemoveTicker(TickerHandle);
+		TickerHandle.Reset();
+	}
+	CloseSockets();
+
+	TArray<int32> RttsInMs;
+	RttsInMs.Reserve(Targets.Num());
+	for (const FTarget& Target : Targets)
+	{
+		RttsInMs.Add(Target.RttInMs);
+	}
+
+	FOnSessionQosProbeComplete Callback = MoveTemp(OnComplete);
+	OnComplete.Unbind();
+	Callback.ExecuteIfBound(RttsInMs);
+}
+
+void FSessionQosProber::CloseSockets()
+{
+	ISocketSubsystem* SocketSubsystem = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM);
+	for (FSocket* Socket : Sockets)
+	{
+		SocketSubsystem->DestroySocket(Socket);
+	}
+	Sockets.Reset();
+}
+
+FSessionQosResponder::~FSessionQosResponder()
+{
+	Stop();
+}
+
+int32 FSessionQosResponder::GetConfiguredPort()
+{
+	return MultiplayerSessionsQos::Port;
+}
+
+bool FSessionQosResponder::Start(int32 Port)
+{
+	Stop();
+
+	ISocketSubsystem* SocketSubsystem = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM);
+	if (SocketSubsystem == nullptr)
+	{
+		return false;
+	}
+
+	Socket = SocketSubsystem->CreateSocket(NAME_DGram, TEXT("MultiplayerSessions QoS responder"), FNetworkProtocolTypes::IPv4);
+	if (Socket == nullptr)
+	{
+		return false;
+	}
+
+	TSharedRef<FInternetAddr> ListenAddress = SocketSubsystem->CreateInternetAddr();
+	ListenAddress->SetAnyAddress();
+	ListenAddress->SetPort(Port);
+	Socket->SetNonBlocking(true);
+	if (!Socket->Bind(*ListenAddress))
+	{
+		UE_LOG(LogMultiplayerSessions, Warning, TEXT("QoS responder could not bind port %d"), Port);
+		SocketSubsystem->DestroySocket(Socket);
+		Socket = nullptr;
+		return false;
+	}
+
+	TickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FSessionQosResponder::Tick));
+	UE_LOG(LogMultiplayerSessions, Log, TEXT("QoS responder listening on port %d"), Port);
+	return true;
+}
+
+void FSessionQosResponder::Stop()
+{
+	if (TickerHandle.IsValid())
+	{
+		FTSTicker::GetCoreTicker().RemoveTicker(TickerHandle);
+		TickerHandle.Reset();
+	}
+	if (Socket)
+	{
+		ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->DestroySocket(Socket);
+		Socket = nullptr;
+	}
+}
+
+bool FSessionQosResponder::Tick(float DeltaTime)
+{
+	TSharedRef<FInternetAddr> From = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->CreateInternetAddr();
+	uint8 Buffer[64];
+	int32 BytesRead = 0;
+	while (Socket->RecvFrom(Buffer, sizeof(Buffer), BytesRead, *From))
+	{
+		MultiplayerSessionsQos::FQosPacket Packet;
+		if (MultiplayerSessionsQos::ReadPacket(Buffer, BytesRead, Packet))
+		{
+			int32 BytesSent = 0;
+			Socket->SendTo(Buffer, BytesRead, BytesSent, *From);
+		}
+	}
+	return true;
+}
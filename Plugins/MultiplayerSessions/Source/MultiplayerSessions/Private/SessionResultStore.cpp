@@ -0,0 +1,263 @@
+/// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SessionResultStore.h"
+#include "RecentHostsCache.h"
+
+FSessionResultStore::FSessionResultStore(const TArray<FOnlineSessionSearchResult>& SearchResults)
+{
+	Rows.Reserve(SearchResults.Num());
+
+	/// Only needed while building; identical settings map to the same entry
+	TMap<FString, int32> SettingLookup;
+
+	for (const FOnlineSessionSearchResult& Result : SearchResults)
+	{
+		const FOnlineSession& Session = Result.Session;
+		const FOnlineSessionSettings& SessionSettings = Session.SessionSettings;
+
+		FRow& Row = Rows.AddDefaulted_GetRef();
+		Row.SessionInfo = Session.SessionInfo;
+		Row.OwningUserId = Session.OwningUserId;
+		Row.OwningUserNameOffset = NameArena.Num();
+		Row.OwningUserNameLength = Session.OwningUserName.Len();
+		NameArena.Append(*Session.OwningUserName, Session.OwningUserName.Len());
+
+		FSessionAttributes::Read(SessionSettings, Row.Attributes);
+		Row.PingInMs = Result.PingInMs;
+		Row.BuildUniqueId = SessionSettings.BuildUniqueId;
+		Row.NumPublicConnections = static_cast<uint16>(FMath::Clamp(SessionSettings.NumPublicConnections, 0, MAX_uint16));
+		Row.NumPrivateConnections = static_cast<uint16>(FMath::Clamp(SessionSettings.NumPrivateConnections, 0, MAX_uint16));
+		Row.NumOpenPublicConnections = static_cast<uint16>(FMath::Clamp(Session.NumOpenPublicConnections, 0, MAX_uint16));
+		Row.NumOpenPrivateConnections = static_cast<uint16>(FMath::Clamp(Session.NumOpenPrivateConnections, 0, MAX_uint16));
+		Row.Flags = PackFlags(SessionSettings);
+
+		Row.FirstSetting = SettingRefs.Num();
+		for (const TPair<FName, FOnlineSessionSetting>& Setting : SessionSettings.Settings)
+		{
+			const FString LookupKey = FString::Printf(TEXT("%s|%d|%d|%d|%s"), *Setting.Key.ToString(), static_cast<int32>(Setting.Value.AdvertisementType),
+				Setting.Value.ID, static_cast<int32>(Setting.Value.Data.GetType()), *Setting.Value.Data.ToString());
+
+			int32 SettingIndex;
+			if (const int32* Found = SettingLookup.Find(LookupKey))
+			{
+				SettingIndex = *Found;
+			}
+			else
+			{
+				SettingIndex = Settings.Add(Setting);
+				FString& SettingString = SettingStrings.AddDefaulted_GetRef();
+				if (Setting.Value.Data.GetType() == EOnlineKeyValuePairDataType::String)
+				{
+					Setting.Value.Data.GetValue(SettingString);
+				}
+				SettingLookup.Add(LookupKey, SettingIndex);
+			}
+			SettingRefs.Add(SettingIndex);
+		}
+		Row.NumSettings = SettingRefs.Num() - Row.FirstSetting;
+	}
+
+	NameArena.Shrink();
+	SettingRefs.Shrink();
+	Settings.Shrink();
+	SettingStrings.Shrink();
+}
+
+TSharedRef<FSessionResultStore> FSessionResultStore::BuildRanked(TArray<FOnlineSessionSearchResult>&& SearchResults, const FSessionAttributeFilter& Filter,
+	const TSet<FString>& ExcludedSessionIds, int32* OutNumExcluded)
+{
+	TSet<FString> SeenSessionIds;
+	SeenSessionIds.Reserve(SearchResults.Num());
+	int32 NumExcluded = 0;
+
+	SearchResults.RemoveAll([&Filter, &SeenSessionIds, &ExcludedSessionIds, &NumExcluded](const FOnlineSessionSearchResult& Result)
+	{
+		if (!Result.IsValid())
+		{
+			return true;
+		}
+
+		/// Sessions without the attributes (older builds) read as 0 and never match the schema version
+		uint64 Attributes;
+		FSessionAttributes::Read(Result.Session.SessionSettings, Attributes);
+		if (!Filter.Matches(Attributes))
+		{
+			return true;
+		}
+
+		const FString SessionId = Result.GetSessionIdStr();
+		if (ExcludedSessionIds.Contains(SessionId))
+		{
+			++NumExcluded;
+			return true;
+		}
+
+		bool bAlreadySeen = false;
+		SeenSessionIds.Add(SessionId, &bAlreadySeen);
+		return bAlreadySeen;
+	});
+	if (OutNumExcluded)
+	{
+		*OutNumExcluded = NumExcluded;
+	}
+
+	SearchResults.StableSort([](const FOnlineSessionSearchResult& A, const FOnlineSessionSearchResult& B)
+	{
+		const bool bARoom = A.Session.NumOpenPublicConnections > 0;
+		const bool bBRoom = B.Session.NumOpenPublicConnections > 0;
+		if (bARoom != bBRoom)
+		{
+			return bARoom;
+		}
+
+		auto PingKey = [](const FOnlineSessionSearchResult& Result)
+		{
+			return Result.PingInMs > 0 && Result.PingInMs < MAX_QUERY_PING ? Result.PingInMs : MAX_int32;
+		};
+		return PingKey(A) < PingKey(B);
+	});
+
+	return MakeShared<FSessionResultStore>(SearchResults);
+}
+
+FOnlineSessionSearchResult FSessionResultStore::GetSearchResult(int32 Index) const
+{
+	const FRow& Row = Rows[Index];
+
+	FOnlineSessionSearchResult Result;
+	Result.PingInMs = Row.PingInMs;
+
+	FOnlineSession& Session = Result.Session;
+	Session.SessionInfo = Row.SessionInfo;
+	Session.OwningUserId = Row.OwningUserId;
+	Session.OwningUserName = FString(GetOwningUserName(Index));
+	Session.NumOpenPublicConnections = Row.NumOpenPublicConnections;
+	Session.NumOpenPrivateConnections = Row.NumOpenPrivateConnections;
+
+	FOnlineSessionSettings& SessionSettings = Session.SessionSettings;
+	SessionSettings.NumPublicConnections = Row.NumPublicConnections;
+	SessionSettings.NumPrivateConnections = Row.NumPrivateConnections;
+	SessionSettings.BuildUniqueId = Row.BuildUniqueId;
+	UnpackFlags(Row.Flags, SessionSettings);
+
+	SessionSettings.Settings.Reserve(Row.NumSettings);
+	for (int32 RefIndex = Row.FirstSetting; RefIndex < Row.FirstSetting + Row.NumSettings; ++RefIndex)
+	{
+		const TPair<FName, FOnlineSessionSetting>& Setting = Settings[SettingRefs[RefIndex]];
+		SessionSettings.Settings.Add(Setting.Key, Setting.Value);
+	}
+	return Result;
+}
+
+FString FSessionResultStore::GetSessionIdStr(int32 Index) const
+{
+	const FRow& Row = Rows[Index];
+	if (Row.SessionInfo.IsValid())
+	{
+		return Row.SessionInfo->GetSessionId().ToString();
+	}
+
+	/// A recent host from disk only has the id it was seen with
+	const FString* CachedSessionId = FindStringSetting(Index, FRecentHostsCache::SessionIdSettingKey);
+	return CachedSessionId ? *CachedSessionId : FString();
+}
+
+FStringView FSessionResultStore::GetOwningUserName(int32 Index) const
+{
+	const FRow& Row = Rows[Index];
+	return FStringView(NameArena.GetData() + Row.OwningUserNameOffset, Row.OwningUserNameLength);
+}
+
+const FString* FSessionResultStore::FindStringSetting(int32 Index, FName Key) const
+{
+	const FRow& Row = Rows[Index];
+	for (int32 RefIndex = Row.FirstSetting; RefIndex < Row.FirstSetting + Row.NumSettings; ++RefIndex)
+	{
+		const int32 SettingIndex = SettingRefs[RefIndex];
+		if (Settings[SettingIndex].Key == Key)
+		{
+			return Settings[SettingIndex].Value.Data.GetType() == EOnlineKeyValuePairDataType::String ? &SettingStrings[SettingIndex] : nullptr;
+		}
+	}
+	return nullptr;
+}
+
+SIZE_T FSessionResultStore::GetSharedObjectsSize(const TSharedPtr<FOnlineSessionInfo>& SessionInfo, const FUniqueNetIdPtr& OwningUserId)
+{
+	/// The backend's types aren't known here: each object is counted as its data and vtable pointer, plus the shared
+	/// pointer's reference controller (vtable pointer and two counts)
+	constexpr SIZE_T PerObjectOverhead = sizeof(void*) + 2 * sizeof(int32) + sizeof(void*);
+	SIZE_T Size = 0;
+	if (SessionInfo.IsValid())
+	{
+		Size += SessionInfo->GetSize() + PerObjectOverhead;
+	}
+	if (OwningUserId.IsValid())
+	{
+		Size += OwningUserId->GetSize() + PerObjectOverhead;
+	}
+	return Size;
+}
+
+SIZE_T FSessionResultStore::GetAllocatedSize() const
+{
+	SIZE_T Size = sizeof(*this) + Rows.GetAllocatedSize() + NameArena.GetAllocatedSize() + SettingRefs.GetAllocatedSize()
+		+ Settings.GetAllocatedSize() + SettingStrings.GetAllocatedSize();
+	for (int32 SettingIndex = 0; SettingIndex < Settings.Num(); ++SettingIndex)
+	{
+		/// The string lives in the setting's variant and in SettingStrings
+		Size += SettingStrings[SettingIndex].GetAllocatedSize() * 2;
+	}
+	for (const FRow& Row : Rows)
+	{
+		Size += GetSharedObjectsSize(Row.SessionInfo, Row.OwningUserId);
+	}
+	return Size;
+}
+
+SIZE_T FSessionResultStore::GetAllocatedSize(const TArray<FOnlineSessionSearchResult>& SearchResults)
+{
+	SIZE_T Size = SearchResults.GetAllocatedSize();
+	for (const FOnlineSessionSearchResult& Result : SearchResults)
+	{
+		const FOnlineSessionSettings& SessionSettings = Result.Session.SessionSettings;
+		Size += Result.Session.OwningUserName.GetAllocatedSize() + SessionSettings.Settings.GetAllocatedSize() + SessionSettings.MemberSettings.GetAllocatedSize();
+		Size += GetSharedObjectsSize(Result.Session.SessionInfo, Result.Session.OwningUserId);
+		for (const TPair<FName, FOnlineSessionSetting>& Setting : SessionSettings.Settings)
+		{
+			if (Setting.Value.Data.GetType() == EOnlineKeyValuePairDataType::String)
+			{
+				Size += (Setting.Value.Data.ToString().Len() + 1) * sizeof(TCHAR);
+			}
+		}
+	}
+	return Size;
+}
+
+uint16 FSessionResultStore::PackFlags(const FOnlineSessionSettings& SessionSettings)
+{
+	uint16 Flags = 0;
+	int32 Bit = 0;
+	for (const bool bFlag : { SessionSettings.bShouldAdvertise, SessionSettings.bAllowJoinInProgress, SessionSettings.bIsLANMatch,
+		SessionSettings.bIsDedicated, SessionSettings.bUsesStats, SessionSettings.bAllowInvites, SessionSettings.bUsesPresence,
+		SessionSettings.bAllowJoinViaPresence, SessionSettings.bAllowJoinViaPresenceFriendsOnly, SessionSettings.bAntiCheatProtected,
+		SessionSettings.bUseLobbiesIfAvailable, SessionSettings.bUseLobbiesVoiceChatIfAvailable })
+	{
+		Flags |= (bFlag ? 1 : 0) << Bit++;
+	}
+	return Flags;
+}
+
+void FSessionResultStore::UnpackFlags(uint16 Flags, FOnlineSessionSettings& OutSettings)
+{
+	/// Same order as PackFlags
+	int32 Bit = 0;
+	for (bool* Flag : { &OutSettings.bShouldAdvertise, &OutSettings.bAllowJoinInProgress, &OutSettings.bIsLANMatch,
+		&OutSettings.bIsDedicated, &OutSettings.bUsesStats, &OutSettings.bAllowInvites, &OutSettings.bUsesPresence,
+		&OutSettings.bAllowJoinViaPresence, &OutSettings.bAllowJoinViaPresenceFriendsOnly, &OutSettings.bAntiCheatProtected,
+		&OutSettings.bUseLobbiesIfAvailable, &OutSettings.bUseLobbiesVoiceChatIfAvailable })
+	{
+		*Flag = (Flags & (1 << Bit++)) != 0;
+	}
+}
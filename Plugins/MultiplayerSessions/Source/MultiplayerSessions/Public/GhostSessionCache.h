@@ -0,0 +1,69 @@
+/// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Interfaces/OnlineSessionInterface.h"
+
+/// Why a session is thought to be a ghost
+enum class EGhostSessionReason : uint8
+{
+	CouldNotRetrieveAddress,
+	SessionDoesNotExist,
+	Timeout,	/// The join, or the connection to the host after it, never got an answer
+	Num
+};
+
+MULTIPLAYERSESSIONS_API const TCHAR* LexToString(EGhostSessionReason Reason);
+
+///
+/// Negative cache of sessions the backend still advertises but that can't be joined: their host crashed or left,
+/// and the listing hasn't expired yet. Joining one burns a join timeout, so once a join fails that way the session
+/// is left out of the search results for a while.
+///
+/// The first failure suppresses a session for MultiplayerSessions.GhostSessions.BaseTTL seconds. Failing again before
+/// the entry is forgotten doubles that, up to MaxTTL. A session is listed again as soon as its suppression runs out,
+/// and the entry is forgotten once it has gone another TTL without failing, so its history decays away.
+///
+/// Failures and suppressed results are counted for MultiplayerSessions.GhostSessions.Report.
+/// Game thread only; searches take a snapshot of the suppressed ids to their worker, see GetSuppressedSessionIds.
+///
+class MULTIPLAYERSESSIONS_API FGhostSessionCache
+{
+public:
+	~FGhostSessionCache();
+
+	static bool IsEnabled();
+
+	/// The reason a join result points at a ghost session; false for results that don't (e.g. SessionIsFull)
+	static bool GetReason(EOnJoinSessionCompleteResult::Type Result, EGhostSessionReason& OutReason);
+
+	void RecordFailure(const FString& SessionId, EGhostSessionReason Reason);
+
+	/// The session was joined after all; forgets it
+	void RecordSuccess(const FString& SessionId);
+
+	bool IsSuppressed(const FString& SessionId) const;
+
+	/// The sessions suppressed right now; forgets the entries that have decayed
+	TSet<FString> GetSuppressedSessionIds();
+
+	/// Counts results a search left out, for the report
+	static void RecordSuppressedResults(int32 NumSuppressed);
+
+private:
+	struct FEntry
+	{
+		double SuppressedUntil{ 0.0 };
+
+		/// SuppressedUntil plus the entry's TTL
+		double ForgetAt{ 0.0 };
+
+		int32 NumFailures{ 0 };
+		EGhostSessionReason LastReason{ EGhostSessionReason::Timeout };
+	};
+
+	void ForgetDecayed(double Now);
+
+	TMap<FString, FEntry> Entries;
+};
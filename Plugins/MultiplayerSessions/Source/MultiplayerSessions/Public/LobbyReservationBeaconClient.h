@@ -0,0 +1,65 @@
+/// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "OnlineBeaconClient.h"
+#include "GameFramework/OnlineReplStructs.h"
+#include "LobbyReservationBeaconClient.generated.h"
+
+/// Broadcast on the client when the host answers, or with bAccepted false if the host couldn't be reached
+/// bHostReached tells a full lobby (true) apart from a host without a reservation beacon (false)
+DECLARE_MULTICAST_DELEGATE_ThreeParams(FOnLobbyReservationResponse, bool /*bHostReached*/, bool /*bAccepted*/, const FString& /*ReservationToken*/);
+
+/// Broadcast on the client while it waits for a full lobby, whenever its place in the host's waitlist changes (1 is next)
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnLobbyWaitlistPosition, int32 /*Position*/);
+
+///
+/// Asks a lobby host to hold slots before the client joins and travels.
+/// One small beacon round trip replaces loading the lobby only to have the login rejected because it is full.
+/// The host answers through ALobbyReservationBeaconHostObject; the beacon disconnects once it has its answer.
+///
+/// A client that asks to wait when the lobby is full stays connected in the host's waitlist instead of searching
+/// again. The host pushes its place in the queue, and the reservation once a player leaves, or a rejection when
+/// the wait times out.
+///
+UCLASS(transient, notplaceable)
+class MULTIPLAYERSESSIONS_API ALobbyReservationBeaconClient : public AOnlineBeaconClient
+{
+	GENERATED_BODY()
+
+public:
+	/// Connects to the host's beacon at ConnectInfo (host:beaconport) and asks for NumSlots slots
+	/// PartyMembers are the players other than us the slots are for; they log in with their id instead of the token
+	/// bWaitIfFull: join the host's waitlist rather than be turned away when it has no room
+	bool RequestReservation(const FString& ConnectInfo, int32 NumSlots, const TArray<FUniqueNetIdRepl>& PartyMembers, bool bWaitIfFull = false);
+
+	FOnLobbyReservationResponse OnReservationResponse;
+	FOnLobbyWaitlistPosition OnWaitlistPosition;
+
+	/// URL option the reservation token travels in, read by the host when the player logs in
+	static const TCHAR* ReservationTokenOption;
+
+protected:
+	virtual void OnConnected() override;
+	virtual void OnFailure() override;
+
+	UFUNCTION(Server, Reliable, WithValidation)
+	void ServerRequestReservation(int32 NumSlots, const TArray<FUniqueNetIdRepl>& PartyMembers, bool bWaitIfFull);
+
+	UFUNCTION(Client, Reliable)
+	void ClientReservationResponse(bool bAccepted, const FString& ReservationToken);
+
+	UFUNCTION(Client, Reliable)
+	void ClientWaitlistPosition(int32 Position);
+
+	friend class ALobbyReservationBeaconHostObject;
+
+private:
+	void FinishRequest(bool bHostReached, bool bAccepted, const FString& ReservationToken);
+
+	int32 NumRequestedSlots{ 1 };
+	TArray<FUniqueNetIdRepl> RequestedPartyMembers;
+	bool bWaitIfFullRequested{ false };
+	bool bRequestFinished{ false };
+};
@@ -0,0 +1,120 @@
+/// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "OnlineBeaconHostObject.h"
+#include "GameFramework/OnlineReplStructs.h"
+#include "LobbyReservationBeaconHostObject.generated.h"
+
+/// Returns how many more players the lobby can take right now, not counting reservations
+DECLARE_DELEGATE_RetVal(int32, FOnGetLobbyOpenSlots);
+
+/// Returns how many players the lobby holds at most
+DECLARE_DELEGATE_RetVal(int32, FOnGetLobbyMaxSlots);
+
+///
+/// Host side of the slot reservation beacon, see ALobbyReservationBeaconClient.
+/// The game mode binds GetOpenSlots to its authoritative player count; reservations are held on top of it until the
+/// reserved players log in or the reservation expires. GetMaxSlots bounds the size of a single request.
+///
+/// Clients that find the lobby full can wait in line instead. The first in line is reserved the slots as soon as
+/// they are free (the game mode calls ProcessWaitlist when a player leaves). The others are told their place
+/// whenever it changes, and are turned away after WaitlistTimeout.
+///
+UCLASS(transient, notplaceable, config = Engine)
+class MULTIPLAYERSESSIONS_API ALobbyReservationBeaconHostObject : public AOnlineBeaconHostObject
+{
+	GENERATED_BODY()
+
+public:
+	ALobbyReservationBeaconHostObject();
+
+	/// Spawns the beacon host listening on the configured beacon port and registers a host object with it
+	/// Returns nullptr if the beacon could not listen (e.g. the port is taken)
+	static ALobbyReservationBeaconHostObject* StartListening(UWorld* World);
+
+	/// Stops accepting reservations and destroys the beacon host
+	void StopListening();
+
+	/// Answers a client's request; reserves NumSlots if there is room for them
+	/// PartyMembers can claim the reservation with their id, the requester claims it with the token
+	bool ProcessReservationRequest(int32 NumSlots, const TArray<FUniqueNetIdRepl>& PartyMembers, FString& OutReservationToken);
+
+	/// Whether a request for NumSlots could ever fit the lobby, even empty; one that can't is refused without waiting
+	bool CanEverFit(int32 NumSlots);
+
+	/// Whether a player may log in: they hold a live reservation (by token or as a party member), or there is an unreserved open slot
+	bool CanPlayerLogin(const FString& ReservationToken, const FUniqueNetIdRepl& UniqueId);
+
+	/// Called when a player has logged in; their reserved slot is now counted by the game mode instead
+	void ConsumeReservation(const FString& ReservationToken, const FUniqueNetIdRepl& UniqueId);
+
+	/// Open slots minus the slots held by reservations
+	int32 GetUnreservedOpenSlots();
+
+	/// Puts a client the lobby had no room for in line; returns false if the waitlist is full
+	bool AddToWaitlist(class ALobbyReservationBeaconClient* Client, int32 NumSlots, const TArray<FUniqueNetIdRepl>& PartyMembers);
+
+	/// Reserves free slots for the waitlist in order and tells everyone still waiting their place
+	/// A party that doesn't fit yet holds up the ones behind it, so it isn't starved by players arriving alone
+	void ProcessWaitlist();
+
+	virtual void NotifyClientDisconnected(AOnlineBeaconClient* LeavingClientActor) override;
+
+	FOnGetLobbyOpenSlots GetOpenSlots;
+	FOnGetLobbyMaxSlots GetMaxSlots;
+
+	/// How long a reservation is held for the client to join the session, travel and load the map
+	UPROPERTY(Config)
+	float ReservationTimeout{ 60.f };
+
+	/// How long a client waits in line before it is told the lobby stayed full
+	UPROPERTY(Config)
+	float WaitlistTimeout{ 120.f };
+
+	/// Clients that can wait at once; the ones after that are turned away as before
+	UPROPERTY(Config)
+	int32 MaxWaitlistLength{ 32 };
+
+private:
+	struct FReservation
+	{
+		int32 RemainingSlots{ 0 };
+		double ExpiryTime{ 0.0 };
+
+		/// Party members that haven't logged in yet
+		TArray<FUniqueNetIdRepl> PartyMembers;
+	};
+
+	/// The reservation the player holds, by token first, then by party membership
+	FReservation* FindReservation(const FString& ReservationToken, const FUniqueNetIdRepl& UniqueId, FString& OutKey);
+
+	struct FWaitlistEntry
+	{
+		TWeakObjectPtr<class ALobbyReservationBeaconClient> Client;
+		int32 NumSlots{ 0 };
+		TArray<FUniqueNetIdRepl> PartyMembers;
+		double ExpiryTime{ 0.0 };
+
+		/// Last place the client was told, so it is only sent changes
+		int32 SentPosition{ 0 };
+	};
+
+	/// Drops reservations whose players never showed up; returns whether any were dropped
+	bool ExpireReservations();
+
+	/// Timer callback; expires reservations and waiting clients, and hands expired reservations' slots to the waitlist
+	void OnExpiryTimer();
+	void StartExpiryTimer();
+
+	TArray<FWaitlistEntry> Waitlist;
+
+	int32 GetReservedSlots() const;
+
+	TMap<FString, FReservation> Reservations;
+	FTimerHandle ExpiryTimerHandle;
+
+	UPROPERTY()
+	class AOnlineBeaconHost* BeaconHost;
+};
@@ -0,0 +1,87 @@
+/// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class FSessionResultStore;
+
+///
+/// One stage of expanding-window matchmaking, see UMultiplayerSessionsSubsystem::MatchmakeAsync.
+/// Matchmaking starts with the tightest stage and widens to the next once a stage has searched for Duration seconds
+/// without finding a session to join. Each stage is its own small search the backend filters on the match type
+/// (and region), see FSessionAttributeFilter::GetQuerySetting; ping and fill are checked on the results.
+///
+struct MULTIPLAYERSESSIONS_API FMatchmakingStage
+{
+	/// Seconds the stage searches before the next one takes over
+	float Duration{ 5.f };
+
+	/// Backend results to ask for; the first stages need few, they only want close and nearly full lobbies
+	int32 MaxSearchResults{ 50 };
+
+	/// Only hosts that advertise this player's region (ignored while the local region is Unknown)
+	bool bSameRegion{ false };
+
+	/// Most search ping a host may have, 0 for any; hosts whose ping the search doesn't know pass, the join probes them
+	int32 MaxPingInMs{ 0 };
+
+	/// Fewest players over max players a lobby needs; fuller lobbies start sooner
+	float MinFillRatio{ 0.f };
+
+	/// MultiplayerSessions.Matchmaking.Enable: the menu's join matchmakes instead of searching once and joining the best result
+	static bool IsEnabled();
+
+	/// The sessions of SearchResults this stage would join, in the order they were ranked
+	void SelectCandidates(const FSessionResultStore& SearchResults, TArray<int32>& OutCandidates) const;
+
+	/// MultiplayerSessions.Matchmaking.Stages if set, otherwise the built-in stages:
+	/// same region under 60 ms and half full, then same region under 120 ms, then any region under 200 ms, then anything
+	static TArray<FMatchmakingStage> GetDefaultStages();
+
+	/// "Duration,MaxSearchResults,bSameRegion,MaxPingInMs,MinFillRatio" per stage, separated by ';'. False if any stage doesn't parse.
+	static bool ParseStages(const FString& String, TArray<FMatchmakingStage>& OutStages);
+};
+
+///
+/// How the stages do, for tuning them against the real population: per stage, how many searches found a session
+/// to join (the hit rate), how long matchmaking spent in it, and how many matchmakings it ended.
+/// Counts everything this process matchmade; MultiplayerSessions.Matchmaking.Report logs them.
+/// The time in each stage is also traced as the phase "MatchmakingStage<N>", so it shows in the time-to-lobby records.
+///
+class MULTIPLAYERSESSIONS_API FMatchmakingStats
+{
+public:
+	static FMatchmakingStats& Get();
+
+	/// A search of StageIndex came back with NumResults sessions, NumCandidates of which the stage would join
+	void RecordSearch(int32 StageIndex, int32 NumResults, int32 NumCandidates);
+
+	/// Matchmaking left StageIndex after Seconds in it; bMatched if it found its session there
+	void RecordStage(int32 StageIndex, double Seconds, bool bMatched);
+
+	/// A matchmaking is over: joined (or failed to join) what it found, ran out of stages, or was canceled
+	void RecordMatchmaking(bool bMatched, bool bCanceled, double Seconds);
+
+	void Report() const;
+
+private:
+	struct FStageStats
+	{
+		int32 NumSearches{ 0 };
+		int32 NumSearchesWithCandidates{ 0 };
+		int64 NumResults{ 0 };
+		int32 NumEntered{ 0 };
+		int32 NumMatched{ 0 };
+		double Seconds{ 0.0 };
+	};
+
+	FStageStats& GetStage(int32 StageIndex);
+
+	TArray<FStageStats> Stages;
+	int32 NumMatchmakings{ 0 };
+	int32 NumMatched{ 0 };
+	int32 NumExhausted{ 0 };
+	int32 NumCanceled{ 0 };
+	double SecondsToMatch{ 0.0 };
+};
@@ -5,6 +5,8 @@
 #include "CoreMinimal.h"
 #include "Blueprint/UserWidget.h"
 #include "Interfaces/OnlineSessionInterface.h"
+#include "SessionResultStore.h"
+#include "MultiplayerSessionsAsync.h"
 #include "Menu.generated.h"
 
 /**
@@ -26,17 +28,15 @@ protected:
 
 
 	///
-	/// Callbacks for the custom delegates on the MultiplayerSessionsSubsystem
+	/// Continuations of the MultiplayerSessionsSubsystem's async calls; each click chains its own, see HostButtonClicked
 	///
 	
-	UFUNCTION()
 	void OnCreateSession(bool bWasSuccessful); ///, const FString& Error);
-	void OnFindSessions(const TArray<FOnlineSessionSearchResult>& SearchResults, bool bWasSuccessful);
+	void OnFindSessions(const TSharedRef<FSessionResultStore>& SearchResults, bool bWasSuccessful);
 	void OnJoinSession(EOnJoinSessionCompleteResult::Type Result);
-	UFUNCTION()
-	void OnDestroySession(bool bWasSuccessful);
-	UFUNCTION()
-	void OnStartSession(bool bWasSuccessful);
+
+	/// The lobby we are joining is full and we are waiting in line for it
+	void OnWaitlistPosition(int32 Position);
 	
 private:
 
@@ -52,6 +52,13 @@ private:
 	UPROPERTY(meta = (BindWidget)) 
 	UButton* JoinButton;
 
+	/// Optional server browser. When the menu has one, Join lists every session found instead of joining the first match
+	UPROPERTY(meta = (BindWidgetOptional))
+	class UServerBrowser* ServerBrowser;
+
+	/// Called when the player picks a session in the ServerBrowser
+	void OnServerBrowserJoinRequested(const FOnlineSessionSearchResult& SessionResult);
+
 	UFUNCTION()
 	void HostButtonClicked();
 	
@@ -60,6 +67,9 @@ private:
 
 	void MenuTearDown();
 
+	/// Cancels the session calls of the last click when the menu goes away, so their continuations do nothing
+	FSessionCancellationToken CancellationToken;
+
 	
 	/// forward declare the multiplayerSessionsSubsystem
 	/// This is how you can access the subsystem from another class.
@@ -0,0 +1,56 @@
+/// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/HUD.h"
+#include "MenuHUD.generated.h"
+
+struct FStreamableHandle;
+
+///
+/// Shows the menu without loading it in the boot path.
+/// The menu widget class is a soft reference, loaded asynchronously once the map is up; until it arrives a plain
+/// Slate placeholder is shown. Logs the time from process start to the menu being interactive.
+///
+/// Use it as the HUD class of the menu map's game mode, in place of creating the menu in the level blueprint
+/// (which hard-references the widget and loads it with the map).
+///
+UCLASS()
+class MULTIPLAYERSESSIONS_API AMenuHUD : public AHUD
+{
+	GENERATED_BODY()
+
+public:
+	AMenuHUD();
+
+protected:
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Menu")
+	TSoftClassPtr<class UMenu> MenuWidgetClass;
+
+	/// Passed to UMenu::MenuSetup
+	UPROPERTY(EditDefaultsOnly, Category = "Menu")
+	int32 NumPublicConnections{ 4 };
+
+	UPROPERTY(EditDefaultsOnly, Category = "Menu")
+	FString MatchType{ TEXT("FreeForAll") };
+
+	UPROPERTY(EditDefaultsOnly, Category = "Menu")
+	FString LobbyPath{ TEXT("/Game/Maps/Lobby") };
+
+	UPROPERTY(EditDefaultsOnly, Category = "Menu")
+	FText PlaceholderText;
+
+private:
+	void OnMenuWidgetClassLoaded();
+
+	void ShowPlaceholder();
+	void HidePlaceholder();
+
+	TSharedPtr<FStreamableHandle> MenuWidgetClassHandle;
+	TSharedPtr<class SWidget> Placeholder;
+	double MenuWidgetClassLoadStartTime{ 0.0 };
+};
@@ -0,0 +1,115 @@
+/// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/Future.h"
+#include "Interfaces/OnlineSessionInterface.h"
+#include "SessionResultStore.h"
+
+///
+/// Results and cancellation for the TFuture based session calls, see UMultiplayerSessionsSubsystem::CreateSessionAsync.
+/// Every call gets its own future, so a caller chains on it (find, rank, join, travel) instead of binding to the
+/// subsystem's multicast delegates and working out which broadcast was its own. Calls made this way aren't broadcast.
+/// Futures are fulfilled, and their continuations run, on the game thread.
+///
+
+/// Handed to a call; copies share the same state, so whoever holds one can cancel the call
+/// Game thread only
+class MULTIPLAYERSESSIONS_API FSessionCancellationToken
+{
+public:
+	FSessionCancellationToken();
+
+	void Cancel();
+	bool IsCanceled() const { return State->bCanceled; }
+
+	/// Runs Callback once the token is canceled, right away if it already is
+	void OnCanceled(TFunction<void()> Callback);
+
+private:
+	struct FState
+	{
+		bool bCanceled{ false };
+		TArray<TFunction<void()>> Callbacks;
+	};
+	TSharedRef<FState> State;
+};
+
+struct FSessionOperationResult
+{
+	bool bWasSuccessful{ false };
+
+	/// The token was canceled before the call completed. Calls the online service can't abort (create, join, destroy)
+	/// still complete, so e.g. a canceled join may have joined; the caller just shouldn't act on it.
+	bool bWasCanceled{ false };
+
+	/// From the call to its completion
+	double DurationSeconds{ 0.0 };
+};
+
+struct FCreateSessionResult : public FSessionOperationResult
+{
+};
+
+struct FFindSessionsResult : public FSessionOperationResult
+{
+	/// Never null; empty when nothing was found
+	TSharedRef<FSessionResultStore> SearchResults{ MakeShared<FSessionResultStore>() };
+};
+
+struct FJoinSessionResult : public FSessionOperationResult
+{
+	EOnJoinSessionCompleteResult::Type Result{ EOnJoinSessionCompleteResult::UnknownError };
+};
+
+struct FDestroySessionResult : public FSessionOperationResult
+{
+};
+
+/// The promise of the one call of a kind that is in flight
+template <typename ResultType>
+class TPendingSessionOperation
+{
+public:
+	/// A call still in flight is superseded: it completes unsuccessfully
+	TFuture<ResultType> Begin(const FSessionCancellationToken& InCancellationToken)
+	{
+		Complete(ResultType());
+
+		Promise = MakeUnique<TPromise<ResultType>>();
+		CancellationToken = InCancellationToken;
+		StartTime = FPlatformTime::Seconds();
+		++CallId;
+		return Promise->GetFuture();
+	}
+
+	bool IsPending() const { return Promise.IsValid(); }
+
+	/// Whether CallIdToCheck, from GetCallId when the call began, is still the one in flight
+	bool IsPending(uint32 CallIdToCheck) const { return IsPending() && CallId == CallIdToCheck; }
+	uint32 GetCallId() const { return CallId; }
+
+	/// Fulfils the call in flight; returns false if there is none, i.e. the operation wasn't started through the async API
+	bool Complete(ResultType Result)
+	{
+		if (!Promise.IsValid())
+		{
+			return false;
+		}
+
+		Result.bWasCanceled = CancellationToken.IsCanceled();
+		Result.DurationSeconds = FPlatformTime::Seconds() - StartTime;
+
+		/// Continuations may start the next call of the same kind
+		TUniquePtr<TPromise<ResultType>> Completing = MoveTemp(Promise);
+		Completing->SetValue(MoveTemp(Result));
+		return true;
+	}
+
+private:
+	TUniquePtr<TPromise<ResultType>> Promise;
+	FSessionCancellationToken CancellationToken;
+	double StartTime{ 0.0 };
+	uint32 CallId{ 0 };
+};
@@ -0,0 +1,89 @@
+/// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+///
+/// Game thread hitch watchdog for the session callbacks, the listeners they call and travel.
+/// Each watched call is timed against a budget (MultiplayerSessions.HitchWatchdog.BudgetMs, TravelBudgetMs for the travel
+/// calls, LoadMapBudgetMs for the map load a travel hands off to).
+/// One over budget is logged with its name, the objects that were listening and a callstack of the call site,
+/// and counted for MultiplayerSessions.HitchWatchdog.Report.
+///
+/// Within budget, a watched call costs two cycle counter reads, so it stays on in shipping builds
+/// (MultiplayerSessions.HitchWatchdog.Enable=0 turns it off).
+///
+namespace MultiplayerSessionsHitchWatchdog
+{
+	MULTIPLAYERSESSIONS_API bool IsEnabled();
+
+	/// What a watched call was, which picks its budget
+	enum class ECategory : uint8
+	{
+		Callback,	/// The subsystem's own callbacks from the online subsystem, beacons and the engine
+		Listener,	/// Whoever the callbacks call: delegate listeners, TFuture continuations
+		Travel,		/// ServerTravel/ClientTravel, up to the engine taking over
+		LoadMap		/// The engine's part of a travel: LoadMap, from PreLoadMap to PostLoadMapWithWorld
+	};
+
+	/// Reports the call that started at StartCycles if it went over budget; DescribeListeners is only called then
+	MULTIPLAYERSESSIONS_API void Check(ECategory Category, const TCHAR* Name, uint64 StartCycles);
+	MULTIPLAYERSESSIONS_API void Check(ECategory Category, const TCHAR* Name, uint64 StartCycles, TFunctionRef<FString()> DescribeListeners);
+
+	/// The travel calls only queue the travel; the handoff itself is the map load a later frame does.
+	/// BeginTravel names the travel at its call site, BeginLoadMap (PreLoadMap) starts the clock, EndLoadMap
+	/// (PostLoadMapWithWorld, or a travel failure) stops it. A map load nobody named is reported as "LoadMap".
+	MULTIPLAYERSESSIONS_API void BeginTravel(const TCHAR* Name);
+	MULTIPLAYERSESSIONS_API void BeginLoadMap();
+	MULTIPLAYERSESSIONS_API void EndLoadMap();
+
+	/// "UMenu Menu_C_0, AMenuSystemCharacter BP_ThirdPersonCharacter_C_0"
+	MULTIPLAYERSESSIONS_API FString DescribeObjects(const TArray<UObject*>& Objects);
+
+	/// Broadcasts Delegate and times its listeners, naming the objects bound to it if they go over budget
+	template <typename DelegateType, typename... ArgTypes>
+	void Broadcast(const TCHAR* Name, DelegateType& Delegate, ArgTypes&&... Args)
+	{
+		const uint64 StartCycles = IsEnabled() ? FPlatformTime::Cycles64() : 0;
+		Delegate.Broadcast(Forward<ArgTypes>(Args)...);
+		if (StartCycles != 0)
+		{
+			Check(ECategory::Listener, Name, StartCycles, [&Delegate]() { return DescribeObjects(Delegate.GetAllObjects()); });
+		}
+	}
+}
+
+/// Watches the rest of the enclosing scope, see MULTIPLAYERSESSIONS_HITCH_SCOPE
+class MULTIPLAYERSESSIONS_API FMultiplayerSessionsHitchScope
+{
+public:
+	FMultiplayerSessionsHitchScope(MultiplayerSessionsHitchWatchdog::ECategory InCategory, const TCHAR* InName):
+		Category(InCategory),
+		Name(InName),
+		StartCycles(MultiplayerSessionsHitchWatchdog::IsEnabled() ? FPlatformTime::Cycles64() : 0)
+	{
+	}
+
+	~FMultiplayerSessionsHitchScope()
+	{
+		if (StartCycles != 0)
+		{
+			MultiplayerSessionsHitchWatchdog::Check(Category, Name, StartCycles);
+		}
+	}
+
+private:
+	MultiplayerSessionsHitchWatchdog::ECategory Category;
+	const TCHAR* Name;
+	uint64 StartCycles;
+};
+
+/// Watches the rest of the scope, e.g. MULTIPLAYERSESSIONS_HITCH_SCOPE(Callback, OnCreateSessionComplete)
+#define MULTIPLAYERSESSIONS_HITCH_SCOPE(Category, Name) \
+	FMultiplayerSessionsHitchScope PREPROCESSOR_JOIN(HitchScope_, __LINE__)(MultiplayerSessionsHitchWatchdog::ECategory::Category, TEXT(#Name))
+
+/// Watches a travel call and names the map load it leads to, e.g. MULTIPLAYERSESSIONS_TRAVEL_HITCH_SCOPE(ClientTravel)
+#define MULTIPLAYERSESSIONS_TRAVEL_HITCH_SCOPE(Name) \
+	MultiplayerSessionsHitchWatchdog::BeginTravel(TEXT(#Name)); \
+	MULTIPLAYERSESSIONS_HITCH_SCOPE(Travel, Name)
@@ -5,6 +5,13 @@
 #include "CoreMinimal.h"
 #include "Subsystems/GameInstanceSubsystem.h"
 #include "Interfaces/OnlineSessionInterface.h"
+#include "GameFramework/OnlineReplStructs.h"
+#include "Engine/EngineBaseTypes.h"
+#include "Engine/EngineTypes.h"
+#include "SessionResultStore.h"
+#include "MultiplayerSessionsAsync.h"
+#include "GhostSessionCache.h"
+#include "Matchmaking.h"
 
 
 #include "MultiplayerSessionsSubsystem.generated.h"
@@ -29,14 +36,51 @@ DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FMultiplayerOnCreateSessionComplete,
 /// All parameters that are being passed through must be blueprint compatible to utilize the DYNAMIC Delegate
 /// Subtle syntax difference
 /// Delegate for when finding sessions
-DECLARE_MULTICAST_DELEGATE_TwoParams(FMultiplayerOnFindSessionsComplete, const TArray<FOnlineSessionSearchResult>& SearchResults, bool bWasSuccessful);
+/// The results come compacted, see FSessionResultStore; keep the reference for as long as they are shown
+DECLARE_MULTICAST_DELEGATE_TwoParams(FMultiplayerOnFindSessionsComplete, const TSharedRef<FSessionResultStore>& SearchResults, bool bWasSuccessful);
 /// Delegate for when a session is joined
 DECLARE_MULTICAST_DELEGATE_OneParam(FMultiplayerOnJoinSessionComplete, EOnJoinSessionCompleteResult::Type Result);
+/// Delegate for a join that waits for a full lobby, whenever its place in the host's waitlist changes (1 is next)
+DECLARE_MULTICAST_DELEGATE_OneParam(FMultiplayerOnWaitlistPosition, int32 Position);
 /// Delegate for when a session is destroyed
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FMultiplayerOnDestroySessionComplete, bool, bWasSuccessful);
 /// Delegate for when a session is started
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FMultiplayerOnStartSessionComplete, bool, bWasSuccessful);
 
+/// A player that can take over hosting the lobby, see UMultiplayerSessionsSubsystem::SetHostSuccessors
+USTRUCT()
+struct MULTIPLAYERSESSIONS_API FHostMigrationSuccessor
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	FUniqueNetIdRepl PlayerId;
+
+	/// Where the others connect once this player hosts (address:port, or steam.id:port)
+	UPROPERTY()
+	FString ConnectString;
+
+	bool operator==(const FHostMigrationSuccessor& Other) const { return PlayerId == Other.PlayerId && ConnectString == Other.ConnectString; }
+};
+
+/// The session a migration successor recreates; sent along with the successor list, because followers never joined
+/// the session of a host they reached by migrating, and so have no settings of their own to read it from
+USTRUCT()
+struct MULTIPLAYERSESSIONS_API FHostMigrationSession
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	int32 NumPublicConnections{ 0 };
+
+	/// Packed FSessionAttributes of the host's session
+	UPROPERTY()
+	uint64 Attributes{ 0 };
+
+	bool operator==(const FHostMigrationSession& Other) const { return NumPublicConnections == Other.NumPublicConnections && Attributes == Other.Attributes; }
+	bool operator!=(const FHostMigrationSession& Other) const { return !(*this == Other); }
+};
+
 
 UCLASS()
 class MULTIPLAYERSESSIONS_API UMultiplayerSessionsSubsystem : public UGameInstanceSubsystem
@@ -45,28 +89,143 @@ class MULTIPLAYERSESSIONS_API UMultiplayerSessionsSubsystem : public UGameInstan
 public:
 	UMultiplayerSessionsSubsystem();
 
+	/// Commandlets and other tools never create sessions, so they don't get the subsystem at all
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
 	///
 	/// To handle session functionality. The Menu class will call these functions.
 	///
 	
 	/// NumPublicConnections: The number of players that can join the session.
 	/// MatchType: The type of match that will be created. This is used to determine the type of session.
+	/// The session advertises its typed attributes (see SessionAttributeSchema.h), MatchType parsed into ESessionMatchType.
 	void CreateSession(int32 NumPublicConnections, FString MatchType); /// Create a session.
 	
 	/// FindSessions will find sessions that match the search parameters.
 	/// MaxSearchResults: The maximum number of search results to return.
-	void FindSessions(int32 MaxSearchResults); /// Find sessions.
+	/// MatchType: Only sessions of this match type are returned; empty returns every match type. An unknown one fails the search.
+	/// The results are filtered, deduplicated and ranked off the game thread, see FSessionResultStore::BuildRanked.
+	/// Only sessions of this build are ever returned, see FSessionAttributeFilter::MakeCompatible.
+	void FindSessions(int32 MaxSearchResults, const FString& MatchType = FString()); /// Find sessions.
+	void FindSessions(int32 MaxSearchResults, const FSessionAttributeFilter& Filter);
+
+	/// UpdateAdvertisedAttributes, the host's lobby state and player count as advertised in the session attributes.
+	/// Only updates the session when they changed.
+	void UpdateAdvertisedAttributes(ESessionLobbyState LobbyState, int32 NumPlayers);
+
+	/// ReleaseSearchResults, drops the results of the last search; the menu calls it when it closes, and travel does too.
+	/// Widgets that still hold the results (e.g. the server browser) keep them until they let go.
+	void ReleaseSearchResults();
+
+	/// GetLastSearchResults, the results of the last search, until they are released; nullptr when there are none
+	TSharedPtr<FSessionResultStore> GetLastSearchResults() const { return LastSearchResults; }
+
+	/// GetRecentHostResults, hosts seen or joined in earlier runs, most recent first, for a browser to show until a search comes back.
+	/// Joining one looks its session up by id first; it may have gone away since. See FRecentHostsCache.
+	TSharedRef<FSessionResultStore> GetRecentHostResults() const;
 	
 	/// JoinSession, will join the session with the given session name.
+	/// A join that fails because the session is gone (SessionDoesNotExist, CouldNotRetrieveAddress, no answer within
+	/// MultiplayerSessions.Join.Timeout) leaves the session out of search results for a while, see FGhostSessionCache.
 	/// SessionResult: The session that the player will join.
-	void JoinSession(const FOnlineSessionSearchResult& SessionResult); /// Join a session.
+	/// NumReservedSlots: Slots to reserve with the host before joining, more than one when bringing a party.
+	/// If the host is full, the join waits in the host's waitlist (MultiplayerOnWaitlistPosition reports its place) and
+	/// goes ahead once a player leaves. If the wait times out, or waiting is off (MultiplayerSessions.Reservations.WaitIfFull),
+	/// MultiplayerOnJoinSessionComplete fires with SessionIsFull without traveling.
+	void JoinSession(const FOnlineSessionSearchResult& SessionResult, int32 NumReservedSlots = 1); /// Join a session.
+
+	/// JoinSessionWithParty, the party leader's join: one search, one reservation for the leader and PartyMembers,
+	/// then the members are sent a session invite and follow without searching themselves.
+	void JoinSessionWithParty(const FOnlineSessionSearchResult& SessionResult, const TArray<FUniqueNetIdRef>& PartyMembers);
+
+	/// JoinBestSession, joins whichever of Candidates has the lowest latency right now.
+	/// Full sessions are left out, then the best MultiplayerSessions.Qos.NumCandidates by search ping are QoS probed first, see FSessionQosProber;
+	/// hosts that don't answer the probe fall back to their search ping.
+	/// CandidateIndices index into SearchResults.
+	void JoinBestSession(const FSessionResultStore& SearchResults, const TArray<int32>& CandidateIndices);
+
+	/// StartListeningForPartyInvites, lets this player follow a party leader by accepting their session invite.
+	/// A member who accepts joins the invited session and travels to it. MultiplayerOnJoinSessionComplete is not broadcast for it.
+	void StartListeningForPartyInvites();
 	
+	/// SetHostSuccessors, the host's ranked list of who takes over if it goes away; sent to every client of a listen-server lobby.
+	/// When the connection to the host is lost, the first successor recreates Session and hosts the lobby map,
+	/// and everyone else travels straight to its ConnectString. Successors that can't be reached are skipped.
+	void SetHostSuccessors(const TArray<FHostMigrationSuccessor>& Successors, const FHostMigrationSession& Session);
+
+	/// GetHostMigrationSession, what the host sends along with its successor list: the slots and attributes of its session
+	FHostMigrationSession GetHostMigrationSession() const;
+
 	/// DestroySession, will destroy the session that the player is currently in.
 	void DestroySession(); /// Destroy the session.
 	
 	/// StartSession, will start the session that the host created.
 	void StartSession(); /// Start the session.
 
+	///
+	/// TFuture versions of the calls above, for C++ callers that chain them, see MultiplayerSessionsAsync.h.
+	/// Each call of a kind supersedes the one of that kind still in flight, which then completes unsuccessfully.
+	/// Their completion is not broadcast through the delegates below.
+	///
+
+	TFuture<FCreateSessionResult> CreateSessionAsync(int32 NumPublicConnections, FString MatchType,
+		const FSessionCancellationToken& CancellationToken = FSessionCancellationToken());
+
+	/// Canceling stops the search and completes right away with no results
+	TFuture<FFindSessionsResult> FindSessionsAsync(int32 MaxSearchResults, const FString& MatchType = FString(),
+		const FSessionCancellationToken& CancellationToken = FSessionCancellationToken());
+
+	/// Canceling while the host is QoS probed or asked for a reservation stops the join there; once the online
+	/// subsystem's join is under way it runs to completion and only comes back flagged as canceled.
+	TFuture<FJoinSessionResult> JoinSessionAsync(const FOnlineSessionSearchResult& SessionResult,
+		const FSessionCancellationToken& CancellationToken = FSessionCancellationToken());
+	TFuture<FJoinSessionResult> JoinBestSessionAsync(const FSessionResultStore& SearchResults, const TArray<int32>& CandidateIndices,
+		const FSessionCancellationToken& CancellationToken = FSessionCancellationToken());
+
+	/// MatchmakeAsync, finds a session of MatchType and joins it, for players who don't pick their own.
+	/// Searches in Stages, tightest first (empty uses FMatchmakingStage::GetDefaultStages): each stage is a small search
+	/// the backend filters on the match type, repeated every MultiplayerSessions.Matchmaking.RequeryInterval seconds
+	/// until it finds a session the stage takes or its Duration is up, then the next, wider stage takes over.
+	/// The sessions the first successful stage takes are joined as with JoinBestSession. Ends with SessionDoesNotExist
+	/// when the last stage found nothing. See FMatchmakingStats for the per-stage hit rates and times.
+	/// Searching or joining anything else meanwhile ends the matchmaking.
+	TFuture<FJoinSessionResult> MatchmakeAsync(const FString& MatchType,
+		const FSessionCancellationToken& CancellationToken = FSessionCancellationToken(),
+		const TArray<FMatchmakingStage>& Stages = TArray<FMatchmakingStage>());
+
+	TFuture<FDestroySessionResult> DestroySessionAsync(const FSessionCancellationToken& CancellationToken = FSessionCancellationToken());
+
+	/// GetResolvedConnectString, gets the address to ClientTravel to once JoinSession has completed.
+	/// Returns false if there is no joined session or the address could not be resolved.
+	/// A recent host joined without its session (the backend can't look it up) gives the address it was last seen at.
+	bool GetResolvedConnectString(FString& OutAddress) const;
+
+	/// GetResolvedConnectString, gets the game address of a search result without joining it (e.g. to ping it).
+	bool GetResolvedConnectString(const FOnlineSessionSearchResult& SessionResult, FString& OutAddress) const;
+
+	/// BuildTravelURL, appends the options the host reads at login (trace correlation id, reservation token) to Address.
+	FString BuildTravelURL(const FString& Address) const;
+
+	/// GetCurrentSessionSettings, gets the settings of the session this game instance created or joined.
+	/// Returns nullptr when there is no session.
+	const FOnlineSessionSettings* GetCurrentSessionSettings() const;
+
+	///
+	/// Trace correlation, see MultiplayerSessionsTrace.h
+	///
+
+	/// BeginTraceCorrelation, starts a new host/join flow; Trigger is traced as its first event (e.g. "JoinButtonClicked").
+	/// Every session operation, travel and map load after this is traced with the returned id.
+	const FGuid& BeginTraceCorrelation(const TCHAR* Trigger);
+
+	/// GetTraceCorrelationId, the id of the current host/join flow. Append it to travel URLs with MultiplayerSessionsTrace::AddCorrelationIdToURL.
+	const FGuid& GetTraceCorrelationId() const { return TraceCorrelationId; }
+
+	/// EndTraceCorrelation, the player is in control of a pawn on the new map; closes the flow's time-to-lobby record and clears the id
+	void EndTraceCorrelation(const TCHAR* Phase);
+
 	
 	///
 	/// Our own custom delegates for the Menu class to bind callbacks to
@@ -76,6 +235,9 @@ public:
 	FMultiplayerOnJoinSessionComplete MultiplayerOnJoinSessionComplete;
 	FMultiplayerOnDestroySessionComplete MultiplayerOnDestroySessionComplete;
 	FMultiplayerOnStartSessionComplete MultiplayerOnStartSessionComplete;
+
+	/// Also broadcast for joins made through JoinSessionAsync; a wait is progress, not the call's result
+	FMultiplayerOnWaitlistPosition MultiplayerOnWaitlistPosition;
 	
 protected:
 	
@@ -99,13 +261,133 @@ protected:
 	
 	/// Callback function in response to starting a successful game session; bound to StartSessionCompleteDelegate
 	void OnStartSessionComplete(FName SessionName, bool bWasSuccessful); /// Called when the session is started.
+
+	/// Callback for a session invite the player accepted, see StartListeningForPartyInvites
+	void OnSessionUserInviteAccepted(const bool bWasSuccessful, const int32 ControllerId, FUniqueNetIdPtr UserId, const FOnlineSessionSearchResult& InviteResult);
+
+	/// Callback for the reservation beacon, see JoinSession
+	void OnReservationResponse(bool bHostReached, bool bAccepted, const FString& InReservationToken);
+	void OnWaitlistPosition(int32 Position);
+
+	/// Engine failure callbacks; losing the host starts a host migration, see SetHostSuccessors
+	void OnNetworkFailure(UWorld* World, UNetDriver* NetDriver, ENetworkFailure::Type FailureType, const FString& ErrorString);
+	void OnTravelFailure(UWorld* World, ETravelFailure::Type FailureType, const FString& ErrorString);
+
+	/// Map load callbacks, so the trace covers the load that follows ClientTravel/ServerTravel
+	void OnPreLoadMap(const FString& MapName);
+	void OnPostLoadMapWithWorld(UWorld* LoadedWorld);
 	
 private:
+	/// Gets the session interface on first use instead of at construction, see ResolveSessionInterface
+	/// Returns false if there is no online subsystem or it has no session interface
+	bool ResolveSessionInterface() const;
+
 	/// Smart pointer that wraps the IOnlineSessionInterface
-	IOnlineSessionPtr SessionInterface;
+	/// Mutable because it is resolved lazily, also from const getters
+	mutable IOnlineSessionPtr SessionInterface;
+	mutable bool bSessionInterfaceResolved{ false };
+
+	/// The NULL subsystem only does LAN sessions; cached with the interface instead of comparing names on every call
+	mutable bool bIsLANBackend{ false };
 	/// Shared Ptr that wraps the FOnlineSessionSettings, storing the last used session settings
 	TSharedPtr<FOnlineSessionSettings> LastSessionSettings;
+	/// Only alive while the search is running; its results are compacted into LastSearchResults
 	TSharedPtr<FOnlineSessionSearch> LastSessionSearch;
+	TSharedPtr<FSessionResultStore> LastSearchResults;
+	FSessionAttributeFilter LastSearchFilter;
+
+	/// Bumped by every search and canceled search, so results still being processed for an older one are dropped
+	uint32 SearchSerial{ 0 };
+
+	/// FindSessions, for the caller or for a matchmaking stage; the filter's query key is handed to the backend
+	void StartSessionSearch(int32 MaxSearchResults, const FSessionAttributeFilter& Filter, bool bForMatchmaking);
+
+	/// Game thread end of FindSessions, once the results are ranked and compacted
+	void FinishFindSessions(const TSharedRef<FSessionResultStore>& SearchResults, bool bWasSuccessful);
+
+	///
+	/// Matchmaking, see MatchmakeAsync
+	///
+
+	bool IsMatchmaking() const { return MatchmakingStageIndex != INDEX_NONE; }
+	void EnterMatchmakingStage(int32 StageIndex);
+	void SearchMatchmakingStage();
+	void OnMatchmakingSearchComplete(const TSharedRef<FSessionResultStore>& SearchResults);
+
+	/// Ends the matchmaking in flight, if any, and records it; the caller completes the join
+	void StopMatchmaking(bool bMatched, bool bCanceled);
+
+	TArray<FMatchmakingStage> MatchmakingStages;
+	int32 MatchmakingStageIndex{ INDEX_NONE };
+	ESessionMatchType MatchmakingMatchType{ ESessionMatchType::Unknown };
+	double MatchmakingStartTime{ 0.0 };
+	double MatchmakingStageStartTime{ 0.0 };
+	double MatchmakingSearchStartTime{ 0.0 };
+
+	/// Phase the current stage is traced as, "MatchmakingStage<N>"
+	FString MatchmakingStagePhase;
+
+	/// The search in flight is a matchmaking stage's, its results go to OnMatchmakingSearchComplete
+	bool bMatchmakingSearch{ false };
+
+	FTimerHandle MatchmakingTimerHandle;
+
+	///
+	/// Recent hosts, see FRecentHostsCache
+	///
+
+	/// Probes the most recent hosts while a search runs, so their results come with a measured ping
+	void PreProbeRecentHosts();
+	void OnRecentHostsProbeComplete(const TArray<int32>& RttsInMs);
+
+	/// Replaces the search ping of the results that were pre-probed
+	void ApplyRecentHostRtts(FSessionResultStore& SearchResults) const;
+
+	/// Remembers the best of a search's results
+	void RememberSearchResults(const FSessionResultStore& SearchResults);
+
+	/// A recent host has no session info to join with; ReserveAndJoinSession looks it up by id first
+	void OnRecentHostFound(int32 LocalUserNum, bool bWasSuccessful, const FOnlineSessionSearchResult& SearchResult, FString SessionId,
+		FString ConnectString, int32 NumReservedSlots);
+
+	/// Completes the join with the host's cached address and no session, for a backend that can't look the session up.
+	/// The host isn't forgotten or marked a ghost for that; failing to connect to it still marks it.
+	void JoinRecentHostDirectly(const FString& SessionId, const FString& ConnectString);
+
+	TSharedPtr<class FSessionQosProber> RecentHostsProber;
+	TArray<FString> PreProbedSessionIds;
+
+	/// Measured by the last pre-probe, by session id
+	TMap<FString, int32> RecentHostRtts;
+
+	/// The recent host being looked up, empty when there is none or the lookup was canceled
+	FString PendingRecentHostId;
+
+	/// Inside FindSessionById, to tell a backend's stub failing at once from a lookup that found nothing
+	bool bFindingRecentHost{ false };
+
+	/// FindSessionById isn't implemented by the online subsystem; recent hosts are joined by their cached address
+	bool bRecentHostLookupUnsupported{ false };
+
+	/// The cached address of the recent host joined directly, returned by GetResolvedConnectString until we travel there
+	FString DirectJoinAddress;
+
+	///
+	/// Ghost sessions, see FGhostSessionCache
+	///
+
+	/// The online subsystem's join never answered
+	void OnJoinTimeout();
+
+	FGhostSessionCache GhostSessions;
+
+	/// The session the join in flight is for, to blame its failure on
+	FString JoiningSessionId;
+
+	/// Joined and traveling to its host; the host not answering the connection before the map loads marks it a ghost too
+	FString TravelingSessionId;
+
+	FTimerHandle JoinTimeoutTimerHandle;
 	
 	
 	///
@@ -133,6 +415,107 @@ private:
 	FOnStartSessionCompleteDelegate StartSessionCompleteDelegate;
 	FDelegateHandle StartSessionCompleteDelegateHandle;
 	
+	/// Id of the current host/join flow, carried by every trace event
+	FGuid TraceCorrelationId;
+	FDelegateHandle PreLoadMapHandle;
+	FDelegateHandle PostLoadMapHandle;
+
+	/// Asks the host of SessionResult to reserve NumSlots; returns false if there is no beacon to ask
+	bool RequestReservation(const FOnlineSessionSearchResult& SessionResult, int32 NumSlots);
+
+	/// Reserves NumReservedSlots (for the party in PendingPartyMembers, if any), then joins
+	void ReserveAndJoinSession(const FOnlineSessionSearchResult& SessionResult, int32 NumReservedSlots);
+
+	/// The online subsystem part of JoinSession, after the reservation
+	void JoinReservedSession(const FOnlineSessionSearchResult& SessionResult);
+
+	/// Fulfil the async call of that kind if there is one, otherwise broadcast the delegate
+	void CompleteCreateSession(bool bWasSuccessful);
+	void CompleteFindSessions(const TSharedRef<FSessionResultStore>& SearchResults, bool bWasSuccessful);
+	void CompleteJoinSession(EOnJoinSessionCompleteResult::Type Result);
+	void CompleteDestroySession(bool bWasSuccessful);
+
+	/// Stops the QoS probe or the reservation of the join in flight, see JoinSessionAsync; false if the join is past them
+	bool CancelPendingJoin();
+
+	TPendingSessionOperation<FCreateSessionResult> PendingCreateSession;
+	TPendingSessionOperation<FFindSessionsResult> PendingFindSessions;
+	TPendingSessionOperation<FJoinSessionResult> PendingJoinSession;
+	TPendingSessionOperation<FDestroySessionResult> PendingDestroySession;
+
+	/// Sends the session invite to the party the leader just joined with
+	void InvitePendingParty();
+
+	/// Picks the lowest measured RTT among QosCandidates and joins it, see JoinBestSession
+	void OnQosProbeComplete(const TArray<int32>& RttsInMs);
+
+	TSharedPtr<class FSessionQosProber> QosProber;
+
+	///
+	/// Host migration, see SetHostSuccessors
+	///
+	enum class EHostMigrationRole : uint8
+	{
+		None,
+		Successor,	/// Recreating the session and hosting the lobby
+		Follower	/// Connecting to the successor
+	};
+
+	/// Takes the successor at MigrationSuccessorIndex, as the new host or as the one to follow
+	void AssumeMigrationRole();
+
+	/// Successor: recreates the session the old host advertised, then hosts the lobby map on OnCreateSessionComplete
+	void RecreateMigratedSession();
+
+	/// Follower: travels to the current successor; retried until the successor's time is up, then the next one is tried
+	void FollowSuccessor();
+	void OnFollowAttemptFailed();
+
+	/// An attempt got no failure and no map; one that is still connecting is left alone until the successor's time is up
+	void OnFollowAttemptTimedOut();
+
+	/// Logs the downtime from losing the host to being in the new lobby
+	void FinishHostMigration(bool bSucceeded);
+
+	TArray<FHostMigrationSuccessor> HostSuccessors;
+	FHostMigrationSession HostSession;
+	FString LobbyMapPath;
+
+	EHostMigrationRole MigrationRole{ EHostMigrationRole::None };
+	int32 MigrationSuccessorIndex{ 0 };
+	double MigrationStartTime{ 0.0 };
+	double SuccessorStartTime{ 0.0 };
+	int32 MigrationAttempts{ 0 };
+
+	/// The engine sends a client that lost its host back to the default map; migration goes on from there
+	bool bMigrationWaitingForEntryMap{ false };
+
+	/// The old session's settings, for the successor to recreate it with
+	int32 MigratedNumPublicConnections{ 0 };
+	FString MigratedMatchType;
+
+	FTimerHandle MigrationTimerHandle;
+	FDelegateHandle NetworkFailureHandle;
+	FDelegateHandle TravelFailureHandle;
+	TArray<FOnlineSessionSearchResult> QosCandidates;
+
+	/// Party members to invite once the leader's join completes
+	TArray<FUniqueNetIdRef> PendingPartyMembers;
+
+	/// Joining because a party leader invited us; we travel on our own when the join completes
+	bool bFollowingParty{ false };
+
+	FDelegateHandle SessionUserInviteAcceptedDelegateHandle;
+
+	UPROPERTY()
+	TWeakObjectPtr<class ALobbyReservationBeaconClient> ReservationBeacon;
+
+	/// Session to join once the reservation is answered
+	FOnlineSessionSearchResult PendingJoinResult;
+
+	/// Handed out by the host's reservation beacon, sent back with the travel URL
+	FString ReservationToken;
+
 	bool bCreateSessionOnDestroy{ false };
 	int32 LastNumPublicConnections;
 	FString LastMatchType;
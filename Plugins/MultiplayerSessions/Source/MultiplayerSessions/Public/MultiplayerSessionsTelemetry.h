@@ -0,0 +1,74 @@
+/// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MultiplayerSessionsTrace.h"
+#include "Tasks/Task.h"
+
+///
+/// Time-to-lobby telemetry.
+/// Times every phase of a host/join (click, session operation, travel, map load, login, first possessed tick)
+/// against the moment the flow started, and appends one JSON record per flow to Saved/Telemetry/TimeToLobby.jsonl.
+/// Records are serialized and appended on a background task, in the order the flows ended.
+///
+/// Phases come from MultiplayerSessionsTrace::TracePhase, so anything that is traced is also timed here.
+/// Flows are keyed by the trace correlation id. A client and the server it joined each write their own record
+/// with the same id; MultiplayerSessions.Telemetry.Report merges them and prints where the time goes.
+///
+class MULTIPLAYERSESSIONS_API FMultiplayerSessionsTelemetry
+{
+public:
+	static FMultiplayerSessionsTelemetry& Get();
+
+	/// Trigger of the flows the server opens for players that log in with a correlation id
+	static const TCHAR* ServerLoginTrigger;
+
+	/// Starts timing a flow that was triggered by Trigger (e.g. "JoinButtonClicked"). Does nothing if the flow is already open.
+	/// Starting a new local flow closes the previous one as "Abandoned" (e.g. the join failed and the player clicked again).
+	void BeginFlow(const FGuid& CorrelationId, const TCHAR* Trigger);
+
+	/// Records the begin/end of a phase of an open flow; ignored for unknown or finished flows
+	void RecordPhase(const FGuid& CorrelationId, const TCHAR* Phase, EMultiplayerSessionsTraceEdge Edge);
+
+	/// Closes the flow and writes its record; Result is the last phase, e.g. "FirstPossessedTick"
+	void EndFlow(const FGuid& CorrelationId, const TCHAR* Result);
+
+	/// Waits for the records still being written
+	void Flush();
+
+	bool IsFlowOpen(const FGuid& CorrelationId) const { return Flows.Contains(CorrelationId); }
+
+	/// Saved/Telemetry/TimeToLobby.jsonl
+	static FString GetRecordFilename();
+
+	/// Reads the records in Filename and logs the time-to-lobby breakdown across all of them
+	static void Report(const FString& Filename);
+
+private:
+	struct FPhase
+	{
+		FString Name;
+		double BeginTime{ 0.0 };
+		double EndTime{ -1.0 };
+	};
+
+	struct FFlow
+	{
+		FString Trigger;
+		double StartTime{ 0.0 };
+		FDateTime StartDateTime;
+		TArray<FPhase> Phases;
+	};
+
+	/// Serializes the flow as one line of JSON and appends it to the record file; runs on a background task
+	static void WriteRecord(const FGuid& CorrelationId, const FFlow& Flow, const FString& Result, double EndTime);
+
+	TMap<FGuid, FFlow> Flows;
+
+	/// The last record write; the next one waits for it so records are appended in order
+	UE::Tasks::FTask PendingWrite;
+
+	/// The flow started by this process' own player, see BeginFlow
+	FGuid LocalFlowId;
+};
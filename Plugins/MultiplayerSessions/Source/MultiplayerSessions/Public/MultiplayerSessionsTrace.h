@@ -0,0 +1,45 @@
+/// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Trace/Trace.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+#include "ProfilingDebugging/MiscTrace.h"
+
+///
+/// Unreal Insights trace channel for session and lobby events.
+/// Enable it with -trace=cpu,bookmark,MultiplayerSessions (or "Trace.Enable MultiplayerSessions" at runtime).
+///
+/// Every phase of a host/join is traced as a begin/end pair carrying a correlation id. The id is created when the
+/// player clicks Host or Join, and travels to the server as a URL option, so one player's join can be followed
+/// end to end in the client's and the server's traces.
+///
+UE_TRACE_CHANNEL_EXTERN(MultiplayerSessionsChannel, MULTIPLAYERSESSIONS_API);
+
+/// CPU scope on the MultiplayerSessions channel
+#define MULTIPLAYERSESSIONS_TRACE_SCOPE(Name) TRACE_CPUPROFILER_EVENT_SCOPE_ON_CHANNEL(Name, MultiplayerSessionsChannel)
+
+/// Whether an event starts a phase, ends it, or is a single point in time
+enum class EMultiplayerSessionsTraceEdge : uint8
+{
+	Begin,
+	End,
+	Instant,
+};
+
+namespace MultiplayerSessionsTrace
+{
+	/// URL option that carries the correlation id through ClientTravel/ServerTravel to the server's Login
+	MULTIPLAYERSESSIONS_API extern const TCHAR* CorrelationIdOption;
+
+	/// Emits a timing event and an Insights bookmark for a phase of the join, e.g. ("FindSessions", Begin)
+	/// The phase is also recorded for time-to-lobby telemetry, see MultiplayerSessionsTelemetry.h
+	MULTIPLAYERSESSIONS_API void TracePhase(const FGuid& CorrelationId, const TCHAR* Phase, EMultiplayerSessionsTraceEdge Edge);
+
+	/// Appends ?<CorrelationIdOption>=<id> to a travel URL; returns the URL unchanged for an invalid id
+	MULTIPLAYERSESSIONS_API FString AddCorrelationIdToURL(const FString& URL, const FGuid& CorrelationId);
+
+	/// Reads the correlation id out of login/travel options; returns an invalid guid if there is none
+	MULTIPLAYERSESSIONS_API FGuid ParseCorrelationId(const FString& Options);
+}
@@ -0,0 +1,144 @@
+/// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "OnlineSessionSettings.h"
+#include "Containers/Ticker.h"
+#include "Tasks/Task.h"
+
+class IMappedFileHandle;
+class IMappedFileRegion;
+class FSessionResultStore;
+
+/// One host in Saved/MultiplayerSessions/RecentHosts.bin; fixed size, so the file is read in place once mapped
+/// Strings are UTF-8, zero terminated, and cut to fit
+struct FRecentHostRecord
+{
+	ANSICHAR SessionId[96];
+	ANSICHAR OwningUserName[64];
+
+	/// host:gameport as last resolved, to probe the host before a search finds it again
+	ANSICHAR ConnectString[64];
+
+	int64 LastSeenUnixTime;
+
+	/// The packed FSessionAttributes the host advertised
+	uint64 Attributes;
+
+	int32 PingInMs;
+	int32 QosPort;
+	uint16 NumPublicConnections;
+	uint16 NumOpenPublicConnections;
+
+	/// ERecentHostFlags
+	uint32 Flags;
+};
+
+enum class ERecentHostFlags : uint32
+{
+	None = 0,
+	Joined = 1 << 0,	/// The player joined this host at least once; kept over hosts only seen in a search
+};
+ENUM_CLASS_FLAGS(ERecentHostFlags);
+
+///
+/// Hosts seen in recent searches or joined, kept on disk so the next launch can list and probe them before its own
+/// search comes back.
+///
+/// The file is a small header and an array of FRecentHostRecord. It is memory mapped at startup and read in place.
+/// A file with another version or record size is ignored and overwritten by the next save.
+/// Updates are merged into a copy and written out whole (a few hundred records at most) on a background task, a few
+/// seconds after the first change, on travel and on shutdown. The least recently seen hosts are evicted past
+/// MultiplayerSessions.RecentHosts.MaxEntries, and hosts not seen for MaxAgeDays are dropped.
+///
+/// Game thread only, apart from the file writes.
+///
+class MULTIPLAYERSESSIONS_API FRecentHostsCache
+{
+public:
+	static FRecentHostsCache& Get();
+	~FRecentHostsCache();
+
+	/// Bump when FRecentHostRecord changes
+	static constexpr uint32 FileVersion = 2;
+
+	/// Settings a cached host's result carries in place of the session info it doesn't have, see MakeResultStore
+	static const FName SessionIdSettingKey;
+	static const FName ConnectStringSettingKey;
+
+	static bool IsEnabled();
+
+	/// How many of the recent hosts to probe while a search is running
+	static int32 GetNumToPreProbe();
+
+	/// Most hosts of one search worth remembering; the results are ranked, so these are the best ones
+	static int32 GetMaxPerSearch();
+
+	/// Saved/MultiplayerSessions/RecentHosts.bin
+	static FString GetFilename();
+
+	/// Maps the file; does nothing if it is already mapped
+	void Load();
+
+	/// Most recently seen first
+	TArrayView<const FRecentHostRecord> GetRecords() const;
+
+	/// Remembers Session (seen now, with PingInMs and ConnectString); saved with the next save
+	void RecordHost(const FOnlineSession& Session, int32 PingInMs, const FString& ConnectString, bool bJoined);
+	void RecordHosts(const TArray<FOnlineSessionSearchResult>& Results, const TArray<FString>& ConnectStrings);
+
+	/// Updates the last ping of the host with SessionId, written with the next save
+	void UpdatePing(const FString& SessionId, int32 PingInMs);
+
+	/// Forgets a host that doesn't exist anymore
+	void Forget(const FString& SessionId);
+
+	/// Evicts, then starts writing the records out on a background task, if they changed since the last save
+	void Save();
+
+	/// Saves and waits for the writes still running
+	void Flush();
+
+	/// The recent hosts as search results for the server browser, most recently seen first.
+	/// They have no session info; UMultiplayerSessionsSubsystem::JoinSession looks the session up by SessionIdSettingKey.
+	/// Hosts in ExcludedSessionIds, and hosts of another schema or build version, are left out.
+	TSharedRef<FSessionResultStore> MakeResultStore(const TSet<FString>& ExcludedSessionIds = TSet<FString>()) const;
+
+	static FString GetSessionId(const FRecentHostRecord& Record);
+	static FString GetConnectString(const FRecentHostRecord& Record);
+
+private:
+	FRecentHostsCache() = default;
+
+	/// Adds Session, or updates it if it is already known
+	void Merge(const FOnlineSession& Session, int32 PingInMs, const FString& ConnectString, bool bJoined, int64 Now);
+
+	/// Copies the mapped records so they can be changed; the mapping is released
+	TArray<FRecentHostRecord>& GetWritableRecords();
+
+	/// Schedules a save in SaveDelay seconds, unless one is already scheduled
+	void MarkDirty();
+
+	void Unmap();
+
+	int32 FindRecord(const FString& SessionId) const;
+
+	/// Mapped file, while the records haven't been changed since loading
+	TUniquePtr<IMappedFileHandle> MappedFile;
+	TUniquePtr<IMappedFileRegion> MappedRegion;
+	const FRecentHostRecord* MappedRecords{ nullptr };
+	int32 NumMappedRecords{ 0 };
+
+	/// The records once they have been changed, or read when the platform can't map the file
+	TArray<FRecentHostRecord> OwnedRecords;
+
+	bool bLoaded{ false };
+
+	/// Changed since the last save
+	bool bDirty{ false };
+	FTSTicker::FDelegateHandle SaveTickerHandle;
+
+	/// The last file write; the next one waits for it, so the newest records end up on disk
+	UE::Tasks::FTask PendingSave;
+};
@@ -0,0 +1,152 @@
+/// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Blueprint/UserWidget.h"
+#include "OnlineSessionSettings.h"
+#include "SessionResultStore.h"
+#include "ServerBrowser.generated.h"
+
+UENUM(BlueprintType)
+enum class EServerBrowserSortKey : uint8
+{
+	None,
+	Ping,
+	Players,
+	MatchType,
+};
+
+/// Broadcast when the player picks a session to join
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnServerBrowserJoinRequested, const FOnlineSessionSearchResult& SessionResult);
+
+///
+/// Server browser for FindSessions results.
+/// Rows are shown in a UListView, which only builds entry widgets for the rows on screen and recycles them while
+/// scrolling, so a search with thousands of results costs a handful of widgets. The row objects themselves are
+/// created a batch per frame, so handing the browser 10k results doesn't hitch either.
+///
+/// The widget blueprint needs a ListView named SessionList whose entry class implements UserObjectListEntry
+/// (e.g. a child of UServerBrowserEntry). The sort and join buttons are optional.
+///
+UCLASS()
+class MULTIPLAYERSESSIONS_API UServerBrowser : public UUserWidget
+{
+	GENERATED_BODY()
+
+public:
+	/// Replaces the listed sessions; rows appear over the next frames, see ItemsPerFrame
+	void SetSearchResults(const TSharedRef<FSessionResultStore>& SearchResults);
+
+	/// Also lets go of the results, see UMultiplayerSessionsSubsystem::ReleaseSearchResults
+	void ClearSearchResults();
+
+	/// Whether any sessions are listed, from a search or the recent hosts
+	bool HasSearchResults() const { return NumSearchResults() > 0; }
+
+	/// Sorts by Key; sorting again by the same key flips the direction
+	UFUNCTION(BlueprintCallable, Category = "Server Browser")
+	void SortBy(EServerBrowserSortKey Key);
+
+	FOnServerBrowserJoinRequested OnJoinRequested;
+
+protected:
+	virtual bool Initialize() override;
+	virtual void NativeTick(const FGeometry& MyGeometry, float InDeltaTime) override;
+
+	virtual void NativeConstruct() override;
+	virtual void NativeDestruct() override;
+
+	/// Row objects created per frame while populating
+	UPROPERTY(EditAnywhere, Category = "Server Browser", meta = (ClampMin = "1"))
+	int32 ItemsPerFrame{ 512 };
+
+	/// How often the pings of the rows on screen are refreshed; 0 turns the refresh off
+	UPROPERTY(EditAnywhere, Category = "Server Browser|Ping", meta = (ClampMin = "0"))
+	float PingRefreshInterval{ 1.f };
+
+	/// Pings in flight at once
+	UPROPERTY(EditAnywhere, Category = "Server Browser|Ping", meta = (ClampMin = "1"))
+	int32 MaxConcurrentPings{ 8 };
+
+	/// How long a measured ping is shown before the row is probed again
+	UPROPERTY(EditAnywhere, Category = "Server Browser|Ping", meta = (ClampMin = "0"))
+	float PingTimeToLive{ 10.f };
+
+	UPROPERTY(EditAnywhere, Category = "Server Browser|Ping", meta = (ClampMin = "0.1"))
+	float PingTimeout{ 1.f };
+
+private:
+	UPROPERTY(meta = (BindWidget))
+	class UListView* SessionList;
+
+	UPROPERTY(meta = (BindWidgetOptional))
+	class UButton* SortByPingButton;
+
+	UPROPERTY(meta = (BindWidgetOptional))
+	UButton* SortByPlayersButton;
+
+	UPROPERTY(meta = (BindWidgetOptional))
+	UButton* SortByMatchTypeButton;
+
+	/// Joins the selected row; double clicking a row does the same
+	UPROPERTY(meta = (BindWidgetOptional))
+	UButton* JoinSelectedButton;
+
+	/// "Showing X of Y sessions"
+	UPROPERTY(meta = (BindWidgetOptional))
+	class UTextBlock* StatusText;
+
+	UFUNCTION()
+	void SortByPingClicked();
+
+	UFUNCTION()
+	void SortByPlayersClicked();
+
+	UFUNCTION()
+	void SortByMatchTypeClicked();
+
+	UFUNCTION()
+	void JoinSelectedClicked();
+
+	void OnItemDoubleClicked(UObject* Item);
+	void RequestJoin(const class UServerBrowserItem* Item);
+
+	/// Creates the next batch of row objects; when sorted, the batch is sorted and merged into the rows already listed
+	void PopulateNextBatch();
+
+	/// Sorts Items by the current key and hands them to the list view
+	void ApplySort();
+
+	void UpdateStatusText();
+
+	/// Asks the ping service about the rows on screen; cached answers are applied right away
+	void RefreshVisiblePings();
+	void OnPingUpdated(const FString& SessionId, int32 PingInMs);
+
+	/// Writes a new ping into the row, and into the entry widget if the row is on screen
+	void ApplyPing(UServerBrowserItem* Item, int32 PingInMs);
+
+	TSharedPtr<class FSessionPingService> PingService;
+	float TimeUntilPingRefresh{ 0.f };
+
+	/// Rows by session id, for ping answers
+	TMap<FString, UServerBrowserItem*> ItemsBySessionId;
+
+	/// The results the rows point into
+	TSharedPtr<FSessionResultStore> SearchResults;
+
+	int32 NumSearchResults() const { return SearchResults.IsValid() ? SearchResults->Num() : 0; }
+	bool IsValidResultIndex(int32 Index) const { return SearchResults.IsValid() && SearchResults->IsValidIndex(Index); }
+
+	/// Row objects created so far, in display order
+	UPROPERTY(Transient)
+	TArray<class UServerBrowserItem*> Items;
+
+	/// Row objects from the previous search, reused before new ones are created
+	UPROPERTY(Transient)
+	TArray<UServerBrowserItem*> FreeItems;
+
+	EServerBrowserSortKey SortKey{ EServerBrowserSortKey::None };
+	bool bSortAscending{ true };
+};
@@ -0,0 +1,39 @@
+/// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Blueprint/UserWidget.h"
+#include "Blueprint/IUserObjectListEntry.h"
+#include "ServerBrowserEntry.generated.h"
+
+///
+/// Row widget of the server browser's list view.
+/// The list view only creates enough of these to fill the visible area and hands them a new UServerBrowserItem
+/// as the player scrolls, so everything a row shows has to be set in NativeOnListItemObjectSet.
+///
+UCLASS()
+class MULTIPLAYERSESSIONS_API UServerBrowserEntry : public UUserWidget, public IUserObjectListEntry
+{
+	GENERATED_BODY()
+
+public:
+	/// Shows Item's current values; also called when a value of the displayed item changes, e.g. its ping
+	void UpdateFromItem(const class UServerBrowserItem* Item);
+
+protected:
+	virtual void NativeOnListItemObjectSet(UObject* ListItemObject) override;
+
+private:
+	UPROPERTY(meta = (BindWidgetOptional))
+	class UTextBlock* ServerNameText;
+
+	UPROPERTY(meta = (BindWidgetOptional))
+	UTextBlock* MatchTypeText;
+
+	UPROPERTY(meta = (BindWidgetOptional))
+	UTextBlock* PlayersText;
+
+	UPROPERTY(meta = (BindWidgetOptional))
+	UTextBlock* PingText;
+};
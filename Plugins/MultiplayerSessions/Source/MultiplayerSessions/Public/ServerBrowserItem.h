@@ -0,0 +1,41 @@
+/// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Object.h"
+#include "ServerBrowserItem.generated.h"
+
+///
+/// One row of the server browser.
+/// Only the values shown and sorted on are copied out of the search result; the result itself stays in the browser
+/// and is looked up by ResultIndex when the player joins.
+///
+UCLASS(BlueprintType)
+class MULTIPLAYERSESSIONS_API UServerBrowserItem : public UObject
+{
+	GENERATED_BODY()
+
+public:
+	/// Index into the browser's search results
+	int32 ResultIndex{ INDEX_NONE };
+
+	/// Key for the ping refresh, see FSessionPingService
+	FString SessionId;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Server Browser")
+	FString OwningUserName;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Server Browser")
+	FString MatchType;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Server Browser")
+	int32 NumPlayers{ 0 };
+
+	UPROPERTY(BlueprintReadOnly, Category = "Server Browser")
+	int32 MaxPlayers{ 0 };
+
+	/// Measured at search time, then re-measured while the row is on screen
+	UPROPERTY(BlueprintReadOnly, Category = "Server Browser")
+	int32 PingInMs{ 0 };
+};
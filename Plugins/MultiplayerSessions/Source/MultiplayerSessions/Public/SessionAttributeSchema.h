@@ -0,0 +1,196 @@
+/// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class FOnlineSessionSettings;
+
+///
+/// Typed session attributes, declared once at compile time and advertised packed into a single integer setting.
+/// A string setting costs its key and value in every advertisement and ping reply, and every search result a map
+/// lookup and a string compare; the packed attributes cost one int64, are read without allocating, and a search
+/// filters them with one masked compare, see FSessionAttributeFilter.
+///
+/// The attributes a search matches exactly are also advertised, to the online service only, under the query keys, so
+/// the backend filters on them instead of returning every session, see FSessionAttributeFilter::GetQuerySetting.
+///
+/// Adding an attribute: add a line to MULTIPLAYERSESSIONS_SESSION_ATTRIBUTES and bump SchemaVersion. Sessions that
+/// advertise another schema version or build version are never listed, so their attributes are never misread.
+///
+
+enum class ESessionMatchType : uint8
+{
+	Unknown,
+	FreeForAll,
+	TeamDeathmatch,
+	CaptureTheFlag,
+	Num
+};
+
+enum class ESessionRegion : uint8
+{
+	Unknown,
+	NorthAmerica,
+	SouthAmerica,
+	Europe,
+	Asia,
+	Oceania,
+	Africa,
+	MiddleEast,
+	Num
+};
+
+enum class ESessionLobbyState : uint8
+{
+	Unknown,
+	Waiting,	/// In the lobby, joinable
+	InProgress,	/// The match started; joinable only if the session allows join in progress
+	Ending,
+	Num
+};
+
+MULTIPLAYERSESSIONS_API const TCHAR* LexToString(ESessionMatchType MatchType);
+MULTIPLAYERSESSIONS_API const TCHAR* LexToString(ESessionRegion Region);
+MULTIPLAYERSESSIONS_API const TCHAR* LexToString(ESessionLobbyState LobbyState);
+
+/// Case-insensitive; false (and Unknown) for names that aren't one of the values
+MULTIPLAYERSESSIONS_API bool LexTryParseString(ESessionMatchType& OutMatchType, const TCHAR* String);
+MULTIPLAYERSESSIONS_API bool LexTryParseString(ESessionRegion& OutRegion, const TCHAR* String);
+
+/// Attribute(Name, Type, Bits): low bits first. The total must fit in 64 bits.
+#define MULTIPLAYERSESSIONS_SESSION_ATTRIBUTES(Attribute) \
+	Attribute(SchemaVersion, uint8, 4) \
+	Attribute(BuildVersion, uint16, 16) \
+	Attribute(MatchType, ESessionMatchType, 4) \
+	Attribute(Region, ESessionRegion, 4) \
+	Attribute(LobbyState, ESessionLobbyState, 3) \
+	Attribute(MaxPlayers, uint8, 8) \
+	Attribute(NumPlayers, uint8, 8)
+
+namespace MultiplayerSessionsSchema
+{
+	/// Bump when an attribute is added, removed, resized or reordered
+	static constexpr uint8 SchemaVersion = 1;
+
+	/// Setting the packed attributes are advertised in; short, it is sent with every ping reply
+	MULTIPLAYERSESSIONS_API extern const FName SettingKey;
+
+	enum EAttributeIndex : int32
+	{
+#define MULTIPLAYERSESSIONS_ATTRIBUTE_INDEX(Name, Type, Bits) Name##Index,
+		MULTIPLAYERSESSIONS_SESSION_ATTRIBUTES(MULTIPLAYERSESSIONS_ATTRIBUTE_INDEX)
+#undef MULTIPLAYERSESSIONS_ATTRIBUTE_INDEX
+		NumAttributes
+	};
+
+	static constexpr int32 AttributeBits[] =
+	{
+#define MULTIPLAYERSESSIONS_ATTRIBUTE_BITS(Name, Type, Bits) Bits,
+		MULTIPLAYERSESSIONS_SESSION_ATTRIBUTES(MULTIPLAYERSESSIONS_ATTRIBUTE_BITS)
+#undef MULTIPLAYERSESSIONS_ATTRIBUTE_BITS
+	};
+
+	constexpr int32 GetOffset(int32 Index)
+	{
+		return Index == 0 ? 0 : GetOffset(Index - 1) + AttributeBits[Index - 1];
+	}
+
+	constexpr uint64 GetMask(int32 Index)
+	{
+		return ((uint64(1) << AttributeBits[Index]) - 1) << GetOffset(Index);
+	}
+
+	/// Query keys, and the attributes each one carries; none of them change while the session lives
+	MULTIPLAYERSESSIONS_API extern const FName MatchQueryKey;
+	MULTIPLAYERSESSIONS_API extern const FName RegionQueryKey;
+	static constexpr uint64 MatchQueryMask = GetMask(SchemaVersionIndex) | GetMask(BuildVersionIndex) | GetMask(MatchTypeIndex);
+	static constexpr uint64 RegionQueryMask = MatchQueryMask | GetMask(RegionIndex);
+
+	static_assert(GetOffset(NumAttributes) <= 64, "The session attributes must pack into one int64");
+	static_assert(uint64(ESessionMatchType::Num) <= (GetMask(MatchTypeIndex) >> GetOffset(MatchTypeIndex)) + 1, "MatchType has too few bits");
+	static_assert(uint64(ESessionRegion::Num) <= (GetMask(RegionIndex) >> GetOffset(RegionIndex)) + 1, "Region has too few bits");
+	static_assert(uint64(ESessionLobbyState::Num) <= (GetMask(LobbyStateIndex) >> GetOffset(LobbyStateIndex)) + 1, "LobbyState has too few bits");
+	static_assert(SchemaVersion <= (GetMask(SchemaVersionIndex) >> GetOffset(SchemaVersionIndex)), "SchemaVersion has too few bits");
+
+	/// Value shifted into its attribute's place; out of range values are cut to the attribute's bits
+	template <typename ValueType>
+	constexpr uint64 PackValue(int32 Index, ValueType Value)
+	{
+		return (static_cast<uint64>(Value) << GetOffset(Index)) & GetMask(Index);
+	}
+
+	/// MultiplayerSessions.Schema.BuildVersion; sessions of other builds aren't listed
+	MULTIPLAYERSESSIONS_API uint16 GetBuildVersion();
+
+	/// FOnlineSessionSettings::BuildUniqueId, from the schema and build version
+	MULTIPLAYERSESSIONS_API int32 GetBuildUniqueId();
+
+	/// MultiplayerSessions.Schema.Region, the region this player hosts in
+	MULTIPLAYERSESSIONS_API ESessionRegion GetLocalRegion();
+}
+
+/// The attributes of one session, unpacked
+struct MULTIPLAYERSESSIONS_API FSessionAttributes
+{
+#define MULTIPLAYERSESSIONS_ATTRIBUTE_FIELD(Name, Type, Bits) Type Name{};
+	MULTIPLAYERSESSIONS_SESSION_ATTRIBUTES(MULTIPLAYERSESSIONS_ATTRIBUTE_FIELD)
+#undef MULTIPLAYERSESSIONS_ATTRIBUTE_FIELD
+
+	/// This build's schema, build version and region; the rest is left for the host to fill in
+	static FSessionAttributes MakeLocal();
+
+	uint64 Pack() const
+	{
+		uint64 Packed = 0;
+#define MULTIPLAYERSESSIONS_ATTRIBUTE_PACK(Name, Type, Bits) Packed |= MultiplayerSessionsSchema::PackValue(MultiplayerSessionsSchema::Name##Index, Name);
+		MULTIPLAYERSESSIONS_SESSION_ATTRIBUTES(MULTIPLAYERSESSIONS_ATTRIBUTE_PACK)
+#undef MULTIPLAYERSESSIONS_ATTRIBUTE_PACK
+		return Packed;
+	}
+
+	static FSessionAttributes Unpack(uint64 Packed)
+	{
+		FSessionAttributes Attributes;
+#define MULTIPLAYERSESSIONS_ATTRIBUTE_UNPACK(Name, Type, Bits) \
+		Attributes.Name = static_cast<Type>((Packed & MultiplayerSessionsSchema::GetMask(MultiplayerSessionsSchema::Name##Index)) >> MultiplayerSessionsSchema::GetOffset(MultiplayerSessionsSchema::Name##Index));
+		MULTIPLAYERSESSIONS_SESSION_ATTRIBUTES(MULTIPLAYERSESSIONS_ATTRIBUTE_UNPACK)
+#undef MULTIPLAYERSESSIONS_ATTRIBUTE_UNPACK
+		return Attributes;
+	}
+
+	/// Advertises the packed attributes in Settings (online service and ping), and the query keys (online service)
+	void Write(FOnlineSessionSettings& Settings) const;
+
+	/// The packed attributes Settings advertise; false, and 0, if they advertise none. Doesn't allocate.
+	static bool Read(const FOnlineSessionSettings& Settings, uint64& OutPacked);
+};
+
+///
+/// Which attribute values a search wants, as a mask and the values under it.
+/// Matching a session is one AND and one compare on its packed attributes.
+///
+struct MULTIPLAYERSESSIONS_API FSessionAttributeFilter
+{
+	uint64 Mask{ 0 };
+	uint64 Value{ 0 };
+
+	/// Sessions this build can join: same schema and build version
+	static FSessionAttributeFilter MakeCompatible();
+
+#define MULTIPLAYERSESSIONS_ATTRIBUTE_FILTER(Name, Type, Bits) \
+	FSessionAttributeFilter& With##Name(Type In) \
+	{ \
+		Mask |= MultiplayerSessionsSchema::GetMask(MultiplayerSessionsSchema::Name##Index); \
+		Value = (Value & ~MultiplayerSessionsSchema::GetMask(MultiplayerSessionsSchema::Name##Index)) | MultiplayerSessionsSchema::PackValue(MultiplayerSessionsSchema::Name##Index, In); \
+		return *this; \
+	}
+	MULTIPLAYERSESSIONS_SESSION_ATTRIBUTES(MULTIPLAYERSESSIONS_ATTRIBUTE_FILTER)
+#undef MULTIPLAYERSESSIONS_ATTRIBUTE_FILTER
+
+	bool Matches(uint64 Packed) const { return (Packed & Mask) == Value; }
+
+	/// The query key a backend search for this filter can use, the narrowest the filter covers, and the value to
+	/// match it with. False when it covers neither; the search then only filters the results it gets back.
+	bool GetQuerySetting(FName& OutKey, int64& OutValue) const;
+};
@@ -0,0 +1,68 @@
+/// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FIcmpEchoResult;
+
+/// Broadcast when a probe finishes; PingInMs is INDEX_NONE if the host didn't answer
+DECLARE_MULTICAST_DELEGATE_TwoParams(FOnSessionPingUpdated, const FString& /*SessionId*/, int32 /*PingInMs*/);
+
+///
+/// Re-measures the ping of individual sessions on request.
+/// The ping in a search result is measured once, at search time. Probing every result again would mean thousands
+/// of echo requests, so the server browser only asks for the rows on screen. At most MaxConcurrentProbes are in
+/// flight; the rest wait in a queue that the browser clears when it scrolls to other rows. Answers, including
+/// failures, are cached for TimeToLive seconds; expired answers are dropped as new ones come in, and the cache never
+/// holds more than MaxCachedPings.
+///
+/// The probes are ICMP echoes, which need an IP address: sessions whose connect string isn't one (e.g. Steam P2P)
+/// fail to resolve and keep the ping from the search.
+///
+class MULTIPLAYERSESSIONS_API FSessionPingService : public TSharedFromThis<FSessionPingService>
+{
+public:
+	FSessionPingService(int32 InMaxConcurrentProbes, double InTimeToLive, float InProbeTimeout);
+
+	/// Returns true and the cached ping if there is a fresh answer for the session
+	bool GetCachedPing(const FString& SessionId, int32& OutPingInMs) const;
+
+	/// Queues a probe of Address unless the session has a fresh answer or is already queued or being probed
+	void RequestPing(const FString& SessionId, const FString& Address);
+
+	/// Drops the probes that haven't started yet; probes in flight still complete and are cached
+	void CancelQueued();
+
+	FOnSessionPingUpdated OnPingUpdated;
+
+private:
+	struct FCachedPing
+	{
+		int32 PingInMs{ INDEX_NONE };
+		double Time{ 0.0 };
+	};
+
+	struct FQueuedProbe
+	{
+		FString SessionId;
+		FString Address;
+	};
+
+	void StartQueuedProbes();
+	void OnProbeComplete(const FString& SessionId, const FIcmpEchoResult& Result);
+
+	/// Drops expired answers, then the oldest ones while the cache is over MaxCachedPings
+	void EvictCachedPings(double Now);
+
+	/// A few screens of browser rows; a long browsing session otherwise caches every host it ever scrolled past
+	static constexpr int32 MaxCachedPings = 512;
+
+	TMap<FString, FCachedPing> Cache;
+	TArray<FQueuedProbe> Queue;
+	TSet<FString> InFlight;
+
+	int32 MaxConcurrentProbes;
+	double TimeToLive;
+	float ProbeTimeout;
+};
@@ -0,0 +1,87 @@
+/// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/Ticker.h"
+
+class FSocket;
+class FInternetAddr;
+
+/// Called once the probe is over; one RTT per address, in the order given, INDEX_NONE for no answer
+DECLARE_DELEGATE_OneParam(FOnSessionQosProbeComplete, const TArray<int32>& /*RttsInMs*/);
+
+///
+/// Measures the latency to a handful of candidate hosts right before joining one.
+/// The ping that comes with a search result is often stale, or missing altogether on presence based lobbies, so
+/// the join picks its host by what the probe measures instead.
+///
+/// Each candidate is sent one small UDP datagram that its FSessionQosResponder echoes back. All candidates are
+/// probed at once over at most SocketBudget sockets, and the probe ends when every candidate answered or the window
+/// ran out, whichever comes first. A prober runs once; start another one for the next probe.
+///
+class MULTIPLAYERSESSIONS_API FSessionQosProber : public TSharedFromThis<FSessionQosProber>
+{
+public:
+	~FSessionQosProber();
+
+	/// Session setting the host advertises its responder's port in
+	static const FName PortSettingKey;
+
+	/// The responder's address for a session whose connect string is ConnectString (host:gameport)
+	static FString MakeProbeAddress(const FString& ConnectString, int32 QosPort);
+
+	/// Probes Addresses (ip:port); addresses that don't parse count as not answering
+	void Start(const TArray<FString>& Addresses, int32 SocketBudget, float WindowSeconds, FOnSessionQosProbeComplete InOnComplete);
+
+	/// Stops without calling the completion delegate
+	void Cancel();
+
+	bool IsRunning() const { return TickerHandle.IsValid(); }
+
+private:
+	struct FTarget
+	{
+		TSharedPtr<FInternetAddr> Address;
+		int32 SocketIndex{ INDEX_NONE };
+		double SendTime{ 0.0 };
+		int32 RttInMs{ INDEX_NONE };
+	};
+
+	bool Tick(float DeltaTime);
+	void ReceiveReplies(int32 SocketIndex);
+	void Finish();
+	void CloseSockets();
+
+	TArray<FTarget> Targets;
+	TArray<FSocket*> Sockets;
+	uint32 Nonce{ 0 };
+	int32 NumPending{ 0 };
+	double Deadline{ 0.0 };
+	FTSTicker::FDelegateHandle TickerHandle;
+	FOnSessionQosProbeComplete OnComplete;
+};
+
+///
+/// The host side of FSessionQosProber: echoes probe datagrams back to whoever sent them.
+/// Runs for as long as the host advertises a session, see ALobbyGameMode.
+///
+class MULTIPLAYERSESSIONS_API FSessionQosResponder
+{
+public:
+	~FSessionQosResponder();
+
+	/// MultiplayerSessions.Qos.Port
+	static int32 GetConfiguredPort();
+
+	bool Start(int32 Port);
+	void Stop();
+
+	bool IsListening() const { return Socket != nullptr; }
+
+private:
+	bool Tick(float DeltaTime);
+
+	FSocket* Socket{ nullptr };
+	FTSTicker::FDelegateHandle TickerHandle;
+};
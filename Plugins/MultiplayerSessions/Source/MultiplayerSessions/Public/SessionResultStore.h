@@ -0,0 +1,102 @@
+/// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "OnlineSessionSettings.h"
+#include "SessionAttributeSchema.h"
+
+///
+/// FindSessions results, kept compact for as long as the menu shows them.
+/// A full FOnlineSessionSearchResult carries its own settings map, owner name and setting strings, and a search can
+/// return thousands of them. The store keeps one fixed-size row per session in a single array, all owner names in one
+/// character arena, and every distinct setting (key and value) once, shared by all rows that advertise it; most
+/// sessions advertise the same match type and ports. A full result is only rebuilt for a session that is joined or pinged.
+///
+/// The subsystem drops its store when the menu closes or travel begins, see UMultiplayerSessionsSubsystem::ReleaseSearchResults.
+///
+class MULTIPLAYERSESSIONS_API FSessionResultStore
+{
+public:
+	FSessionResultStore() = default;
+	explicit FSessionResultStore(const TArray<FOnlineSessionSearchResult>& SearchResults);
+
+	/// Filters, deduplicates and ranks raw search results, then compacts them; doesn't touch UObjects, so it runs on any thread.
+	/// Results that can't be joined (no session info) or whose attributes don't match Filter are dropped,
+	/// a session the backend returned more than once is kept once, and the rest are ordered sessions with room first,
+	/// then by search ping, unknown pings last.
+	/// Sessions in ExcludedSessionIds (e.g. suppressed ghosts, see FGhostSessionCache) are dropped too and counted in OutNumExcluded.
+	static TSharedRef<FSessionResultStore> BuildRanked(TArray<FOnlineSessionSearchResult>&& SearchResults, const FSessionAttributeFilter& Filter,
+		const TSet<FString>& ExcludedSessionIds = TSet<FString>(), int32* OutNumExcluded = nullptr);
+
+	int32 Num() const { return Rows.Num(); }
+	bool IsValidIndex(int32 Index) const { return Rows.IsValidIndex(Index); }
+
+	/// Rebuilds the full search result, e.g. to join the session
+	FOnlineSessionSearchResult GetSearchResult(int32 Index) const;
+
+	FString GetSessionIdStr(int32 Index) const;
+	FStringView GetOwningUserName(int32 Index) const;
+
+	/// The interned value of a string setting, or nullptr if the session doesn't advertise Key as a string
+	const FString* FindStringSetting(int32 Index, FName Key) const;
+
+	/// The session's typed attributes, see SessionAttributeSchema.h; all Unknown/0 if it advertises none
+	FSessionAttributes GetAttributes(int32 Index) const { return FSessionAttributes::Unpack(Rows[Index].Attributes); }
+
+	int32 GetMaxPlayers(int32 Index) const { return Rows[Index].NumPublicConnections; }
+	int32 GetNumPlayers(int32 Index) const { return Rows[Index].NumPublicConnections - Rows[Index].NumOpenPublicConnections; }
+
+	int32 GetPingInMs(int32 Index) const { return Rows[Index].PingInMs; }
+	void SetPingInMs(int32 Index, int32 PingInMs) { Rows[Index].PingInMs = PingInMs; }
+
+	/// Bytes held by the store, with an estimate for each row's session info and owner id
+	SIZE_T GetAllocatedSize() const;
+
+	/// Bytes held by full search results, for comparison; the session infos and owner ids are estimated the same way
+	static SIZE_T GetAllocatedSize(const TArray<FOnlineSessionSearchResult>& SearchResults);
+
+private:
+	struct FRow
+	{
+		TSharedPtr<FOnlineSessionInfo> SessionInfo;
+		FUniqueNetIdPtr OwningUserId;
+
+		/// Into NameArena
+		int32 OwningUserNameOffset{ 0 };
+		int32 OwningUserNameLength{ 0 };
+
+		/// Into SettingRefs
+		int32 FirstSetting{ 0 };
+		int32 NumSettings{ 0 };
+
+		/// Packed FSessionAttributes
+		uint64 Attributes{ 0 };
+
+		int32 PingInMs{ 0 };
+		int32 BuildUniqueId{ 0 };
+		uint16 NumPublicConnections{ 0 };
+		uint16 NumPrivateConnections{ 0 };
+		uint16 NumOpenPublicConnections{ 0 };
+		uint16 NumOpenPrivateConnections{ 0 };
+
+		/// FOnlineSessionSettings' flags, one bit each, see PackFlags
+		uint16 Flags{ 0 };
+	};
+
+	static uint16 PackFlags(const FOnlineSessionSettings& Settings);
+	static void UnpackFlags(uint16 Flags, FOnlineSessionSettings& OutSettings);
+
+	/// Estimated heap bytes of a result's session info and owner id, which live outside the arrays
+	static SIZE_T GetSharedObjectsSize(const TSharedPtr<FOnlineSessionInfo>& SessionInfo, const FUniqueNetIdPtr& OwningUserId);
+
+	TArray<FRow> Rows;
+	TArray<TCHAR> NameArena;
+
+	/// Every row's settings, as indices into Settings
+	TArray<int32> SettingRefs;
+
+	/// The distinct settings of the search, and the value of the string ones (empty for other types)
+	TArray<TPair<FName, FOnlineSessionSetting>> Settings;
+	TArray<FString> SettingStrings;
+};
@@ -4,11 +4,165 @@
 #include "LobbyGameMode.h"
 #include "GameFramework/GameStateBase.h"
 #include "GameFramework/PlayerState.h"
+#include "GameFramework/PawnMovementComponent.h"
+#include "Engine/GameInstance.h"
+#include "TimerManager.h"
+#include "OnlineSessionSettings.h"
+#include "MultiplayerSessionsSubsystem.h"
+#include "MultiplayerSessionsTrace.h"
+#include "MultiplayerSessionsTelemetry.h"
+#include "LobbyReservationBeaconClient.h"
+#include "LobbyReservationBeaconHostObject.h"
+#include "SessionQosProber.h"
+#include "GameFramework/GameSession.h"
+#include "Kismet/GameplayStatics.h"
+#include "MenuSystem.h"
+#include "MenuSystemCharacter.h"
+#include "LobbyPlayerController.h"
 
+DECLARE_CYCLE_STAT(TEXT("Lobby PostLogin"), STAT_LobbyPostLogin, STATGROUP_MenuSystem);
+
+
+ALobbyGameMode::ALobbyGameMode()
+{
+	/// Reduced rate is the lobby default, see IdleReplicationPolicy
+	IdleReplicationPolicy.Mode = EIdleReplicationMode::ReduceRate;
+
+	/// Hands pawns back to the pool when players leave
+	PlayerControllerClass = ALobbyPlayerController::StaticClass();
+}
+
+void ALobbyGameMode::InitGame(const FString& MapName, const FString& Options, FString& ErrorMessage)
+{
+	Super::InitGame(MapName, Options, ErrorMessage);
+
+	/// The listen server's own player logs in before BeginPlay, so the first batch has to be ready here
+	if (bUsePawnPool)
+	{
+		PrewarmPawnPool();
+	}
+}
+
+void ALobbyGameMode::BeginPlay()
+{
+	Super::BeginPlay();
+
+	/// The rest of the pool is spawned a few pawns a frame, so the lobby doesn't open with a hitch
+	if (NumPawnsToPrewarm > 0)
+	{
+		GetWorldTimerManager().SetTimerForNextTick(this, &ThisClass::PrewarmNextBatch);
+	}
+
+	/// The net mode is settled by now; a standalone lobby has nobody to reserve slots for
+	if (GetNetMode() == NM_ListenServer || GetNetMode() == NM_DedicatedServer)
+	{
+		ReservationHost = ALobbyReservationBeaconHostObject::StartListening(GetWorld());
+		if (ReservationHost)
+		{
+			ReservationHost->GetOpenSlots.BindUObject(this, &ThisClass::GetNumOpenSlots);
+			ReservationHost->GetMaxSlots.BindUObject(this, &ThisClass::GetMaxPlayers);
+		}
+
+		QosResponder = MakeShared<FSessionQosResponder>();
+		QosResponder->Start(FSessionQosResponder::GetConfiguredPort());
+
+		TickGovernor.Start(this, TickPolicy);
+	}
+
+	/// Pings drift, so the ranking is refreshed now and then besides on every login and logout
+	if (GetNetMode() == NM_ListenServer)
+	{
+		GetWorldTimerManager().SetTimer(HostSuccessorsTimerHandle, FTimerDelegate::CreateUObject(this, &ThisClass::UpdateHostSuccessors, static_cast<AController*>(nullptr)), 5.f, true);
+	}
+}
+
+void ALobbyGameMode::PreLogin(const FString& Options, const FString& Address, const FUniqueNetIdRepl& UniqueId, FString& ErrorMessage)
+{
+	/// Full rate for the rest of the login and the spawn that follows
+	TickGovernor.Wake();
+
+	Super::PreLogin(Options, Address, UniqueId, ErrorMessage);
+
+	/// Slots held for players with a reservation can't be taken by someone who joined without one
+	if (ErrorMessage.IsEmpty() && ReservationHost && !ReservationHost->CanPlayerLogin(UGameplayStatics::ParseOption(Options, ALobbyReservationBeaconClient::ReservationTokenOption), UniqueId))
+	{
+		ErrorMessage = TEXT("Lobby is full");
+	}
+}
+
+int32 ALobbyGameMode::GetNumOpenSlots()
+{
+	return FMath::Max(GetMaxPlayers() - GetNumPlayers(), 0);
+}
+
+int32 ALobbyGameMode::GetMaxPlayers()
+{
+	int32 MaxPlayers = GameSession ? GameSession->MaxPlayers : 0;
+	const UGameInstance* GameInstance = GetGameInstance();
+	const UMultiplayerSessionsSubsystem* MultiplayerSessionsSubsystem = GameInstance ? GameInstance->GetSubsystem<UMultiplayerSessionsSubsystem>() : nullptr;
+	const FOnlineSessionSettings* SessionSettings = MultiplayerSessionsSubsystem ? MultiplayerSessionsSubsystem->GetCurrentSessionSettings() : nullptr;
+	if (SessionSettings)
+	{
+		MaxPlayers = SessionSettings->NumPublicConnections;
+	}
+	return MaxPlayers;
+}
+
+FString ALobbyGameMode::InitNewPlayer(APlayerController* NewPlayerController, const FUniqueNetIdRepl& UniqueId, const FString& Options, const FString& Portal)
+{
+	/// The player is counted by GetNumPlayers from here on, so the slot no longer needs to be held for them
+	if (ReservationHost)
+	{
+		ReservationHost->ConsumeReservation(UGameplayStatics::ParseOption(Options, ALobbyReservationBeaconClient::ReservationTokenOption), UniqueId);
+	}
+
+	/// The client appended its correlation id to the travel URL, so the server side of the join shares its trace id
+	const FGuid CorrelationId = MultiplayerSessionsTrace::ParseCorrelationId(Options);
+	if (CorrelationId.IsValid())
+	{
+		/// A listen server's own player continues the flow it started with the Host click; remote players get a server-side record
+		FMultiplayerSessionsTelemetry::Get().BeginFlow(CorrelationId, FMultiplayerSessionsTelemetry::ServerLoginTrigger);
+		MultiplayerSessionsTrace::TracePhase(CorrelationId, TEXT("ServerLogin"), EMultiplayerSessionsTraceEdge::Instant);
+		PendingTraceCorrelationIds.Add(NewPlayerController, CorrelationId);
+	}
+
+	/// A failed login destroys the controller without a Logout, so its id is dropped and its flow closed here
+	const FString ErrorMessage = Super::InitNewPlayer(NewPlayerController, UniqueId, Options, Portal);
+	if (!ErrorMessage.IsEmpty() && PendingTraceCorrelationIds.Remove(NewPlayerController) > 0)
+	{
+		FMultiplayerSessionsTelemetry::Get().EndFlow(CorrelationId, TEXT("LoginFailed"));
+	}
+	return ErrorMessage;
+}
 
 void ALobbyGameMode::PostLogin(APlayerController* NewPlayer)
 {
-	Super::PostLogin(NewPlayer);
+	FGuid CorrelationId;
+	PendingTraceCorrelationIds.RemoveAndCopyValue(NewPlayer, CorrelationId);
+
+	bLastSpawnUsedPool = false;
+	const double PostLoginStartTime = FPlatformTime::Seconds();
+	{
+		/// Super::PostLogin restarts the player, which is where the pawn is spawned or taken from the pool
+		SCOPE_CYCLE_COUNTER(STAT_LobbyPostLogin);
+		MULTIPLAYERSESSIONS_TRACE_SCOPE(LobbyGameMode_PostLogin);
+		MultiplayerSessionsTrace::TracePhase(CorrelationId, TEXT("PostLogin"), EMultiplayerSessionsTraceEdge::Begin);
+		Super::PostLogin(NewPlayer);
+		MultiplayerSessionsTrace::TracePhase(CorrelationId, TEXT("PostLogin"), EMultiplayerSessionsTraceEdge::End);
+	}
+
+	/// The server's part of a remote join ends here; the client closes its own record on its first possessed tick
+	if (!NewPlayer->IsLocalController())
+	{
+		FMultiplayerSessionsTelemetry::Get().EndFlow(CorrelationId, TEXT("PostLogin"));
+	}
+	ReportJoinCost((FPlatformTime::Seconds() - PostLoginStartTime) * 1000.0, bLastSpawnUsedPool);
+	UpdateHostSuccessors();
+	TickGovernor.Wake();
+	if (GameState)
+	{
+		UpdateAdvertisedPlayers(GameState->PlayerArray.Num());
+	}
 	
 	if (GameState)
 	{
@@ -43,6 +197,26 @@ void ALobbyGameMode::Logout(AController* Exiting)
 {
 	Super::Logout(Exiting);
 
+	/// Left before PostLogin closed the server's part of the join
+	FGuid CorrelationId;
+	if (PendingTraceCorrelationIds.RemoveAndCopyValue(Cast<APlayerController>(Exiting), CorrelationId))
+	{
+		FMultiplayerSessionsTelemetry::Get().EndFlow(CorrelationId, TEXT("Logout"));
+	}
+	SentHostSuccessors.Remove(Cast<APlayerController>(Exiting));
+	UpdateHostSuccessors(Exiting);
+	if (GameState && Exiting->PlayerState)
+	{
+		/// The exiting player is still in the player array
+		UpdateAdvertisedPlayers(GameState->PlayerArray.Num() - 1);
+	}
+
+	/// The player still counts until their controller is gone, so their slot goes to the waitlist on the next tick
+	if (ReservationHost)
+	{
+		GetWorldTimerManager().SetTimerForNextTick(ReservationHost, &ALobbyReservationBeaconHostObject::ProcessWaitlist);
+	}
+
 	APlayerState* PlayerState = Exiting->GetPlayerState<APlayerState>();
 	if (PlayerState)
 	{
@@ -64,3 +238,274 @@ void ALobbyGameMode::Logout(AController* Exiting)
 		);
 	}
 }
+
+
+void ALobbyGameMode::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (ReservationHost)
+	{
+		ReservationHost->StopListening();
+		ReservationHost = nullptr;
+	}
+	QosResponder.Reset();
+	TickGovernor.Stop();
+
+	for (APawn* Pawn : PawnPool)
+	{
+		if (IsValid(Pawn))
+		{
+			Pawn->Destroy();
+		}
+	}
+	PawnPool.Reset();
+
+	Super::EndPlay(EndPlayReason);
+}
+
+APawn* ALobbyGameMode::SpawnDefaultPawnFor_Implementation(AController* NewPlayer, AActor* StartSpot)
+{
+	APawn* PooledPawn = bUsePawnPool ? TakePawnFromPool(GetDefaultPawnClassForController(NewPlayer)) : nullptr;
+	if (PooledPawn == nullptr)
+	{
+		return Super::SpawnDefaultPawnFor_Implementation(NewPlayer, StartSpot);
+	}
+
+	/// Same placement as a fresh spawn; RestartPlayer possesses the pawn once we return it
+	const FTransform SpawnTransform = StartSpot ? StartSpot->GetActorTransform() : FTransform::Identity;
+	PooledPawn->TeleportTo(SpawnTransform.GetLocation(), SpawnTransform.Rotator(), false, true);
+
+	/// Wake the pawn's channels so clients see it unhide at its new location
+	PooledPawn->SetNetDormancy(DORM_Awake);
+	PooledPawn->SetActorHiddenInGame(false);
+	PooledPawn->SetActorEnableCollision(true);
+	PooledPawn->SetActorTickEnabled(true);
+	if (UPawnMovementComponent* MovementComponent = PooledPawn->GetMovementComponent())
+	{
+		MovementComponent->Activate(true);
+	}
+	if (AMenuSystemCharacter* Character = Cast<AMenuSystemCharacter>(PooledPawn))
+	{
+		Character->SetPooled(false);
+	}
+	PooledPawn->ForceNetUpdate();
+
+	bLastSpawnUsedPool = true;
+	return PooledPawn;
+}
+
+bool ALobbyGameMode::ReturnPawnToPool(APawn* Pawn)
+{
+	if (!bUsePawnPool || !IsValid(Pawn) || PawnPool.Num() >= PawnPoolCapacity)
+	{
+		return false;
+	}
+
+	if (AController* Controller = Pawn->GetController())
+	{
+		Controller->UnPossess();
+	}
+
+	DeactivatePooledPawn(Pawn);
+	PawnPool.Add(Pawn);
+	return true;
+}
+
+void ALobbyGameMode::PrewarmPawnPool()
+{
+	/// One pawn per slot in the session, the same number of players the lobby can hold
+	PawnPoolCapacity = FallbackPawnPoolSize;
+	const UGameInstance* GameInstance = GetGameInstance();
+	const UMultiplayerSessionsSubsystem* MultiplayerSessionsSubsystem = GameInstance ? GameInstance->GetSubsystem<UMultiplayerSessionsSubsystem>() : nullptr;
+	const FOnlineSessionSettings* SessionSettings = MultiplayerSessionsSubsystem ? MultiplayerSessionsSubsystem->GetCurrentSessionSettings() : nullptr;
+	if (SessionSettings)
+	{
+		PawnPoolCapacity = SessionSettings->NumPublicConnections;
+	}
+
+	PawnPool.Reserve(PawnPoolCapacity);
+	NumPawnsToPrewarm = PawnPoolCapacity;
+	SpawnPooledPawns(PrewarmPawnsPerFrame);
+}
+
+void ALobbyGameMode::PrewarmNextBatch()
+{
+	SpawnPooledPawns(PrewarmPawnsPerFrame);
+	if (NumPawnsToPrewarm > 0)
+	{
+		GetWorldTimerManager().SetTimerForNextTick(this, &ThisClass::PrewarmNextBatch);
+	}
+}
+
+void ALobbyGameMode::SpawnPooledPawns(int32 NumPawns)
+{
+	UClass* PawnClass = GetDefaultPawnClassForController(nullptr);
+	if (PawnClass == nullptr)
+	{
+		NumPawnsToPrewarm = 0;
+		return;
+	}
+
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.Instigator = GetInstigator();
+	SpawnParameters.ObjectFlags |= RF_Transient;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	/// Pawns players handed back in the meantime count towards the pool too
+	for (int32 Index = 0; Index < NumPawns && NumPawnsToPrewarm > 0 && PawnPool.Num() < PawnPoolCapacity; ++Index)
+	{
+		--NumPawnsToPrewarm;
+		APawn* Pawn = GetWorld()->SpawnActor<APawn>(PawnClass, FTransform::Identity, SpawnParameters);
+		if (Pawn)
+		{
+			DeactivatePooledPawn(Pawn);
+			PawnPool.Add(Pawn);
+		}
+	}
+
+	if (NumPawnsToPrewarm == 0 || PawnPool.Num() >= PawnPoolCapacity)
+	{
+		NumPawnsToPrewarm = 0;
+		UE_LOG(LogMenuSystem, Log, TEXT("Lobby pawn pool prewarmed with %d x %s"), PawnPool.Num(), *PawnClass->GetName());
+	}
+}
+
+APawn* ALobbyGameMode::TakePawnFromPool(UClass* PawnClass)
+{
+	for (int32 Index = PawnPool.Num() - 1; Index >= 0; --Index)
+	{
+		APawn* Pawn = PawnPool[Index];
+		if (!IsValid(Pawn))
+		{
+			PawnPool.RemoveAtSwap(Index);
+			continue;
+		}
+
+		if (Pawn->GetClass() == PawnClass)
+		{
+			PawnPool.RemoveAtSwap(Index);
+			return Pawn;
+		}
+	}
+	return nullptr;
+}
+
+void ALobbyGameMode::DeactivatePooledPawn(APawn* Pawn)
+{
+	if (AMenuSystemCharacter* Character = Cast<AMenuSystemCharacter>(Pawn))
+	{
+		Character->SetPooled(true);
+	}
+	if (UPawnMovementComponent* MovementComponent = Pawn->GetMovementComponent())
+	{
+		MovementComponent->StopMovementImmediately();
+		MovementComponent->Deactivate();
+	}
+
+	Pawn->SetActorHiddenInGame(true);
+	Pawn->SetActorEnableCollision(false);
+	Pawn->SetActorTickEnabled(false);
+
+	/// Parked pawns cost nothing on the wire: the hidden, pooled state goes out once more and the channels then close dormant,
+	/// clients keep the hidden pawn until it is reused. Turning replication off would leave every client a visible frozen copy.
+	Pawn->ForceNetUpdate();
+	Pawn->SetNetDormancy(DORM_DormantAll);
+}
+
+void ALobbyGameMode::UpdateHostSuccessors(AController* Exiting)
+{
+	if (GetNetMode() != NM_ListenServer)
+	{
+		return;
+	}
+
+	struct FCandidate
+	{
+		FHostMigrationSuccessor Successor;
+		int32 PingBucket;
+	};
+
+	/// Controllers iterate in login order, which the stable sort keeps for equal buckets
+	TArray<FCandidate> Candidates;
+	TArray<ALobbyPlayerController*> RemoteControllers;
+	for (FConstPlayerControllerIterator Iterator = GetWorld()->GetPlayerControllerIterator(); Iterator; ++Iterator)
+	{
+		ALobbyPlayerController* PlayerController = Cast<ALobbyPlayerController>(Iterator->Get());
+		if (PlayerController == nullptr || PlayerController == Exiting || PlayerController->IsLocalController() || PlayerController->PlayerState == nullptr)
+		{
+			continue;
+		}
+		RemoteControllers.Add(PlayerController);
+
+		/// The successor listens on the default game port; its address is the one it reached us from
+		const FUniqueNetIdRepl& PlayerId = PlayerController->PlayerState->GetUniqueId();
+		const FString Address = PlayerController->GetPlayerNetworkAddress();
+		if (!PlayerId.IsValid() || Address.IsEmpty())
+		{
+			continue;
+		}
+
+		FCandidate& Candidate = Candidates.AddDefaulted_GetRef();
+		Candidate.Successor.PlayerId = PlayerId;
+		Candidate.Successor.ConnectString = FString::Printf(TEXT("%s:%d"), *Address, FURL::UrlConfig.DefaultPort);
+		Candidate.PingBucket = FMath::FloorToInt(PlayerController->PlayerState->GetPingInMilliseconds() / 20.f);
+	}
+
+	Candidates.StableSort([](const FCandidate& A, const FCandidate& B) { return A.PingBucket < B.PingBucket; });
+
+	TArray<FHostMigrationSuccessor> Successors;
+	for (const FCandidate& Candidate : Candidates)
+	{
+		Successors.Add(Candidate.Successor);
+	}
+
+	/// The successor recreates our session; followers that reached us by migrating have no copy of it
+	const UGameInstance* GameInstance = GetGameInstance();
+	const UMultiplayerSessionsSubsystem* MultiplayerSessionsSubsystem = GameInstance ? GameInstance->GetSubsystem<UMultiplayerSessionsSubsystem>() : nullptr;
+	const FHostMigrationSession Session = MultiplayerSessionsSubsystem ? MultiplayerSessionsSubsystem->GetHostMigrationSession() : FHostMigrationSession();
+
+	/// Players who just joined haven't been sent anything yet
+	const bool bListChanged = Successors != HostSuccessors || Session != HostSession;
+	HostSuccessors = MoveTemp(Successors);
+	HostSession = Session;
+	for (ALobbyPlayerController* PlayerController : RemoteControllers)
+	{
+		if (bListChanged || !SentHostSuccessors.Contains(PlayerController))
+		{
+			PlayerController->ClientReceiveHostSuccessors(HostSuccessors, HostSession);
+			SentHostSuccessors.Add(PlayerController);
+		}
+	}
+}
+
+void ALobbyGameMode::UpdateAdvertisedPlayers(int32 NumPlayers)
+{
+	UGameInstance* GameInstance = GetGameInstance();
+	UMultiplayerSessionsSubsystem* MultiplayerSessionsSubsystem = GameInstance ? GameInstance->GetSubsystem<UMultiplayerSessionsSubsystem>() : nullptr;
+	if (MultiplayerSessionsSubsystem)
+	{
+		MultiplayerSessionsSubsystem->UpdateAdvertisedAttributes(LobbyState, NumPlayers);
+	}
+}
+
+void ALobbyGameMode::ProcessServerTravel(const FString& URL, bool bAbsolute)
+{
+	/// The players travel along, so the count stays the same
+	LobbyState = ESessionLobbyState::InProgress;
+	UpdateAdvertisedPlayers(GameState ? GameState->PlayerArray.Num() : 0);
+
+	Super::ProcessServerTravel(URL, bAbsolute);
+}
+
+void ALobbyGameMode::ReportJoinCost(double PostLoginMilliseconds, bool bUsedPooledPawn)
+{
+	/// The next frame's delta time is the length of the frame that handled the join, i.e. the hitch players see
+	const int32 NumPooledPawns = PawnPool.Num();
+	GetWorldTimerManager().SetTimerForNextTick([PostLoginMilliseconds, bUsedPooledPawn, NumPooledPawns]()
+	{
+		UE_LOG(LogMenuSystem, Log, TEXT("Lobby join: PostLogin %.2f ms, join frame %.2f ms, pawn %s (%d left in pool)"),
+			PostLoginMilliseconds,
+			FApp::GetDeltaTime() * 1000.0,
+			bUsedPooledPawn ? TEXT("from pool") : TEXT("spawned"),
+			NumPooledPawns);
+	});
+}
@@ -4,6 +4,9 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/GameModeBase.h"
+#include "LobbyReplicationPolicy.h"
+#include "LobbyTickGovernor.h"
+#include "MultiplayerSessionsSubsystem.h"
 #include "LobbyGameMode.generated.h"
 
 /**
@@ -16,6 +19,109 @@ class MENUSYSTEM_API ALobbyGameMode : public AGameModeBase
 	
 
 public:
+	ALobbyGameMode();
+
+	virtual void InitGame(const FString& MapName, const FString& Options, FString& ErrorMessage) override;
+	virtual void BeginPlay() override;
+	virtual void PreLogin(const FString& Options, const FString& Address, const FUniqueNetIdRepl& UniqueId, FString& ErrorMessage) override;
+	virtual FString InitNewPlayer(APlayerController* NewPlayerController, const FUniqueNetIdRepl& UniqueId, const FString& Options, const FString& Portal = TEXT("")) override;
 	virtual void PostLogin(APlayerController* NewPlayer) override;
 	virtual void Logout(AController* Exiting) override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	virtual APawn* SpawnDefaultPawnFor_Implementation(AController* NewPlayer, AActor* StartSpot) override;
+
+	/// Leaving the lobby for the match; searches see the session as in progress from here on
+	virtual void ProcessServerTravel(const FString& URL, bool bAbsolute = false) override;
+
+	/// How many more players the lobby can take: GetMaxPlayers minus the players in it
+	/// Authoritative count for the reservation beacon
+	int32 GetNumOpenSlots();
+
+	/// The session's NumPublicConnections, or the game session's MaxPlayers without a session
+	int32 GetMaxPlayers();
+
+	/// Deactivates the pawn and keeps it for the next player; called when a player leaves
+	/// Returns false if pooling is disabled or the pool is full, in which case the caller destroys the pawn
+	bool ReturnPawnToPool(APawn* Pawn);
+
+	/// Players mostly stand around in the lobby, so idle characters replicate at a reduced rate by default
+	/// Override in the map's game mode blueprint to change the policy for that map
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Replication")
+	FIdleReplicationPolicy IdleReplicationPolicy;
+
+	/// Movement precision for characters on this map; clients read it from the game mode class the GameState replicates
+	/// Maps that don't use a lobby game mode always replicate movement at full precision
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Replication")
+	EMovementReplicationPrecision MovementPrecision{ EMovementReplicationPrecision::Reduced };
+
+	/// When the host drops to a low tick rate because the lobby is idle; see FLobbyTickGovernor
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Tick")
+	FLobbyTickPolicy TickPolicy;
+
+	/// Keep deactivated pawns around and reuse them on join, instead of spawning on PostLogin and destroying on Logout
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Pawn Pool")
+	bool bUsePawnPool{ false };
+
+	/// Pool size when there is no session to read NumPublicConnections from (e.g. PIE)
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Pawn Pool", meta = (ClampMin = "0", EditCondition = "bUsePawnPool"))
+	int32 FallbackPawnPoolSize{ 4 };
+
+	/// Pawns spawned into the pool per frame while it fills up; players joining before it is full get a fresh pawn
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Pawn Pool", meta = (ClampMin = "1", EditCondition = "bUsePawnPool"))
+	int32 PrewarmPawnsPerFrame{ 2 };
+
+private:
+
+	/// Sizes the pool to the session's NumPublicConnections and spawns the first PrewarmPawnsPerFrame deactivated pawns;
+	/// BeginPlay spawns the rest over the following frames, see PrewarmNextBatch
+	void PrewarmPawnPool();
+	void PrewarmNextBatch();
+
+	/// Spawns up to NumPawns deactivated pawns into the pool, as long as there are some left to prewarm
+	void SpawnPooledPawns(int32 NumPawns);
+
+	APawn* TakePawnFromPool(UClass* PawnClass);
+	void DeactivatePooledPawn(APawn* Pawn);
+
+	/// Ranks the remote players as host successors and sends the list to all of them when it changes
+	/// Best connection to us first: pings in 20 ms buckets, ties broken by who joined first. Exiting is left out.
+	/// Only a listen server is migrated; a dedicated server has no player to hand over to.
+	void UpdateHostSuccessors(AController* Exiting = nullptr);
+
+	/// Logs how long the join took on the server, and the length of the frame it happened in
+	void ReportJoinCost(double PostLoginMilliseconds, bool bUsedPooledPawn);
+
+	/// Advertises the lobby's state and player count in the session attributes, so searches see how full it is
+	void UpdateAdvertisedPlayers(int32 NumPlayers);
+
+	/// Waiting until the lobby travels to the match
+	ESessionLobbyState LobbyState{ ESessionLobbyState::Waiting };
+
+	UPROPERTY()
+	TArray<APawn*> PawnPool;
+
+	int32 PawnPoolCapacity{ 0 };
+	int32 NumPawnsToPrewarm{ 0 };
+
+	/// Answers clients that want to reserve slots before traveling here; only on a listen or dedicated server
+	UPROPERTY()
+	class ALobbyReservationBeaconHostObject* ReservationHost;
+
+	/// The successor list the clients have, see UpdateHostSuccessors
+	TArray<FHostMigrationSuccessor> HostSuccessors;
+	FHostMigrationSession HostSession;
+	TSet<TObjectKey<APlayerController>> SentHostSuccessors;
+	FTimerHandle HostSuccessorsTimerHandle;
+
+	/// Answers the QoS probes of players picking a host to join
+	TSharedPtr<class FSessionQosResponder> QosResponder;
+
+	/// Trace correlation ids read from the login URL, held from InitNewPlayer until the player's PostLogin (or a failed login, or Logout)
+	TMap<TObjectKey<APlayerController>, FGuid> PendingTraceCorrelationIds;
+
+	/// Idles the host while the lobby has nothing to do; only on a listen or dedicated server
+	FLobbyTickGovernor TickGovernor;
+
+	/// Set by SpawnDefaultPawnFor during PostLogin so the join report knows where the pawn came from
+	bool bLastSpawnUsedPool{ false };
 };
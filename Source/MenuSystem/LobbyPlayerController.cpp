@@ -0,0 +1,30 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "LobbyPlayerController.h"
+#include "LobbyGameMode.h"
+#include "Engine/GameInstance.h"
+
+
+void ALobbyPlayerController::PawnLeavingGame()
+{
+	APawn* LeavingPawn = GetPawn();
+	ALobbyGameMode* LobbyGameMode = GetWorld()->GetAuthGameMode<ALobbyGameMode>();
+
+	/// The pool only takes the pawn if pooling is enabled and there is room for it
+	if (LeavingPawn && LobbyGameMode && LobbyGameMode->ReturnPawnToPool(LeavingPawn))
+	{
+		return;
+	}
+
+	Super::PawnLeavingGame();
+}
+
+void ALobbyPlayerController::ClientReceiveHostSuccessors_Implementation(const TArray<FHostMigrationSuccessor>& Successors, const FHostMigrationSession& Session)
+{
+	UMultiplayerSessionsSubsystem* MultiplayerSessionsSubsystem = GetGameInstance()->GetSubsystem<UMultiplayerSessionsSubsystem>();
+	if (MultiplayerSessionsSubsystem)
+	{
+		MultiplayerSessionsSubsystem->SetHostSuccessors(Successors, Session);
+	}
+}
@@ -0,0 +1,27 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/PlayerController.h"
+#include "MultiplayerSessionsSubsystem.h"
+#include "LobbyPlayerController.generated.h"
+
+/**
+ * Player controller for the lobby.
+ * Hands its pawn back to the lobby game mode's pawn pool when the player leaves, instead of destroying it.
+ */
+UCLASS()
+class MENUSYSTEM_API ALobbyPlayerController : public APlayerController
+{
+	GENERATED_BODY()
+
+public:
+	/// The host's ranked successor list and the session to recreate, for host migration; see ALobbyGameMode::UpdateHostSuccessors
+	UFUNCTION(Client, Reliable)
+	void ClientReceiveHostSuccessors(const TArray<FHostMigrationSuccessor>& Successors, const FHostMigrationSession& Session);
+
+protected:
+	/// Called on the server when the player disconnects, before Logout
+	virtual void PawnLeavingGame() override;
+};
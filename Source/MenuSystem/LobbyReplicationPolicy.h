@@ -0,0 +1,81 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "LobbyReplicationPolicy.generated.h"
+
+/// What the server does with a character that has had no movement input for a while
+UENUM(BlueprintType)
+enum class EIdleReplicationMode : uint8
+{
+	Disabled,		/// Always replicate at the character's NetUpdateFrequency
+	ReduceRate,		/// Drop to IdleNetUpdateFrequency while idle
+	Dormant,		/// Go dormant for every connection except the owner while idle
+};
+
+/**
+ * Server-side idle replication policy for characters.
+ * Lives on the game mode, so each map picks its own policy through its game mode override.
+ */
+USTRUCT(BlueprintType)
+struct FIdleReplicationPolicy
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Replication")
+	EIdleReplicationMode Mode{ EIdleReplicationMode::Disabled };
+
+	/// Seconds without movement input (and without velocity) before a character counts as idle
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Replication", meta = (ClampMin = "0.0"))
+	float IdleDelay{ 2.f };
+
+	/// Update rate used while idle in ReduceRate mode
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Replication", meta = (ClampMin = "0.1"))
+	float IdleNetUpdateFrequency{ 2.f };
+
+	/// How often the server re-evaluates whether a character is idle, in seconds
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Replication", meta = (ClampMin = "0.05"))
+	float EvaluationInterval{ 0.25f };
+
+	/// Estimated size of one character update on the wire; only used to report the bytes saved while idle
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Replication", meta = (ClampMin = "1"))
+	int32 EstimatedBytesPerUpdate{ 32 };
+};
+
+/// Precision used for character movement replication, in both directions
+UENUM(BlueprintType)
+enum class EMovementReplicationPrecision : uint8
+{
+	Full,		/// Engine defaults; for matches
+	Reduced,	/// Whole-cm locations and velocities, byte rotations, fewer client moves per second; enough for a lobby
+};
+
+/**
+ * When the lobby's host drops to a low tick rate, see FLobbyTickGovernor.
+ * Lives on the game mode next to the idle replication policy, so each map picks its own.
+ */
+USTRUCT(BlueprintType)
+struct FLobbyTickPolicy
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Tick")
+	bool bEnabled{ true };
+
+	/// The lobby only idles with this many players or fewer
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Tick", meta = (ClampMin = "1"))
+	int32 MaxIdlePlayers{ 2 };
+
+	/// Seconds without a join, movement or input on the host before the lobby idles
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Tick", meta = (ClampMin = "0.0"))
+	float IdleDelay{ 5.f };
+
+	/// Frames per second the host ticks (and replicates) at while idle
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Tick", meta = (ClampMin = "1"))
+	int32 IdleTickRate{ 10 };
+
+	/// How often an awake lobby checks whether it went idle, in seconds; an idle lobby checks every frame
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Tick", meta = (ClampMin = "0.05"))
+	float EvaluationInterval{ 0.5f };
+};
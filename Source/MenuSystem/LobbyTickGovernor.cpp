@@ -0,0 +1,248 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "LobbyTickGovernor.h"
+#include "GameFramework/GameModeBase.h"
+#include "GameFramework/GameStateBase.h"
+#include "GameFramework/PlayerState.h"
+#include "GameFramework/Pawn.h"
+#include "Engine/Engine.h"
+#include "Engine/NetDriver.h"
+#include "Engine/World.h"
+#include "TimerManager.h"
+#include "HAL/IConsoleManager.h"
+#include "Framework/Application/SlateApplication.h"
+#include "MenuSystem.h"
+#include "MenuSystemCharacter.h"
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Idle Lobbies"), STAT_IdleLobbies, STATGROUP_MenuSystem);
+
+namespace MenuSystemLobbyTick
+{
+	static int32 bEnabled = 1;
+	static FAutoConsoleVariableRef CVarEnabled(
+		TEXT("MenuSystem.LobbyTick.Enable"),
+		bEnabled,
+		TEXT("Lower the host's tick rate while the lobby is idle, see the lobby game mode's TickPolicy."));
+
+	/// Process-wide totals, reported by MenuSystem.LobbyTick.Report
+	static double IdleSeconds{ 0.0 };
+	static double IdleCoreSeconds{ 0.0 };
+	static double SavedCoreSeconds{ 0.0 };
+	static int32 NumIdlePeriods{ 0 };
+	static int32 NumWakes{ 0 };
+
+	static FAutoConsoleCommand CmdReport(
+		TEXT("MenuSystem.LobbyTick.Report"),
+		TEXT("Logs how long lobbies idled at the low tick rate, and the CPU that saved per idle lobby-hour."),
+		FConsoleCommandDelegate::CreateLambda([]()
+		{
+			const double IdleHours = IdleSeconds / 3600.0;
+			UE_LOG(LogMenuSystem, Display, TEXT("Lobby tick: %.2f idle lobby-hours over %d idle periods (%d ended by activity), %.2f cores used while idle"),
+				IdleHours, NumIdlePeriods, NumWakes, IdleSeconds > 0.0 ? IdleCoreSeconds / IdleSeconds : 0.0);
+			UE_LOG(LogMenuSystem, Display, TEXT("Lobby tick: ~%.0f CPU-seconds saved, ~%.0f CPU-seconds per idle lobby-hour"),
+				SavedCoreSeconds, IdleHours > 0.0 ? SavedCoreSeconds / IdleHours : 0.0);
+		}));
+
+	/// Weight of the newest sample in the awake CPU baseline
+	static constexpr double BaselineWeight = 0.1;
+
+	/// Process CPU use over the engine's last sample, in cores
+	static double GetProcessCores()
+	{
+		return FPlatformTime::GetCPUTime().CPUTimePctRelative / 100.0;
+	}
+}
+
+FLobbyTickGovernor::~FLobbyTickGovernor()
+{
+	Stop();
+}
+
+void FLobbyTickGovernor::Start(AGameModeBase* InGameMode, const FLobbyTickPolicy& InPolicy)
+{
+	Stop();
+	if (InGameMode == nullptr || !InPolicy.bEnabled || !MenuSystemLobbyTick::bEnabled)
+	{
+		return;
+	}
+
+	GameMode = InGameMode;
+	Policy = InPolicy;
+	LastEvaluationTime = FPlatformTime::Seconds();
+	bHasAwakeCores = false;
+	Wake();
+	ScheduleEvaluation();
+}
+
+void FLobbyTickGovernor::Stop()
+{
+	if (bIdle)
+	{
+		ExitIdle();
+	}
+
+	AGameModeBase* GameModePtr = GameMode.Get();
+	if (GameModePtr && GameModePtr->GetWorld())
+	{
+		GameModePtr->GetWorldTimerManager().ClearTimer(EvaluationTimerHandle);
+	}
+	GameMode.Reset();
+}
+
+void FLobbyTickGovernor::Wake()
+{
+	LastActivityTime = FPlatformTime::Seconds();
+
+	/// Input seen so far is spent; only newer input counts as activity
+	LastUserInteractionTime = FSlateApplication::IsInitialized() ? FSlateApplication::Get().GetLastUserInteractionTime() : 0.0;
+	if (bIdle)
+	{
+		++MenuSystemLobbyTick::NumWakes;
+		ExitIdle();
+	}
+}
+
+void FLobbyTickGovernor::Evaluate()
+{
+	const double Now = FPlatformTime::Seconds();
+	const double DeltaSeconds = Now - LastEvaluationTime;
+	LastEvaluationTime = Now;
+
+	const double Cores = MenuSystemLobbyTick::GetProcessCores();
+	if (bIdle)
+	{
+		MenuSystemLobbyTick::IdleSeconds += DeltaSeconds;
+		MenuSystemLobbyTick::IdleCoreSeconds += Cores * DeltaSeconds;
+		MenuSystemLobbyTick::SavedCoreSeconds += FMath::Max(AwakeCores - Cores, 0.0) * DeltaSeconds;
+	}
+
+	if (HasActivity())
+	{
+		Wake();
+		return;
+	}
+
+	if (bIdle)
+	{
+		return;
+	}
+
+	/// The baseline is the same quiet lobby at full rate, so a full or busy lobby doesn't inflate the savings
+	if (bHasAwakeCores)
+	{
+		AwakeCores = FMath::Lerp(AwakeCores, Cores, MenuSystemLobbyTick::BaselineWeight);
+	}
+	else
+	{
+		AwakeCores = Cores;
+		bHasAwakeCores = true;
+	}
+
+	if (Now - LastActivityTime >= Policy.IdleDelay)
+	{
+		EnterIdle();
+	}
+}
+
+bool FLobbyTickGovernor::HasActivity() const
+{
+	const AGameModeBase* GameModePtr = GameMode.Get();
+	const AGameStateBase* GameState = GameModePtr ? GameModePtr->GameState : nullptr;
+	if (GameState == nullptr)
+	{
+		return true;
+	}
+
+	if (GameState->PlayerArray.Num() > Policy.MaxIdlePlayers)
+	{
+		return true;
+	}
+
+	for (const APlayerState* PlayerState : GameState->PlayerArray)
+	{
+		const APawn* Pawn = PlayerState ? PlayerState->GetPawn() : nullptr;
+		if (const AMenuSystemCharacter* Character = Cast<AMenuSystemCharacter>(Pawn))
+		{
+			if (Character->HasMovementInput())
+			{
+				return true;
+			}
+		}
+		else if (Pawn && !Pawn->GetVelocity().IsNearlyZero())
+		{
+			return true;
+		}
+	}
+
+	/// The host's own player looking around or clicking through a menu doesn't move a character
+	return FSlateApplication::IsInitialized() && FSlateApplication::Get().GetLastUserInteractionTime() > LastUserInteractionTime;
+}
+
+void FLobbyTickGovernor::EnterIdle()
+{
+	AGameModeBase* GameModePtr = GameMode.Get();
+	UWorld* World = GameModePtr ? GameModePtr->GetWorld() : nullptr;
+	if (World == nullptr)
+	{
+		return;
+	}
+
+	bIdle = true;
+	IdleStartTime = FPlatformTime::Seconds();
+	++MenuSystemLobbyTick::NumIdlePeriods;
+	INC_DWORD_STAT(STAT_IdleLobbies);
+
+	if (UNetDriver* NetDriver = World->GetNetDriver())
+	{
+		SavedNetServerMaxTickRate = NetDriver->NetServerMaxTickRate;
+		NetDriver->NetServerMaxTickRate = FMath::Min(Policy.IdleTickRate, SavedNetServerMaxTickRate > 0 ? SavedNetServerMaxTickRate : Policy.IdleTickRate);
+	}
+
+	/// A listen server's frame rate isn't bound by the net driver's tick rate, and it renders too
+	if (World->GetNetMode() == NM_ListenServer && GEngine)
+	{
+		SavedMaxFPS = GEngine->GetMaxFPS();
+		bCappedMaxFPS = true;
+		GEngine->SetMaxFPS(SavedMaxFPS > 0.f ? FMath::Min(SavedMaxFPS, static_cast<float>(Policy.IdleTickRate)) : Policy.IdleTickRate);
+	}
+
+	UE_LOG(LogMenuSystem, Log, TEXT("Lobby idle: %d players, ticking at %d Hz (awake baseline %.2f cores)"),
+		GameModePtr->GameState ? GameModePtr->GameState->PlayerArray.Num() : 0, Policy.IdleTickRate, AwakeCores);
+	ScheduleEvaluation();
+}
+
+void FLobbyTickGovernor::ExitIdle()
+{
+	bIdle = false;
+	DEC_DWORD_STAT(STAT_IdleLobbies);
+
+	AGameModeBase* GameModePtr = GameMode.Get();
+	UWorld* World = GameModePtr ? GameModePtr->GetWorld() : nullptr;
+	if (UNetDriver* NetDriver = World ? World->GetNetDriver() : nullptr)
+	{
+		NetDriver->NetServerMaxTickRate = SavedNetServerMaxTickRate;
+	}
+
+	/// The engine outlives the lobby, so its cap is undone even when the world is already gone
+	if (bCappedMaxFPS && GEngine)
+	{
+		GEngine->SetMaxFPS(SavedMaxFPS);
+	}
+	bCappedMaxFPS = false;
+
+	UE_LOG(LogMenuSystem, Log, TEXT("Lobby awake after %.1f s idle"), FPlatformTime::Seconds() - IdleStartTime);
+	ScheduleEvaluation();
+}
+
+void FLobbyTickGovernor::ScheduleEvaluation()
+{
+	AGameModeBase* GameModePtr = GameMode.Get();
+	if (GameModePtr == nullptr || GameModePtr->GetWorld() == nullptr)
+	{
+		return;
+	}
+
+	const float Interval = bIdle ? 1.f / FMath::Max(Policy.IdleTickRate, 1) : Policy.EvaluationInterval;
+	GameModePtr->GetWorldTimerManager().SetTimer(EvaluationTimerHandle, FTimerDelegate::CreateRaw(this, &FLobbyTickGovernor::Evaluate), Interval, true);
+}
@@ -0,0 +1,69 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/EngineTypes.h"
+#include "LobbyReplicationPolicy.h"
+
+class AGameModeBase;
+
+/**
+ * Lowers the host's tick rate while the lobby has nothing to do.
+ * A lobby with one or two waiting players otherwise ticks, renders (on a listen server) and replicates at full
+ * frame rate. Once the lobby has had no more than MaxIdlePlayers, no moving character and no input on the host for
+ * IdleDelay, the host is capped to IdleTickRate: the net driver's NetServerMaxTickRate on a dedicated server, the
+ * engine's max FPS on a listen server. Replication happens once per server tick, so it slows down with it.
+ *
+ * Full rate comes back on the first frame that sees activity, and right away when a player starts logging in.
+ *
+ * The process CPU use while idle is compared against the lobby's awake baseline, sampled while the lobby is quiet but
+ * still waiting out IdleDelay, and reported as CPU-seconds saved per idle lobby-hour by MenuSystem.LobbyTick.Report.
+ * Server only; owned by ALobbyGameMode.
+ */
+class FLobbyTickGovernor
+{
+public:
+	~FLobbyTickGovernor();
+
+	void Start(AGameModeBase* InGameMode, const FLobbyTickPolicy& InPolicy);
+	void Stop();
+
+	/// Something happened (a player is logging in); restores full rate if idle, and restarts the idle delay
+	void Wake();
+
+	bool IsIdle() const { return bIdle; }
+
+private:
+	void Evaluate();
+
+	/// A player joined, a character moves, or the host's own player used the mouse or keyboard
+	bool HasActivity() const;
+
+	void EnterIdle();
+	void ExitIdle();
+
+	/// Awake: every EvaluationInterval; idle: every frame at the idle tick rate
+	void ScheduleEvaluation();
+
+	TWeakObjectPtr<AGameModeBase> GameMode;
+	FLobbyTickPolicy Policy;
+	FTimerHandle EvaluationTimerHandle;
+
+	bool bIdle{ false };
+	double LastActivityTime{ 0.0 };
+	double LastEvaluationTime{ 0.0 };
+	double IdleStartTime{ 0.0 };
+
+	/// Host player's last Slate interaction seen, so only new input counts
+	double LastUserInteractionTime{ 0.0 };
+
+	/// Process CPU use, in cores, averaged over recent evaluations that met the idle conditions during IdleDelay
+	double AwakeCores{ 0.0 };
+	bool bHasAwakeCores{ false };
+
+	/// What idling replaced, restored on ExitIdle
+	int32 SavedNetServerMaxTickRate{ 0 };
+	float SavedMaxFPS{ 0.f };
+	bool bCappedMaxFPS{ false };
+};
@@ -2,6 +2,20 @@
 
 #include "MenuSystem.h"
 #include "Modules/ModuleManager.h"
+#include "MenuSystemReplicationGraph.h"
 
-IMPLEMENT_PRIMARY_GAME_MODULE( FDefaultGameModuleImpl, MenuSystem, "MenuSystem" );
- 
\ No newline at end of file
+DEFINE_LOG_CATEGORY(LogMenuSystem);
+
+void FMenuSystemModule::StartupModule()
+{
+	/// Hook net driver creation so the game net driver gets our replication graph
+	/// Beacon and demo net drivers keep the default actor-iteration path
+	UMenuSystemReplicationGraph::RegisterReplicationDriverFactory();
+}
+
+void FMenuSystemModule::ShutdownModule()
+{
+	UMenuSystemReplicationGraph::UnregisterReplicationDriverFactory();
+}
+
+IMPLEMENT_PRIMARY_GAME_MODULE( FMenuSystemModule, MenuSystem, "MenuSystem" );
@@ -3,3 +3,19 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "Modules/ModuleManager.h"
+
+DECLARE_LOG_CATEGORY_EXTERN(LogMenuSystem, Log, All);
+
+/// Stat group for the game module's networking work (replication graph, lobby characters, etc.)
+/// Use "stat MenuSystem" in the console to display it
+DECLARE_STATS_GROUP(TEXT("MenuSystem"), STATGROUP_MenuSystem, STATCAT_Advanced);
+
+class FMenuSystemModule : public FDefaultGameModuleImpl
+{
+public:
+
+	/** IModuleInterface implementation */
+	virtual void StartupModule() override;
+	virtual void ShutdownModule() override;
+};
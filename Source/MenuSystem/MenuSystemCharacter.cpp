@@ -6,30 +6,49 @@
 #include "Components/InputComponent.h"
 #include "GameFramework/CharacterMovementComponent.h"
 #include "GameFramework/Controller.h"
+#include "GameFramework/PlayerController.h"
+#include "Engine/GameInstance.h"
 #include "GameFramework/SpringArmComponent.h"
-#include "OnlineSubsystem.h"
 #include "OnlineSessionSettings.h"
+#include "MultiplayerSessionsSubsystem.h"
+#include "MultiplayerSessionsHitchWatchdog.h"
+#include "Engine/NetDriver.h"
+#include "Net/UnrealNetwork.h"
+#include "TimerManager.h"
+#include "HAL/IConsoleManager.h"
+#include "MenuSystem.h"
+#include "LobbyGameMode.h"
+#include "MenuSystemReplicationGraph.h"
+#include "MenuSystemCharacterMovementComponent.h"
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Idle Characters"), STAT_IdleCharacters, STATGROUP_MenuSystem);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Dormant Characters"), STAT_DormantCharacters, STATGROUP_MenuSystem);
+
+namespace MenuSystemIdleReplication
+{
+	/// Server-wide totals, reported by MenuSystem.IdleRep.Report
+	static int32 NumIdleCharacters{ 0 };
+	static int32 NumDormantCharacters{ 0 };
+	static double EstimatedBytesSaved{ 0.0 };
+
+	static FAutoConsoleCommand CmdReport(
+		TEXT("MenuSystem.IdleRep.Report"),
+		TEXT("Logs how many characters are idle/dormant and the estimated replication bytes saved so far."),
+		FConsoleCommandDelegate::CreateLambda([]()
+		{
+			UE_LOG(LogMenuSystem, Display, TEXT("Idle replication: %d idle characters (%d dormant), ~%.1f KB saved"),
+				NumIdleCharacters, NumDormantCharacters, EstimatedBytesSaved / 1024.0);
+		}));
+}
 
 
 //////////////////////////////////////////////////////////////////////////
 // AMenuSystemCharacter
 
-AMenuSystemCharacter::AMenuSystemCharacter():
-	
-	/// initialize OnCreateSessionCompleteDelegate variable with an object of this type, and simultaneously pass in the callback function binding it to the delegate
-	/// create a delegate object that will be used to bind the callback function to the delegate, using the CreateUObject function to create a new instance of the delegate object
-	/// the delegate object is then assigned to the OnCreateSessionCompleteDelegate variable using the address of OnCreateSessionComplete
-	/// this is the same as saying OnCreateSessionCompleteDelegate = FOnCreateSessionCompleteDelegate::CreateUObject(this, &AMenuSystemCharacter::OnCreateSessionComplete);
-	CreateSessionCompleteDelegate(FOnCreateSessionCompleteDelegate::CreateUObject(this, &ThisClass::OnCreateSessionComplete)),
-
-	/// initialize OnFindSessionsCompleteDelegate variable with an object of this type, and simultaneously pass in the callback function binding it to the delegate
-	/// create a delegate object that will be used to bind the callback function to the delegate, using the CreateUObject function to create a new instance of the delegate object
-	FindSessionsCompleteDelegate(FOnFindSessionsCompleteDelegate::CreateUObject(this, &ThisClass::OnFindSessionsComplete)),
-
-	/// initialize OnJoinSessionCompleteDelegate variable with an object of this type, and simultaneously pass in the callback function binding it to the delegate
-	/// create a delegate object that will be used to bind the callback function to the delegate, using the CreateUObject function to create a new instance of the delegate object
-	JoinSessionCompleteDelegate(FOnJoinSessionCompleteDelegate::CreateUObject(this, &ThisClass::OnJoinSessionComplete))
-	
+AMenuSystemCharacter::AMenuSystemCharacter(const FObjectInitializer& ObjectInitializer):
+
+	/// Use our movement component, which picks its replication precision per map
+	Super(ObjectInitializer.SetDefaultSubobjectClass<UMenuSystemCharacterMovementComponent>(ACharacter::CharacterMovementComponentName))
 {
 	/// Set size for collision capsule
 	GetCapsuleComponent()->InitCapsuleSize(42.f, 96.0f);
@@ -67,28 +86,6 @@ AMenuSystemCharacter::AMenuSystemCharacter():
 
 	/// Note: The skeletal mesh and anim blueprint references on the Mesh component (inherited from Character) 
 	/// are set in the derived blueprint asset named ThirdPersonCharacter (to avoid direct content references in C++)
-
-	
-	
-	/// Access the OnlineSubsystem using the getter function, then check if the OnlineSubsystem is Valid
-	/// If OnlineSubsystem is Valid, access the OnlineSubsystem Interface
-	IOnlineSubsystem* OnlineSubsystem = IOnlineSubsystem::Get();
-	if (OnlineSubsystem)
-	{
-		OnlineSessionInterface = OnlineSubsystem->GetSessionInterface();
-		
-		/*
-		if (GEngine)
-		{
-			GEngine->AddOnScreenDebugMessage(
-				-1,
-				15.f,
-				FColor::Blue,
-				FString::Printf(TEXT("Found subsystem %s"), *OnlineSubsystem->GetSubsystemName().ToString())
-			);
-		}*/
-		
-	}
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -118,126 +115,288 @@ void AMenuSystemCharacter::SetupPlayerInputComponent(class UInputComponent* Play
 }
 
 
-void AMenuSystemCharacter::CreateGameSession()
+void AMenuSystemCharacter::PawnClientRestart()
+{
+	Super::PawnClientRestart();
+
+	/// Input is bound and the camera is ours now, the player sees the lobby from the next frame on
+	if (IsLocallyControlled())
+	{
+		GetWorldTimerManager().SetTimerForNextTick(this, &ThisClass::OnFirstPossessedTick);
+	}
+}
+
+
+void AMenuSystemCharacter::OnFirstPossessedTick()
 {
-	/// Called when pressing the 1 key
-	/// Check if the OnlineSessionInterface is valid, if not return out of the function
-	if (!OnlineSessionInterface.IsValid())
+	/// Only the first possession after a host/join has an open record, later respawns are ignored
+	UMultiplayerSessionsSubsystem* MultiplayerSessionsSubsystem = GetMultiplayerSessionsSubsystem();
+	if (MultiplayerSessionsSubsystem)
+	{
+		MultiplayerSessionsSubsystem->EndTraceCorrelation(TEXT("FirstPossessedTick"));
+	}
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+/// Idle replication
+
+void AMenuSystemCharacter::BeginPlay()
+{
+	Super::BeginPlay();
+
+	/// Only the server decides how the character replicates, and only when there is someone to replicate to
+	if (!HasAuthority() || GetNetMode() == NM_Standalone)
 	{
 		return;
 	}
-	
-	/// Get the existing session, if one exists with this name
-	/// If that existing session is not a null ptr then we will destroy the session with the same name
-	/// That way we can create a new session
-	
-	auto ExistingSession = OnlineSessionInterface->GetNamedSession(NAME_GameSession);
-	if (ExistingSession != nullptr)
+
+	/// The policy is per map, through the map's game mode
+	const ALobbyGameMode* LobbyGameMode = GetWorld()->GetAuthGameMode<ALobbyGameMode>();
+	if (LobbyGameMode == nullptr || LobbyGameMode->IdleReplicationPolicy.Mode == EIdleReplicationMode::Disabled)
 	{
-		OnlineSessionInterface->DestroySession(NAME_GameSession);
-		//if (GEngine)
-		//{
-		//	GEngine->AddOnScreenDebugMessage(
-		//		-1,
-		//		15.f,
-		//		FColor::Blue,
-		//		FString::Printf(TEXT("Destroy Existing Game Session"))
-		//	);
-		//}
+		return;
 	}
+	IdleReplicationPolicy = LobbyGameMode->IdleReplicationPolicy;
 
-	/// Once we create a session, we need to add the CreateSessionCompleteDelegate to the AddOnCreateSessionCompleteDelegate_Handle list
-	/// When the session is created, the OnCreateSessionComplete function will be called, which is bound the OnCreateSessionCompleteDelegate
-	OnlineSessionInterface->AddOnCreateSessionCompleteDelegate_Handle(CreateSessionCompleteDelegate);
+	/// The replication graph closes dormant channels for every connection, including the owner's
+	/// Reduce the rate instead so the owner keeps receiving its own character
+	const UNetDriver* NetDriver = GetNetDriver();
+	if (IdleReplicationPolicy.Mode == EIdleReplicationMode::Dormant && NetDriver && NetDriver->GetReplicationDriver())
+	{
+		UE_LOG(LogMenuSystem, Log, TEXT("%s: Dormant idle policy is not supported with the replication graph, using ReduceRate"), *GetName());
+		IdleReplicationPolicy.Mode = EIdleReplicationMode::ReduceRate;
+	}
 
-	/// Create SessionSettings, using FOnlineSessionSettings as a TSharePtr
-	/// Using the MakeShareable function to create a TSharedPtr from FOnlineSessionSettings
-	TSharedPtr<FOnlineSessionSettings> SessionSettings = MakeShareable(new FOnlineSessionSettings());
-	
-	/// Set SessionSettings
-	SessionSettings->bIsLANMatch = false; /// Is this a LAN game?
-	SessionSettings->NumPublicConnections = 4; /// Max number of players allowed in the session
-	SessionSettings->bAllowJoinInProgress = true; /// Allows people to join a session that is in progress
-	SessionSettings->bAllowJoinViaPresence = true; /// Whether joining via player presence is allowed or not
-	SessionSettings->bShouldAdvertise = true; /// Whether this match is publicly advertised on the on-line services
-	SessionSettings->bUsesPresence = true; /// Whether this match uses presence to matchmake or not
-	SessionSettings->bUseLobbiesIfAvailable = true; /// Whether to use lobbies if they are available or not
-	SessionSettings->Set(FName("MatchType"), FString("FreeForAll"), EOnlineDataAdvertisementType::ViaOnlineServiceAndPing); /// Set the match type to FreeForAll
-	
-	/// Get the LocalPlayer by using GetWorld() and then GetFirstLocalPlayerController()
-	/// This will return the first local player controller, which we can then access the GetPrefferedUniqueNetId function on to pass to the CreateSession function
-	const ULocalPlayer* LocalPlayer = GetWorld()->GetFirstLocalPlayerFromController();
-	
-	/// Using the OnlineSessionInterface, create a session with the name of "NAME_GameSession", the LocalPlayer's preferred unique net id, and the SessionSettings we created earlier
-	OnlineSessionInterface->CreateSession(*LocalPlayer->GetPreferredUniqueNetId(), NAME_GameSession, *SessionSettings);
+	ActiveNetUpdateFrequency = NetUpdateFrequency;
+
+	/// Pooled pawns start watching once they are handed to a player
+	if (!bIsPooled)
+	{
+		StartIdleReplication();
+	}
 }
 
+void AMenuSystemCharacter::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	StopIdleReplication();
+
+	Super::EndPlay(EndPlayReason);
+}
 
-void AMenuSystemCharacter::JoinGameSession()
+void AMenuSystemCharacter::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
 {
-	///** Find game sessions **///
-	
-	/// Check if the OnlineSessionInterface is valid, if not return out of the function
-	if (!OnlineSessionInterface.IsValid())
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(AMenuSystemCharacter, bIsPooled);
+}
+
+void AMenuSystemCharacter::SetPooled(bool bPooled)
+{
+	bIsPooled = bPooled;
+	if (bPooled)
+	{
+		StopIdleReplication();
+	}
+	else if (HasActorBegunPlay())
+	{
+		StartIdleReplication();
+	}
+}
+
+void AMenuSystemCharacter::OnRep_IsPooled()
+{
+	/// The server parks the pawn itself, see ALobbyGameMode::DeactivatePooledPawn
+	SetActorHiddenInGame(bIsPooled);
+	SetActorEnableCollision(!bIsPooled);
+	SetActorTickEnabled(!bIsPooled);
+}
+
+void AMenuSystemCharacter::StartIdleReplication()
+{
+	if (IdleReplicationPolicy.Mode == EIdleReplicationMode::Disabled || IdleReplicationTimerHandle.IsValid())
 	{
 		return;
 	}
-	
-	/// Add the FindSessionsCompleteDelegate to the OnlineSessionInterface using the AddOnFindSessionsCompleteDelegate_Handle list
-	/// When the session is found, the OnFindSessionsComplete function will be called, which is bound the OnFindSessionsCompleteDelegate
-	OnlineSessionInterface->AddOnFindSessionsCompleteDelegate_Handle(FindSessionsCompleteDelegate);
 
-	/// Setup session search settings which are required to find a session and call the session interface function FindSessions
-	/// We will use the FOnlineSessionSearch as a TSharedPtr to store the online session search settings
-	SessionSearch = MakeShareable(new FOnlineSessionSearch());
-	
-	/// Set the search settings
-	SessionSearch->MaxSearchResults = 10000;
-	SessionSearch->bIsLanQuery = false;
+	LastMovementTime = GetWorld()->GetTimeSeconds();
+	OnCharacterMovementUpdated.AddUniqueDynamic(this, &ThisClass::OnMovementUpdatedForIdleReplication);
+	GetWorldTimerManager().SetTimer(IdleReplicationTimerHandle, this, &ThisClass::EvaluateIdleReplication, IdleReplicationPolicy.EvaluationInterval, true);
+}
 
-	/// Set QuerySettings to make sure we only search for sessions using presence
-	SessionSearch->QuerySettings.Set(SEARCH_PRESENCE, true, EOnlineComparisonOp::Equals);
-	
-	/// Get the LocalPlayer by using GetWorld() and then GetFirstLocalPlayerController()
-	/// This will return the first local player controller, which we can then access the GetPrefferedUniqueNetId function on to pass to the FindSessions function
-	const ULocalPlayer* LocalPlayer = GetWorld()->GetFirstLocalPlayerFromController();
-	
-	/// Call the FindSessions function on the OnlineSessionInterface, passing in the FUniqueNetId and the SessionSearch TSharedPtr
-	/// This will return a list of sessions that match the search settings we set earlier
-	OnlineSessionInterface->FindSessions(*LocalPlayer->GetPreferredUniqueNetId(), SessionSearch.ToSharedRef());
+void AMenuSystemCharacter::StopIdleReplication()
+{
+	/// Keep the server-wide counters accurate when an idle character leaves or is pooled
+	if (bIsReplicationIdle)
+	{
+		ExitIdleReplication();
+	}
+	OnCharacterMovementUpdated.RemoveDynamic(this, &ThisClass::OnMovementUpdatedForIdleReplication);
+	GetWorldTimerManager().ClearTimer(IdleReplicationTimerHandle);
+}
+
+bool AMenuSystemCharacter::GetNetDormancy(const FVector& ViewPos, const FVector& ViewDir, AActor* Viewer, AActor* ViewTarget, UActorChannel* InChannel, float Time, bool bLowBandwidth)
+{
+	/// Only called while NetDormancy is DORM_DormantPartial, i.e. while idle with the Dormant policy
+	/// Stay awake for the owning connection so its move acks and corrections keep flowing
+	if (Viewer == GetController() || ViewTarget == this)
+	{
+		return false;
+	}
+	return bIsReplicationIdle;
 }
 
+void AMenuSystemCharacter::OnMovementUpdatedForIdleReplication(float DeltaSeconds, FVector OldLocation, FVector OldVelocity)
+{
+	/// Runs for every move the server processes, so an idle character wakes on the first move with input
+	if (bIsReplicationIdle && HasMovementInput())
+	{
+		LastMovementTime = GetWorld()->GetTimeSeconds();
+		ExitIdleReplication();
+	}
+}
 
-void AMenuSystemCharacter::OnCreateSessionComplete(FName SessionName, bool bWasSuccessful)
+void AMenuSystemCharacter::EvaluateIdleReplication()
 {
-	/// This is where we will verify that our session was created successfully
-	/// Callback function will be receiving information about the session that was created
-	/// If it was created successfully, we will then call the StartSession function
-	
-	/// Check if session was created successfully
-	/// If it was not successful, we will print out the error message
-	if (bWasSuccessful)
+	const double Now = GetWorld()->GetTimeSeconds();
+	if (HasMovementInput())
 	{
-		if (GEngine)
+		LastMovementTime = Now;
+		if (bIsReplicationIdle)
 		{
-			GEngine->AddOnScreenDebugMessage(
-				-1,
-				15.f,
-				FColor::Blue,
-				FString::Printf(TEXT("Created Session: %s"), *SessionName.ToString())
-			);
+			ExitIdleReplication();
 		}
-		
-		/// Call ServerTravel to load the game map when we create a session
-		/// We will use the "/Game/ThirdPersonCPP/Maps/Lobby" map as the lobby map
-		/// Lobby map will load as a listen server, so others will be able to join it
-		UWorld* World = GetWorld();
-		if (World)
+		return;
+	}
+
+	if (!bIsReplicationIdle)
+	{
+		if (Now - LastMovementTime >= IdleReplicationPolicy.IdleDelay)
 		{
-			World->ServerTravel(FString("/Game/ThirdPerson/Maps/Lobby?listen"));
+			EnterIdleReplication();
 		}
+		return;
+	}
+
+	/// Estimate the updates that were not sent this interval, to every client connection
+	const UNetDriver* NetDriver = GetNetDriver();
+	const int32 NumConnections = NetDriver ? NetDriver->ClientConnections.Num() : 0;
+	const float SkippedUpdatesPerSecond = IdleReplicationPolicy.Mode == EIdleReplicationMode::Dormant
+		? ActiveNetUpdateFrequency
+		: FMath::Max(ActiveNetUpdateFrequency - IdleReplicationPolicy.IdleNetUpdateFrequency, 0.f);
+	MenuSystemIdleReplication::EstimatedBytesSaved += static_cast<double>(SkippedUpdatesPerSecond) * IdleReplicationPolicy.EvaluationInterval * NumConnections * IdleReplicationPolicy.EstimatedBytesPerUpdate;
+}
+
+void AMenuSystemCharacter::EnterIdleReplication()
+{
+	bIsReplicationIdle = true;
+	++MenuSystemIdleReplication::NumIdleCharacters;
+	INC_DWORD_STAT(STAT_IdleCharacters);
+
+	if (IdleReplicationPolicy.Mode == EIdleReplicationMode::Dormant)
+	{
+		++MenuSystemIdleReplication::NumDormantCharacters;
+		INC_DWORD_STAT(STAT_DormantCharacters);
+		/// Partial dormancy lets GetNetDormancy keep the owning connection awake
+		SetNetDormancy(DORM_DormantPartial);
 	}
 	else
+	{
+		ApplyNetUpdateFrequency(IdleReplicationPolicy.IdleNetUpdateFrequency);
+	}
+}
+
+void AMenuSystemCharacter::ExitIdleReplication()
+{
+	bIsReplicationIdle = false;
+	--MenuSystemIdleReplication::NumIdleCharacters;
+	DEC_DWORD_STAT(STAT_IdleCharacters);
+
+	if (IdleReplicationPolicy.Mode == EIdleReplicationMode::Dormant)
+	{
+		--MenuSystemIdleReplication::NumDormantCharacters;
+		DEC_DWORD_STAT(STAT_DormantCharacters);
+		SetNetDormancy(DORM_Awake);
+	}
+	else
+	{
+		ApplyNetUpdateFrequency(ActiveNetUpdateFrequency);
+	}
+
+	/// Send the first update right away instead of waiting out the idle period
+	ForceNetUpdate();
+}
+
+void AMenuSystemCharacter::ApplyNetUpdateFrequency(float NewNetUpdateFrequency)
+{
+	NetUpdateFrequency = NewNetUpdateFrequency;
+
+	UNetDriver* NetDriver = GetNetDriver();
+	UMenuSystemReplicationGraph* ReplicationGraph = NetDriver ? Cast<UMenuSystemReplicationGraph>(NetDriver->GetReplicationDriver()) : nullptr;
+	if (ReplicationGraph)
+	{
+		ReplicationGraph->SetActorNetUpdateFrequency(this, NewNetUpdateFrequency);
+	}
+}
+
+bool AMenuSystemCharacter::HasMovementInput() const
+{
+	/// Acceleration is what MoveForward/MoveRight produce, and it is what the server receives in each move
+	/// Velocity and falling cover a character that is still coasting or in the air after input stopped
+	const UCharacterMovementComponent* MovementComponent = GetCharacterMovement();
+	return !MovementComponent->GetCurrentAcceleration().IsNearlyZero()
+		|| !MovementComponent->Velocity.IsNearlyZero()
+		|| MovementComponent->IsFalling();
+}
+
+
+void AMenuSystemCharacter::CreateGameSession()
+{
+	/// Session work lives in the MultiplayerSessions plugin; the pawn only forwards the request
+	/// The callback is bound on demand, so spawning a pawn doesn't touch the online subsystem at all
+	UMultiplayerSessionsSubsystem* MultiplayerSessionsSubsystem = GetMultiplayerSessionsSubsystem();
+	if (MultiplayerSessionsSubsystem == nullptr)
+	{
+		return;
+	}
+
+	MultiplayerSessionsSubsystem->MultiplayerOnCreateSessionComplete.AddUniqueDynamic(this, &ThisClass::OnCreateSession);
+	MultiplayerSessionsSubsystem->CreateSession(4, FString("FreeForAll"));
+}
+
+
+void AMenuSystemCharacter::JoinGameSession()
+{
+	UMultiplayerSessionsSubsystem* MultiplayerSessionsSubsystem = GetMultiplayerSessionsSubsystem();
+	if (MultiplayerSessionsSubsystem == nullptr)
+	{
+		return;
+	}
+
+	if (!FindSessionsCompleteHandle.IsValid())
+	{
+		FindSessionsCompleteHandle = MultiplayerSessionsSubsystem->MultiplayerOnFindSessionsComplete.AddUObject(this, &ThisClass::OnFindSessions);
+	}
+	MultiplayerSessionsSubsystem->FindSessions(10000, FString("FreeForAll"));
+}
+
+
+UMultiplayerSessionsSubsystem* AMenuSystemCharacter::GetMultiplayerSessionsSubsystem() const
+{
+	const UGameInstance* GameInstance = GetGameInstance();
+	return GameInstance ? GameInstance->GetSubsystem<UMultiplayerSessionsSubsystem>() : nullptr;
+}
+
+
+void AMenuSystemCharacter::OnCreateSession(bool bWasSuccessful)
+{
+	UMultiplayerSessionsSubsystem* MultiplayerSessionsSubsystem = GetMultiplayerSessionsSubsystem();
+	if (MultiplayerSessionsSubsystem)
+	{
+		MultiplayerSessionsSubsystem->MultiplayerOnCreateSessionComplete.RemoveDynamic(this, &ThisClass::OnCreateSession);
+	}
+
+	if (!bWasSuccessful)
 	{
 		if (GEngine)
 		{
@@ -245,121 +404,60 @@ void AMenuSystemCharacter::OnCreateSessionComplete(FName SessionName, bool bWasS
 				-1,
 				15.f,
 				FColor::Red,
-				FString::Printf(TEXT("Could not create session %s"), *SessionName.ToString())
+				FString(TEXT("Could not create session"))
 			);
 		}
-			
+		return;
 	}
 
+	/// Lobby map will load as a listen server, so others will be able to join it
+	UWorld* World = GetWorld();
+	if (World)
+	{
+		MULTIPLAYERSESSIONS_TRAVEL_HITCH_SCOPE(ServerTravel);
+		World->ServerTravel(FString("/Game/ThirdPerson/Maps/Lobby?listen"));
+	}
 }
 
 
-void AMenuSystemCharacter::OnFindSessionsComplete(bool bWasSuccessful)
+void AMenuSystemCharacter::OnFindSessions(const TSharedRef<FSessionResultStore>& SearchResults, bool bWasSuccessful)
 {
-	/// This function will be called in response to the delegate broadcast sent by the session interface.
-	/// Once the action of finding sessions has been completed.
-	
-
-	/// Check if the OnlineSessionInterface is valid, if not return out of the function
-	if (!OnlineSessionInterface.IsValid())
+	UMultiplayerSessionsSubsystem* MultiplayerSessionsSubsystem = GetMultiplayerSessionsSubsystem();
+	if (MultiplayerSessionsSubsystem == nullptr)
 	{
 		return;
 	}
+	MultiplayerSessionsSubsystem->MultiplayerOnFindSessionsComplete.Remove(FindSessionsCompleteHandle);
+	FindSessionsCompleteHandle.Reset();
 
-	
-	/// loop through the list of sessions and print out the session names
-	/// We will use the SessionSearch TSharedPtr to get the list of sessions
-	for (auto Result : SessionSearch->SearchResults)
-	{	
-		/// Get the session name
-		FString Id = Result.GetSessionIdStr();
-		/// Get the session owning player
-		FString User = Result.Session.OwningUserName;
-		
-		/// Store the MatchType
-		FString MatchType;
-		/// Get the match type, using the Get function on the SessionSearch
-		Result.Session.SessionSettings.Get(FName("MatchType"), MatchType);
-		
-		
-		if (GEngine)
-		{
-			GEngine->AddOnScreenDebugMessage(
-			-1,
-			15.f,
-			FColor::Cyan,
-			FString::Printf(TEXT("Found Session Id: %s, User: %s"), *Id, *User)
-			);
-		}
-		
-		
-		/// Check if the match type is FreeForAll
-		if (MatchType == FString("FreeForAll"))
-		{
-			if (GEngine)
-			{
-				GEngine->AddOnScreenDebugMessage(
-				-1,
-				15.f,
-				FColor::Cyan,
-				FString::Printf(TEXT("Joining Match Type: %s"), *MatchType)
-				);
-			}
-
-		
-			/// Add the JoinSessionCompleteDelegate to the OnlineSessionInterface using the AddOnJoinSessionCompleteDelegate_Handle list
-			/// When the session is joined, the OnJoinSessionComplete function will be called, which is bound the OnJoinSessionCompleteDelegate
-			OnlineSessionInterface->AddOnJoinSessionCompleteDelegate_Handle(JoinSessionCompleteDelegate);
-
-			/// Get the LocalPlayer by using GetWorld() and then GetFirstLocalPlayerController()
-			const ULocalPlayer* LocalPlayer = GetWorld()->GetFirstLocalPlayerFromController();
-		
-			/// Call the JoinSession function on the OnlineSessionInterface, passing in the FUniqueNetId and the SessionName
-			/// This will join the session we found earlier
-			OnlineSessionInterface->JoinSession(*LocalPlayer->GetPreferredUniqueNetId(), NAME_GameSession, Result);
-		}
+	/// Only FreeForAll matches were kept, best ranked first; join that one, the same way the menu does
+	if (SearchResults->Num() > 0)
+	{
+		JoinSessionCompleteHandle = MultiplayerSessionsSubsystem->MultiplayerOnJoinSessionComplete.AddUObject(this, &ThisClass::OnJoinSession);
+		MultiplayerSessionsSubsystem->JoinSession(SearchResults->GetSearchResult(0));
 	}
 }
 
 
-void AMenuSystemCharacter::OnJoinSessionComplete(FName SessionName, EOnJoinSessionCompleteResult::Type Result)
+void AMenuSystemCharacter::OnJoinSession(EOnJoinSessionCompleteResult::Type Result)
 {
-	/// This function will be called in response to the delegate broadcast sent by the session interface.
-	/// Once the action of joining a session has been completed.
-	
-	/// Check if the OnlineSessionInterface is valid, if not return out of the function
-	if (!OnlineSessionInterface.IsValid())
+	UMultiplayerSessionsSubsystem* MultiplayerSessionsSubsystem = GetMultiplayerSessionsSubsystem();
+	if (MultiplayerSessionsSubsystem == nullptr)
 	{
 		return;
 	}
-	
-	/// Get the IP address of the session
-	/// Store the IP address in the FString variable "Address"
+	MultiplayerSessionsSubsystem->MultiplayerOnJoinSessionComplete.Remove(JoinSessionCompleteHandle);
+	JoinSessionCompleteHandle.Reset();
+
 	FString Address;
-	
-	/// Check if the session was joined successfully
-	if (OnlineSessionInterface->GetResolvedConnectString(NAME_GameSession, Address))
+	if (Result == EOnJoinSessionCompleteResult::Success && MultiplayerSessionsSubsystem->GetResolvedConnectString(Address))
 	{
-		if (GEngine)
-			{
-				GEngine->AddOnScreenDebugMessage(
-				-1,
-				15.f,
-				FColor::Yellow,
-				FString::Printf(TEXT("Connect String: %s"), *Address)
-				);
-			}
-		
-		/// Get the player controller by using GetGameInstance
 		APlayerController* PlayerController = GetGameInstance()->GetFirstLocalPlayerController();
-		
-		/// Check if the player controller is valid
-		/// Call the ServerTravel function on the PlayerController, passing in the Address and the TravelType
 		if (PlayerController)
 		{
-			PlayerController->ClientTravel(Address, ETravelType::TRAVEL_Absolute);
+			MULTIPLAYERSESSIONS_TRAVEL_HITCH_SCOPE(ClientTravel);
+			PlayerController->ClientTravel(MultiplayerSessionsSubsystem->BuildTravelURL(Address), ETravelType::TRAVEL_Absolute);
 		}
-		
 	}
 }
 
@@ -414,3 +512,66 @@ void AMenuSystemCharacter::MoveRight(float Value)
 		AddMovementInput(Direction, Value);
 	}
 }
+
+
+//////////////////////////////////////////////////////////////////////////
+/// Spawn benchmark
+///
+/// Spawns N pawns of the game mode's default pawn class (or AMenuSystemCharacter), reports the average construction
+/// time and memory per pawn, then destroys them. Run on a server to compare pawn spawn cost between builds.
+
+#if !UE_BUILD_SHIPPING
+
+namespace MenuSystemSpawnBenchmark
+{
+	static FAutoConsoleCommandWithWorldAndArgs CmdSpawnPawns(
+		TEXT("MenuSystem.Bench.SpawnPawns"),
+		TEXT("Spawns N pawns (default 100), logs per-pawn spawn time and memory, then destroys them."),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+		{
+			if (World == nullptr || World->GetNetMode() == NM_Client)
+			{
+				UE_LOG(LogMenuSystem, Warning, TEXT("MenuSystem.Bench.SpawnPawns must be run on the server or in standalone"));
+				return;
+			}
+
+			const int32 NumPawns = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 1) : 100;
+			const AGameModeBase* GameMode = World->GetAuthGameMode();
+			UClass* PawnClass = (GameMode && GameMode->DefaultPawnClass) ? GameMode->DefaultPawnClass.Get() : AMenuSystemCharacter::StaticClass();
+
+			FActorSpawnParameters SpawnParameters;
+			SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+			TArray<AActor*> SpawnedPawns;
+			SpawnedPawns.Reserve(NumPawns);
+
+			const uint64 UsedMemoryBefore = FPlatformMemory::GetStats().UsedPhysical;
+			const double StartTime = FPlatformTime::Seconds();
+			for (int32 Index = 0; Index < NumPawns; ++Index)
+			{
+				/// Spread them out on a grid far below the level so they don't interact with anything
+				const FVector Location(200.f * (Index % 32), 200.f * (Index / 32), -100000.f);
+				SpawnedPawns.Add(World->SpawnActor(PawnClass, &Location, nullptr, SpawnParameters));
+			}
+			const double ElapsedSeconds = FPlatformTime::Seconds() - StartTime;
+			const int64 UsedMemoryDelta = static_cast<int64>(FPlatformMemory::GetStats().UsedPhysical) - static_cast<int64>(UsedMemoryBefore);
+
+			UE_LOG(LogMenuSystem, Display, TEXT("Spawned %d x %s in %.2f ms: %.3f ms per pawn, ~%.1f KB resident per pawn, %d bytes of properties per instance"),
+				NumPawns,
+				*PawnClass->GetName(),
+				ElapsedSeconds * 1000.0,
+				ElapsedSeconds * 1000.0 / NumPawns,
+				UsedMemoryDelta / 1024.0 / NumPawns,
+				PawnClass->GetPropertiesSize());
+
+			for (AActor* Pawn : SpawnedPawns)
+			{
+				if (Pawn)
+				{
+					Pawn->Destroy();
+				}
+			}
+		}));
+}
+
+#endif
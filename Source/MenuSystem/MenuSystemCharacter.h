@@ -5,6 +5,8 @@
 #include "CoreMinimal.h"
 #include "GameFramework/Character.h"
 #include "Interfaces/OnlineSessionInterface.h"
+#include "LobbyReplicationPolicy.h"
+#include "SessionResultStore.h"
 
 #include "MenuSystemCharacter.generated.h"
 
@@ -21,7 +23,7 @@ class AMenuSystemCharacter : public ACharacter
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Camera, meta = (AllowPrivateAccess = "true"))
 	class UCameraComponent* FollowCamera;
 public:
-	AMenuSystemCharacter();
+	AMenuSystemCharacter(const FObjectInitializer& ObjectInitializer);
 
 	/** Base turn rate, in deg/sec. Other scaling may affect final turn rate. */
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category=Input)
@@ -56,47 +58,91 @@ protected:
 protected:
 	// APawn interface
 	virtual void SetupPlayerInputComponent(class UInputComponent* PlayerInputComponent) override;
+	virtual void PawnClientRestart() override;
 	// End of APawn interface
 
+	// AActor interface
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	virtual bool GetNetDormancy(const FVector& ViewPos, const FVector& ViewDir, class AActor* Viewer, AActor* ViewTarget, class UActorChannel* InChannel, float Time, bool bLowBandwidth) override;
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+	// End of AActor interface
+
 public:
 	/** Returns CameraBoom subobject **/
 	FORCEINLINE class USpringArmComponent* GetCameraBoom() const { return CameraBoom; }
 	/** Returns FollowCamera subobject **/
 	FORCEINLINE class UCameraComponent* GetFollowCamera() const { return FollowCamera; }
 
-public:
+	/** Called by the lobby pawn pool when the pawn is parked (true) or handed to a new player (false) **/
+	void SetPooled(bool bPooled);
 
-	// Pointer to the online session interface
-	IOnlineSessionPtr OnlineSessionInterface;
+	/// True when there is movement input (acceleration) or the character is still moving
+	/// Also read by the lobby's tick governor, see FLobbyTickGovernor
+	bool HasMovementInput() const;
 
 protected:
-	// Blueprint Callable function, to create a new game session
+	/// Debug shortcuts that forward to the MultiplayerSessions plugin; the menu is the normal way in
+	/// Create a session and travel to the lobby as a listen server
 	UFUNCTION(BlueprintCallable)
 	void CreateGameSession();
 
+	/// Find sessions and join the first FreeForAll match
 	UFUNCTION(BlueprintCallable)
 	void JoinGameSession();
-	
-	// Callback function in response to creating a successful game session; bound to CreateSessionCompleteDelegate
-	void OnCreateSessionComplete(FName SessionName, bool bWasSuccessful);
-	
-	// Callback function in response to fining a successful game session; bound to FindSessionCompleteDelegate
-	void OnFindSessionsComplete(bool bWasSuccessful);
-	
-	// Callback function in response to joining a successful game session; bound to JoinSessionCompleteDelegate
-	void OnJoinSessionComplete(FName SessionName, EOnJoinSessionCompleteResult::Type Result);
-	
+
 private:
-	
-	// Delegate fired when a create session request has completed
-	FOnCreateSessionCompleteDelegate CreateSessionCompleteDelegate;
-	// Delegate fired when a find session request has completed
-	FOnFindSessionsCompleteDelegate FindSessionsCompleteDelegate;
-
-	// Delegate fired when a join session request has completed
-	FOnJoinSessionCompleteDelegate JoinSessionCompleteDelegate;
-	
-	// Variable used to capture the session search results
-	TSharedPtr<FOnlineSessionSearch> SessionSearch;
+
+	class UMultiplayerSessionsSubsystem* GetMultiplayerSessionsSubsystem() const;
+
+	/// Callbacks for the plugin subsystem's delegates; bound only while a request is in flight
+	UFUNCTION()
+	void OnCreateSession(bool bWasSuccessful);
+	void OnFindSessions(const TSharedRef<FSessionResultStore>& SearchResults, bool bWasSuccessful);
+	void OnJoinSession(EOnJoinSessionCompleteResult::Type Result);
+
+	FDelegateHandle FindSessionsCompleteHandle;
+	FDelegateHandle JoinSessionCompleteHandle;
+
+	/// Next tick after the local player takes control; closes the time-to-lobby record of the host/join that got us here
+	void OnFirstPossessedTick();
+
+	///
+	/// Idle replication (server only)
+	/// The policy comes from the map's game mode; see FIdleReplicationPolicy
+	///
+
+	/// Wakes an idle character as soon as a move with input is processed on the server
+	UFUNCTION()
+	void OnMovementUpdatedForIdleReplication(float DeltaSeconds, FVector OldLocation, FVector OldVelocity);
+
+	/// Starts/stops watching for idle; the character is awake again after StopIdleReplication
+	void StartIdleReplication();
+	void StopIdleReplication();
+
+	/// Timer callback; puts the character to sleep once it has been still for IdleDelay
+	void EvaluateIdleReplication();
+
+	void EnterIdleReplication();
+	void ExitIdleReplication();
+
+	/// Sets NetUpdateFrequency and forwards it to the replication graph when one is active
+	void ApplyNetUpdateFrequency(float NewNetUpdateFrequency);
+
+	FIdleReplicationPolicy IdleReplicationPolicy;
+	FTimerHandle IdleReplicationTimerHandle;
+
+	/// NetUpdateFrequency to restore when the character wakes up
+	float ActiveNetUpdateFrequency{ 0.f };
+	double LastMovementTime{ 0.0 };
+	bool bIsReplicationIdle{ false };
+
+	/// Parked in the lobby pawn pool, see SetPooled
+	/// Replicated so clients hide the parked pawn and drop its collision instead of keeping a frozen copy in the lobby
+	UPROPERTY(ReplicatedUsing = OnRep_IsPooled)
+	bool bIsPooled{ false };
+
+	UFUNCTION()
+	void OnRep_IsPooled();
 };
 
@@ -0,0 +1,198 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MenuSystemCharacterMovementComponent.h"
+#include "MenuSystem.h"
+#include "LobbyGameMode.h"
+#include "Engine/NetConnection.h"
+#include "Engine/NetDriver.h"
+#include "Engine/World.h"
+#include "GameFramework/Character.h"
+#include "GameFramework/GameStateBase.h"
+#include "HAL/IConsoleManager.h"
+
+
+//////////////////////////////////////////////////////////////////////////
+/// Network move data
+
+bool FMenuSystemCharacterNetworkMoveData::Serialize(UCharacterMovementComponent& CharacterMovement, FArchive& Ar, UPackageMap* PackageMap, ENetworkMoveType MoveType)
+{
+	/// The format bit travels with every move, so the server reads whatever the client wrote
+	bool bReducedPrecision = false;
+	if (Ar.IsSaving())
+	{
+		const UMenuSystemCharacterMovementComponent* MovementComponent = Cast<UMenuSystemCharacterMovementComponent>(&CharacterMovement);
+		bReducedPrecision = MovementComponent && MovementComponent->GetMovementPrecision() == EMovementReplicationPrecision::Reduced;
+	}
+	Ar.SerializeBits(&bReducedPrecision, 1);
+
+	if (!bReducedPrecision)
+	{
+		return FCharacterNetworkMoveData::Serialize(CharacterMovement, Ar, PackageMap, MoveType);
+	}
+
+	NetworkMoveType = MoveType;
+	bool bLocalSuccess = true;
+	const bool bIsSaving = Ar.IsSaving();
+
+	Ar << TimeStamp;
+
+	/// Whole-cm acceleration, which the client also simulates with (see RoundAcceleration)
+	/// Location stays at 0.1 cm: the client doesn't round its own, and whole cm would use up most of the server's position error tolerance
+	FVector_NetQuantize ReducedAcceleration(Acceleration);
+	FVector_NetQuantize10 ReducedLocation(Location);
+	ReducedAcceleration.NetSerialize(Ar, PackageMap, bLocalSuccess);
+	ReducedLocation.NetSerialize(Ar, PackageMap, bLocalSuccess);
+
+	/// One byte each for pitch and yaw; characters never roll
+	uint8 Pitch = FRotator::CompressAxisToByte(ControlRotation.Pitch);
+	uint8 Yaw = FRotator::CompressAxisToByte(ControlRotation.Yaw);
+	Ar << Pitch;
+	Ar << Yaw;
+
+	SerializeOptionalValue<uint8>(bIsSaving, Ar, CompressedMoveFlags, 0);
+
+	if (MoveType == ENetworkMoveType::NewMove)
+	{
+		/// Same as the base class, only the final move carries the base and movement mode for error checking
+		SerializeOptionalValue<UPrimitiveComponent*>(bIsSaving, Ar, MovementBase, nullptr);
+		SerializeOptionalValue<FName>(bIsSaving, Ar, MovementBaseBoneName, NAME_None);
+		SerializeOptionalValue<uint8>(bIsSaving, Ar, MovementMode, MOVE_Walking);
+	}
+
+	if (Ar.IsLoading())
+	{
+		Acceleration = ReducedAcceleration;
+		Location = ReducedLocation;
+		ControlRotation = FRotator(FRotator::DecompressAxisFromByte(Pitch), FRotator::DecompressAxisFromByte(Yaw), 0.f);
+	}
+
+	return !Ar.IsError() && bLocalSuccess;
+}
+
+FMenuSystemCharacterNetworkMoveDataContainer::FMenuSystemCharacterNetworkMoveDataContainer()
+{
+	NewMoveData = &MenuSystemMoveData[0];
+	PendingMoveData = &MenuSystemMoveData[1];
+	OldMoveData = &MenuSystemMoveData[2];
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+/// UMenuSystemCharacterMovementComponent
+
+UMenuSystemCharacterMovementComponent::UMenuSystemCharacterMovementComponent()
+{
+	SetNetworkMoveDataContainer(MenuSystemMoveDataContainer);
+}
+
+void UMenuSystemCharacterMovementComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	/// The server picks the quantization of replicated movement; FRepMovement sends the levels along with the data
+	if (CharacterOwner && CharacterOwner->HasAuthority() && GetMovementPrecision() == EMovementReplicationPrecision::Reduced)
+	{
+		FRepMovement& ReplicatedMovement = CharacterOwner->GetReplicatedMovement_Mutable();
+		ReplicatedMovement.LocationQuantizationLevel = EVectorQuantization::RoundWholeNumber;
+		ReplicatedMovement.VelocityQuantizationLevel = EVectorQuantization::RoundWholeNumber;
+		ReplicatedMovement.RotationQuantizationLevel = ERotatorQuantization::ByteComponents;
+	}
+}
+
+float UMenuSystemCharacterMovementComponent::GetClientNetSendDeltaTime(const APlayerController* PC, const FNetworkPredictionData_Client_Character* ClientData, const FSavedMovePtr& NewMove) const
+{
+	const float NetSendDeltaTime = Super::GetClientNetSendDeltaTime(PC, ClientData, NewMove);
+
+	/// Sending less often lets more saved moves combine into each ServerMove RPC
+	if (GetMovementPrecision() == EMovementReplicationPrecision::Reduced)
+	{
+		return FMath::Max(NetSendDeltaTime, ReducedPrecisionNetSendDeltaTime);
+	}
+	return NetSendDeltaTime;
+}
+
+FVector UMenuSystemCharacterMovementComponent::RoundAcceleration(FVector InAccel) const
+{
+	/// Reduced precision moves send whole-cm acceleration, so the client has to predict with exactly what the server decodes
+	if (GetMovementPrecision() == EMovementReplicationPrecision::Reduced)
+	{
+		return FVector(FMath::RoundToFloat(InAccel.X), FMath::RoundToFloat(InAccel.Y), FMath::RoundToFloat(InAccel.Z));
+	}
+	return Super::RoundAcceleration(InAccel);
+}
+
+EMovementReplicationPrecision UMenuSystemCharacterMovementComponent::GetMovementPrecision() const
+{
+	if (CachedMovementPrecision.IsSet())
+	{
+		return CachedMovementPrecision.GetValue();
+	}
+
+	/// Clients don't have a game mode, but the GameState replicates its class, so both sides read the same CDO
+	const UWorld* World = GetWorld();
+	const AGameStateBase* GameState = World ? World->GetGameState() : nullptr;
+	if (GameState == nullptr || GameState->GameModeClass == nullptr)
+	{
+		return EMovementReplicationPrecision::Full;
+	}
+
+	const ALobbyGameMode* LobbyGameMode = Cast<ALobbyGameMode>(GameState->GameModeClass->GetDefaultObject());
+	CachedMovementPrecision = LobbyGameMode ? LobbyGameMode->MovementPrecision : EMovementReplicationPrecision::Full;
+	return CachedMovementPrecision.GetValue();
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+/// Bandwidth report
+///
+/// Logs bytes per second for each connection so the movement savings can be compared between a lobby map with
+/// Reduced precision and the same map with the BP_LobbyGameMode precision set to Full.
+
+#if !UE_BUILD_SHIPPING
+
+namespace MenuSystemMovement
+{
+	static FAutoConsoleCommandWithWorld CmdBandwidth(
+		TEXT("MenuSystem.Net.Bandwidth"),
+		TEXT("Logs in/out bytes per second for every net connection (per client on a server, the server connection on a client)."),
+		FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+		{
+			const UNetDriver* NetDriver = World ? World->GetNetDriver() : nullptr;
+			if (NetDriver == nullptr)
+			{
+				UE_LOG(LogMenuSystem, Warning, TEXT("MenuSystem.Net.Bandwidth: no net driver"));
+				return;
+			}
+
+			auto LogConnection = [](const UNetConnection* Connection)
+			{
+				UE_LOG(LogMenuSystem, Display, TEXT("  %s: in %d B/s, out %d B/s"),
+					*Connection->LowLevelGetRemoteAddress(true), Connection->InBytesPerSecond, Connection->OutBytesPerSecond);
+			};
+
+			if (NetDriver->ServerConnection)
+			{
+				UE_LOG(LogMenuSystem, Display, TEXT("Bandwidth (client):"));
+				LogConnection(NetDriver->ServerConnection);
+				return;
+			}
+
+			UE_LOG(LogMenuSystem, Display, TEXT("Bandwidth (server, %d clients):"), NetDriver->ClientConnections.Num());
+			int64 TotalIn = 0;
+			int64 TotalOut = 0;
+			for (const UNetConnection* Connection : NetDriver->ClientConnections)
+			{
+				LogConnection(Connection);
+				TotalIn += Connection->InBytesPerSecond;
+				TotalOut += Connection->OutBytesPerSecond;
+			}
+			if (NetDriver->ClientConnections.Num() > 0)
+			{
+				UE_LOG(LogMenuSystem, Display, TEXT("  average per client: in %lld B/s, out %lld B/s"),
+					TotalIn / NetDriver->ClientConnections.Num(), TotalOut / NetDriver->ClientConnections.Num());
+			}
+		}));
+}
+
+#endif
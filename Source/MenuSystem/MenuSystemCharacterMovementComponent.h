@@ -0,0 +1,56 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "LobbyReplicationPolicy.h"
+#include "MenuSystemCharacterMovementComponent.generated.h"
+
+/**
+ * Move data sent from client to server in the packed ServerMove RPCs.
+ * Reduced precision writes whole-cm acceleration, 0.1 cm location and a byte per control rotation axis.
+ * Every move carries one bit saying which format it uses, so client and server never need to agree up front.
+ */
+struct FMenuSystemCharacterNetworkMoveData : public FCharacterNetworkMoveData
+{
+	virtual bool Serialize(UCharacterMovementComponent& CharacterMovement, FArchive& Ar, UPackageMap* PackageMap, ENetworkMoveType MoveType) override;
+};
+
+struct FMenuSystemCharacterNetworkMoveDataContainer : public FCharacterNetworkMoveDataContainer
+{
+	FMenuSystemCharacterNetworkMoveDataContainer();
+
+	FMenuSystemCharacterNetworkMoveData MenuSystemMoveData[3];
+};
+
+/**
+ * Character movement with per-map replication precision.
+ * Lobby maps use reduced precision for server->client replicated movement and for client->server moves;
+ * match maps keep the engine defaults. See ALobbyGameMode::MovementPrecision.
+ */
+UCLASS()
+class MENUSYSTEM_API UMenuSystemCharacterMovementComponent : public UCharacterMovementComponent
+{
+	GENERATED_BODY()
+
+public:
+	UMenuSystemCharacterMovementComponent();
+
+	virtual void BeginPlay() override;
+	virtual float GetClientNetSendDeltaTime(const APlayerController* PC, const FNetworkPredictionData_Client_Character* ClientData, const FSavedMovePtr& NewMove) const override;
+	virtual FVector RoundAcceleration(FVector InAccel) const override;
+
+	/// Precision for the current map; resolved from the game mode class once the GameState is available
+	EMovementReplicationPrecision GetMovementPrecision() const;
+
+	/// Minimum time between client moves sent to the server with reduced precision; moves in between are combined
+	UPROPERTY(EditDefaultsOnly, Category = "Character Movement (Networking)", meta = (ClampMin = "0.0", ClampMax = "0.2"))
+	float ReducedPrecisionNetSendDeltaTime{ 1.f / 30.f };
+
+private:
+	FMenuSystemCharacterNetworkMoveDataContainer MenuSystemMoveDataContainer;
+
+	/// Cached once the GameState has replicated; until then full precision is used
+	mutable TOptional<EMovementReplicationPrecision> CachedMovementPrecision;
+};
@@ -2,14 +2,69 @@
 
 #include "MenuSystemGameMode.h"
 #include "MenuSystemCharacter.h"
-#include "UObject/ConstructorHelpers.h"
+#include "MenuSystem.h"
+#include "Engine/AssetManager.h"
+#include "Engine/StreamableManager.h"
+#include "GameFramework/PlayerController.h"
 
 AMenuSystemGameMode::AMenuSystemGameMode()
 {
 	// set default pawn class to our Blueprinted character
-	static ConstructorHelpers::FClassFinder<APawn> PlayerPawnBPClass(TEXT("/Game/ThirdPerson/Blueprints/BP_ThirdPersonCharacter"));
-	if (PlayerPawnBPClass.Class != NULL)
+	// soft reference, so constructing the CDO doesn't load the character, its mesh and animations in the boot path
+	DefaultPawnSoftClass = TSoftClassPtr<APawn>(FSoftObjectPath(TEXT("/Game/ThirdPerson/Blueprints/BP_ThirdPersonCharacter.BP_ThirdPersonCharacter_C")));
+
+	// used if the Blueprinted character fails to load
+	DefaultPawnClass = AMenuSystemCharacter::StaticClass();
+}
+
+void AMenuSystemGameMode::InitGame(const FString& MapName, const FString& Options, FString& ErrorMessage)
+{
+	Super::InitGame(MapName, Options, ErrorMessage);
+
+	if (DefaultPawnSoftClass.IsNull() || DefaultPawnSoftClass.Get())
+	{
+		return;
+	}
+
+	DefaultPawnClassLoadStartTime = FPlatformTime::Seconds();
+	DefaultPawnClassHandle = UAssetManager::GetStreamableManager().RequestAsyncLoad(
+		DefaultPawnSoftClass.ToSoftObjectPath(),
+		FStreamableDelegate::CreateUObject(this, &ThisClass::OnDefaultPawnClassLoaded),
+		FStreamableManager::AsyncLoadHighPriority);
+}
+
+UClass* AMenuSystemGameMode::GetDefaultPawnClassForController_Implementation(AController* InController)
+{
+	if (UClass* PawnClass = DefaultPawnSoftClass.Get())
+	{
+		return PawnClass;
+	}
+	return Super::GetDefaultPawnClassForController_Implementation(InController);
+}
+
+bool AMenuSystemGameMode::PlayerCanRestart_Implementation(APlayerController* Player)
+{
+	// hold the player back until the character has loaded, rather than spawning the fallback pawn
+	if (DefaultPawnClassHandle.IsValid() && DefaultPawnClassHandle->IsLoadingInProgress())
+	{
+		return false;
+	}
+	return Super::PlayerCanRestart_Implementation(Player);
+}
+
+void AMenuSystemGameMode::OnDefaultPawnClassLoaded()
+{
+	UE_LOG(LogMenuSystem, Log, TEXT("Default pawn class %s loaded in %.1f ms"),
+		*DefaultPawnSoftClass.ToString(), (FPlatformTime::Seconds() - DefaultPawnClassLoadStartTime) * 1000.0);
+	DefaultPawnClassHandle.Reset();
+
+	// spawn pawns for the players that logged in while it was loading
+	for (FConstPlayerControllerIterator Iterator = GetWorld()->GetPlayerControllerIterator(); Iterator; ++Iterator)
 	{
-		DefaultPawnClass = PlayerPawnBPClass.Class;
+		APlayerController* PlayerController = Iterator->Get();
+		if (PlayerController && PlayerController->GetPawn() == nullptr && PlayerCanRestart(PlayerController))
+		{
+			RestartPlayer(PlayerController);
+		}
 	}
 }
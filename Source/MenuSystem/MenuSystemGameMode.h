@@ -6,6 +6,8 @@
 #include "GameFramework/GameModeBase.h"
 #include "MenuSystemGameMode.generated.h"
 
+struct FStreamableHandle;
+
 UCLASS(minimalapi)
 class AMenuSystemGameMode : public AGameModeBase
 {
@@ -13,6 +15,22 @@ class AMenuSystemGameMode : public AGameModeBase
 
 public:
 	AMenuSystemGameMode();
+
+	virtual void InitGame(const FString& MapName, const FString& Options, FString& ErrorMessage) override;
+	virtual UClass* GetDefaultPawnClassForController_Implementation(AController* InController) override;
+	virtual bool PlayerCanRestart_Implementation(APlayerController* Player) override;
+
+protected:
+	/// Blueprinted character; loaded in the background once the map is up instead of with this class' CDO at boot
+	/// Players that log in before it has loaded get their pawn when it arrives
+	UPROPERTY(EditDefaultsOnly, Category = Classes)
+	TSoftClassPtr<APawn> DefaultPawnSoftClass;
+
+private:
+	void OnDefaultPawnClassLoaded();
+
+	TSharedPtr<FStreamableHandle> DefaultPawnClassHandle;
+	double DefaultPawnClassLoadStartTime{ 0.0 };
 };
 
 
@@ -0,0 +1,430 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MenuSystemReplicationGraph.h"
+#include "MenuSystem.h"
+#include "Engine/Engine.h"
+#include "Engine/NetConnection.h"
+#include "Engine/ChildConnection.h"
+#include "Engine/NetDriver.h"
+#include "Engine/World.h"
+#include "GameFramework/Character.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/PlayerState.h"
+#include "HAL/IConsoleManager.h"
+
+namespace MenuSystemRepGraph
+{
+	/// Read when a net driver is created; changing it takes effect on the next ServerTravel / listen
+	static TAutoConsoleVariable<int32> CVarEnable(
+		TEXT("MenuSystem.RepGraph.Enable"),
+		1,
+		TEXT("Use the MenuSystem replication graph for the game net driver.\n")
+		TEXT("0: default actor-iteration replication, 1: replication graph (default)"),
+		ECVF_Default);
+}
+
+
+UMenuSystemReplicationGraph::UMenuSystemReplicationGraph()
+{
+}
+
+
+void UMenuSystemReplicationGraph::RegisterReplicationDriverFactory()
+{
+	UReplicationDriver::CreateReplicationDriverDelegate().BindLambda(
+		[](UNetDriver* ForNetDriver, const FURL& URL, UWorld* World) -> UReplicationDriver*
+		{
+			/// Only the game net driver gets the graph; beacons and replays keep the default path
+			if (ForNetDriver == nullptr || ForNetDriver->NetDriverName != NAME_GameNetDriver)
+			{
+				return nullptr;
+			}
+
+			if (MenuSystemRepGraph::CVarEnable.GetValueOnGameThread() == 0)
+			{
+				UE_LOG(LogMenuSystem, Log, TEXT("Replication graph disabled by MenuSystem.RepGraph.Enable, using actor-iteration replication"));
+				return nullptr;
+			}
+
+			return NewObject<UMenuSystemReplicationGraph>(GetTransientPackage());
+		});
+}
+
+
+void UMenuSystemReplicationGraph::UnregisterReplicationDriverFactory()
+{
+	UReplicationDriver::CreateReplicationDriverDelegate().Unbind();
+}
+
+
+void UMenuSystemReplicationGraph::SetActorNetUpdateFrequency(AActor* Actor, float NetUpdateFrequency)
+{
+	FGlobalActorReplicationInfo* GlobalInfo = GlobalActorReplicationInfoMap.Find(Actor);
+	if (GlobalInfo)
+	{
+		GlobalInfo->Settings.ReplicationPeriodFrame = GetReplicationPeriodFrameForFrequency(NetUpdateFrequency);
+	}
+}
+
+
+void UMenuSystemReplicationGraph::InitGlobalActorClassSettings()
+{
+	Super::InitGlobalActorClassSettings();
+
+	/// Characters replicate only inside the cull distance; this period is ACharacter's, each character gets its own
+	/// NetUpdateFrequency (so the blueprint's value) when it is routed, see RouteAddNetworkActorToNodes
+	const ACharacter* CharacterCDO = GetDefault<ACharacter>();
+
+	FClassReplicationInfo CharacterClassInfo;
+	CharacterClassInfo.SetCullDistanceSquared(CharacterCullDistance * CharacterCullDistance);
+	CharacterClassInfo.ReplicationPeriodFrame = GetReplicationPeriodFrameForFrequency(CharacterCDO->NetUpdateFrequency);
+	GlobalActorReplicationInfoMap.SetClassInfo(ACharacter::StaticClass(), CharacterClassInfo);
+
+	/// Player states are gathered by the roster node; distance does not matter for them
+	FClassReplicationInfo PlayerStateClassInfo;
+	PlayerStateClassInfo.SetCullDistanceSquared(0.f);
+	PlayerStateClassInfo.ReplicationPeriodFrame = 1;
+	GlobalActorReplicationInfoMap.SetClassInfo(APlayerState::StaticClass(), PlayerStateClassInfo);
+}
+
+
+void UMenuSystemReplicationGraph::InitGlobalGraphNodes()
+{
+	/// Spatial grid for characters and everything else that has a location
+	GridNode = CreateNewNode<UReplicationGraphNode_GridSpatialization2D>();
+	GridNode->CellSize = GridCellSize;
+	GridNode->SpatialBias = FVector2D(SpatialBiasX, SpatialBiasY);
+	AddGlobalGraphNode(GridNode);
+
+	/// One shared list for the game state and other always relevant actors
+	AlwaysRelevantNode = CreateNewNode<UReplicationGraphNode_ActorList>();
+	AddGlobalGraphNode(AlwaysRelevantNode);
+
+	/// Lobby roster; replicates a bounded number of player states per frame instead of all of them every tick
+	LobbyRosterNode = CreateNewNode<UReplicationGraphNode_PlayerStateFrequencyLimiter>();
+	LobbyRosterNode->TargetActorsPerFrame = RosterPlayerStatesPerFrame;
+	AddGlobalGraphNode(LobbyRosterNode);
+}
+
+
+void UMenuSystemReplicationGraph::InitConnectionGraphNodes(UNetReplicationGraphConnection* RepGraphConnection)
+{
+	Super::InitConnectionGraphNodes(RepGraphConnection);
+
+	/// The connection's own PlayerController and view target (its pawn)
+	UReplicationGraphNode_AlwaysRelevant_ForConnection* AlwaysRelevantForConnectionNode = CreateNewNode<UReplicationGraphNode_AlwaysRelevant_ForConnection>();
+	AddConnectionGraphNode(AlwaysRelevantForConnectionNode, RepGraphConnection);
+
+	/// Every other owner-only actor this connection owns; filled by UpdateOwnerOnlyActors
+	UMenuSystemReplicationGraphNode_OwnerOnly_ForConnection* OwnerOnlyNode = CreateNewNode<UMenuSystemReplicationGraphNode_OwnerOnly_ForConnection>();
+	AddConnectionGraphNode(OwnerOnlyNode, RepGraphConnection);
+	OwnerOnlyNodes.Add(RepGraphConnection->NetConnection, OwnerOnlyNode);
+}
+
+
+void UMenuSystemReplicationGraph::RemoveClientConnection(UNetConnection* NetConnection)
+{
+	/// Its node goes with it; the actors it owned are unset on the next UpdateOwnerOnlyActors
+	OwnerOnlyNodes.Remove(NetConnection);
+	Super::RemoveClientConnection(NetConnection);
+}
+
+
+int32 UMenuSystemReplicationGraph::ServerReplicateActors(float DeltaSeconds)
+{
+	UpdateOwnerOnlyActors();
+	return Super::ServerReplicateActors(DeltaSeconds);
+}
+
+
+UNetConnection* UMenuSystemReplicationGraph::GetOwningConnection(const AActor* Actor)
+{
+	UNetConnection* NetConnection = Actor->GetNetConnection();
+	UChildConnection* ChildConnection = NetConnection ? NetConnection->GetUChildConnection() : nullptr;
+	return ChildConnection ? ChildConnection->Parent : NetConnection;
+}
+
+
+UMenuSystemReplicationGraphNode_OwnerOnly_ForConnection* UMenuSystemReplicationGraph::FindOwnerOnlyNode(UNetConnection* NetConnection) const
+{
+	UMenuSystemReplicationGraphNode_OwnerOnly_ForConnection* const* OwnerOnlyNode = NetConnection ? OwnerOnlyNodes.Find(NetConnection) : nullptr;
+	return OwnerOnlyNode ? *OwnerOnlyNode : nullptr;
+}
+
+
+void UMenuSystemReplicationGraph::UpdateOwnerOnlyActors()
+{
+	for (TPair<AActor*, TWeakObjectPtr<UNetConnection>>& OwnerOnlyActor : OwnerOnlyActors)
+	{
+		UNetConnection* NetConnection = GetOwningConnection(OwnerOnlyActor.Key);
+		if (NetConnection == OwnerOnlyActor.Value.Get())
+		{
+			continue;
+		}
+
+		const FNewReplicatedActorInfo ActorInfo(OwnerOnlyActor.Key);
+		if (UMenuSystemReplicationGraphNode_OwnerOnly_ForConnection* OldNode = FindOwnerOnlyNode(OwnerOnlyActor.Value.Get()))
+		{
+			OldNode->NotifyRemoveNetworkActor(ActorInfo);
+		}
+
+		/// A connection without its node yet is retried next frame
+		UMenuSystemReplicationGraphNode_OwnerOnly_ForConnection* NewNode = FindOwnerOnlyNode(NetConnection);
+		if (NewNode)
+		{
+			NewNode->NotifyAddNetworkActor(ActorInfo);
+		}
+		OwnerOnlyActor.Value = NewNode ? NetConnection : nullptr;
+	}
+}
+
+
+EMenuSystemRepNodeMapping UMenuSystemReplicationGraph::GetMappingPolicy(const AActor* Actor) const
+{
+	/// The roster node finds player states on its own
+	if (Actor->IsA<APlayerState>())
+	{
+		return EMenuSystemRepNodeMapping::NotRouted;
+	}
+
+	/// PlayerControllers go through the always relevant per-connection node, other owner-only actors through the owner-only one
+	if (Actor->bOnlyRelevantToOwner)
+	{
+		return Actor->IsA<APlayerController>() ? EMenuSystemRepNodeMapping::NotRouted : EMenuSystemRepNodeMapping::RelevantOwnerOnly;
+	}
+
+	if (Actor->bAlwaysRelevant)
+	{
+		return EMenuSystemRepNodeMapping::RelevantAllConnections;
+	}
+
+	if (Actor->IsA<ACharacter>())
+	{
+		return EMenuSystemRepNodeMapping::Spatialize_Dynamic;
+	}
+
+	if (Actor->NetDormancy >= DORM_DormantAll)
+	{
+		return EMenuSystemRepNodeMapping::Spatialize_Dormancy;
+	}
+
+	return Actor->IsRootComponentMovable() ? EMenuSystemRepNodeMapping::Spatialize_Dynamic : EMenuSystemRepNodeMapping::Spatialize_Static;
+}
+
+
+void UMenuSystemReplicationGraph::RouteAddNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo, FGlobalActorReplicationInfo& GlobalInfo)
+{
+	/// Blueprint characters inherit ACharacter's class settings; their own NetUpdateFrequency is what they were tuned to
+	if (ActorInfo.Actor->IsA<ACharacter>())
+	{
+		GlobalInfo.Settings.ReplicationPeriodFrame = GetReplicationPeriodFrameForFrequency(ActorInfo.Actor->NetUpdateFrequency);
+	}
+
+	const EMenuSystemRepNodeMapping Policy = GetMappingPolicy(ActorInfo.Actor);
+	if (Policy != EMenuSystemRepNodeMapping::NotRouted)
+	{
+		RoutedPolicies.Add(ActorInfo.Actor, Policy);
+	}
+
+	switch (Policy)
+	{
+	case EMenuSystemRepNodeMapping::RelevantAllConnections:
+		AlwaysRelevantNode->NotifyAddNetworkActor(ActorInfo);
+		break;
+
+	case EMenuSystemRepNodeMapping::RelevantOwnerOnly:
+	{
+		/// The owner is often set after spawn; UpdateOwnerOnlyActors picks it up if it isn't known yet
+		UNetConnection* NetConnection = GetOwningConnection(ActorInfo.Actor);
+		UMenuSystemReplicationGraphNode_OwnerOnly_ForConnection* OwnerOnlyNode = FindOwnerOnlyNode(NetConnection);
+		if (OwnerOnlyNode)
+		{
+			OwnerOnlyNode->NotifyAddNetworkActor(ActorInfo);
+		}
+		OwnerOnlyActors.Add(ActorInfo.Actor, OwnerOnlyNode ? NetConnection : nullptr);
+		break;
+	}
+
+	case EMenuSystemRepNodeMapping::Spatialize_Static:
+		GridNode->AddActor_Static(ActorInfo, GlobalInfo);
+		break;
+
+	case EMenuSystemRepNodeMapping::Spatialize_Dynamic:
+		GridNode->AddActor_Dynamic(ActorInfo, GlobalInfo);
+		break;
+
+	case EMenuSystemRepNodeMapping::Spatialize_Dormancy:
+		GridNode->AddActor_Dormancy(ActorInfo, GlobalInfo);
+		break;
+
+	default:
+		break;
+	}
+}
+
+
+void UMenuSystemReplicationGraph::RouteRemoveNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo)
+{
+	/// Dormancy or bOnlyRelevantToOwner may have changed since the actor was added; it is in the node it was added to
+	EMenuSystemRepNodeMapping Policy = EMenuSystemRepNodeMapping::NotRouted;
+	RoutedPolicies.RemoveAndCopyValue(ActorInfo.Actor, Policy);
+
+	switch (Policy)
+	{
+	case EMenuSystemRepNodeMapping::RelevantAllConnections:
+		AlwaysRelevantNode->NotifyRemoveNetworkActor(ActorInfo);
+		break;
+
+	case EMenuSystemRepNodeMapping::RelevantOwnerOnly:
+	{
+		TWeakObjectPtr<UNetConnection> NetConnection;
+		if (OwnerOnlyActors.RemoveAndCopyValue(ActorInfo.Actor, NetConnection))
+		{
+			if (UMenuSystemReplicationGraphNode_OwnerOnly_ForConnection* OwnerOnlyNode = FindOwnerOnlyNode(NetConnection.Get()))
+			{
+				OwnerOnlyNode->NotifyRemoveNetworkActor(ActorInfo);
+			}
+		}
+		break;
+	}
+
+	case EMenuSystemRepNodeMapping::Spatialize_Static:
+		GridNode->RemoveActor_Static(ActorInfo);
+		break;
+
+	case EMenuSystemRepNodeMapping::Spatialize_Dynamic:
+		GridNode->RemoveActor_Dynamic(ActorInfo);
+		break;
+
+	case EMenuSystemRepNodeMapping::Spatialize_Dormancy:
+		GridNode->RemoveActor_Dormancy(ActorInfo);
+		break;
+
+	default:
+		break;
+	}
+}
+
+
+void UMenuSystemReplicationGraphNode_OwnerOnly_ForConnection::NotifyAddNetworkActor(const FNewReplicatedActorInfo& ActorInfo)
+{
+	ReplicationActorList.Add(ActorInfo.Actor);
+}
+
+
+bool UMenuSystemReplicationGraphNode_OwnerOnly_ForConnection::NotifyRemoveNetworkActor(const FNewReplicatedActorInfo& ActorInfo, bool bWarnIfNotFound)
+{
+	return ReplicationActorList.RemoveFast(ActorInfo.Actor);
+}
+
+
+void UMenuSystemReplicationGraphNode_OwnerOnly_ForConnection::NotifyResetAllNetworkActors()
+{
+	ReplicationActorList.Reset();
+}
+
+
+void UMenuSystemReplicationGraphNode_OwnerOnly_ForConnection::GatherActorListsForConnection(const FConnectionGatherActorListParameters& Params)
+{
+	if (ReplicationActorList.Num() > 0)
+	{
+		Params.OutGatheredReplicationLists.AddReplicationActorList(ReplicationActorList);
+	}
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+/// Benchmark
+///
+/// Measures how long the game net driver's TickFlush (where actors are replicated) takes on the server.
+/// Run it on a listen server with 25/50/100 clients connected, once with MenuSystem.RepGraph.Enable 0 and once with 1
+/// (re-open the lobby in between so the net driver is recreated), and compare the reported averages.
+
+#if !UE_BUILD_SHIPPING
+
+namespace MenuSystemRepGraph
+{
+	struct FNetFlushBenchmark
+	{
+		TWeakObjectPtr<UWorld> World;
+		FDelegateHandle TickFlushHandle;
+		FDelegateHandle PostTickFlushHandle;
+		double FlushStartTime{ 0.0 };
+		double EndTime{ 0.0 };
+		double TotalSeconds{ 0.0 };
+		double MaxSeconds{ 0.0 };
+		int32 NumSamples{ 0 };
+
+		void Start(UWorld* InWorld, float Duration)
+		{
+			Stop(false);
+			World = InWorld;
+			EndTime = FPlatformTime::Seconds() + Duration;
+
+			/// Multicast delegates broadcast in reverse order of binding, so binding after the net driver
+			/// means our TickFlush handler runs before the driver's and PostTickFlush runs after it
+			TickFlushHandle = InWorld->OnTickFlush().AddLambda([this](float)
+			{
+				FlushStartTime = FPlatformTime::Seconds();
+			});
+			PostTickFlushHandle = InWorld->OnPostTickFlush().AddLambda([this]()
+			{
+				const double Now = FPlatformTime::Seconds();
+				const double Elapsed = Now - FlushStartTime;
+				TotalSeconds += Elapsed;
+				MaxSeconds = FMath::Max(MaxSeconds, Elapsed);
+				++NumSamples;
+				if (Now >= EndTime)
+				{
+					Stop(true);
+				}
+			});
+		}
+
+		void Stop(bool bReport)
+		{
+			UWorld* BenchmarkWorld = World.Get();
+			if (BenchmarkWorld)
+			{
+				BenchmarkWorld->OnTickFlush().Remove(TickFlushHandle);
+				BenchmarkWorld->OnPostTickFlush().Remove(PostTickFlushHandle);
+			}
+
+			if (bReport && BenchmarkWorld && NumSamples > 0)
+			{
+				const UNetDriver* NetDriver = BenchmarkWorld->GetNetDriver();
+				UE_LOG(LogMenuSystem, Display, TEXT("Net benchmark: %s, %d connections, %d ticks, avg %.3f ms, max %.3f ms per net tick"),
+					(NetDriver && NetDriver->GetReplicationDriver()) ? TEXT("replication graph") : TEXT("actor iteration"),
+					NetDriver ? NetDriver->ClientConnections.Num() : 0,
+					NumSamples,
+					TotalSeconds / NumSamples * 1000.0,
+					MaxSeconds * 1000.0);
+			}
+
+			World.Reset();
+			TotalSeconds = 0.0;
+			MaxSeconds = 0.0;
+			NumSamples = 0;
+		}
+	};
+
+	static FNetFlushBenchmark NetFlushBenchmark;
+
+	static FAutoConsoleCommandWithWorldAndArgs CmdNetBenchmark(
+		TEXT("MenuSystem.Net.Benchmark"),
+		TEXT("Measures server net tick (replication) CPU time for N seconds (default 10) and logs the average and max."),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+		{
+			if (World == nullptr || World->GetNetMode() == NM_Client || World->GetNetDriver() == nullptr)
+			{
+				UE_LOG(LogMenuSystem, Warning, TEXT("MenuSystem.Net.Benchmark must be run on a listen or dedicated server"));
+				return;
+			}
+
+			const float Duration = Args.Num() > 0 ? FCString::Atof(*Args[0]) : 10.f;
+			NetFlushBenchmark.Start(World, Duration > 0.f ? Duration : 10.f);
+		}));
+}
+
+#endif
@@ -0,0 +1,132 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ReplicationGraph.h"
+#include "MenuSystemReplicationGraph.generated.h"
+
+class UReplicationGraphNode_GridSpatialization2D;
+class UReplicationGraphNode_ActorList;
+class UReplicationGraphNode_PlayerStateFrequencyLimiter;
+
+/// How an actor class is routed into the graph
+UENUM()
+enum class EMenuSystemRepNodeMapping : uint8
+{
+	NotRouted,					/// Handled by a per-connection node or gathered by the roster node; not routed to a global node
+	RelevantOwnerOnly,			/// Routed to the owner-only node of the connection that owns it, moved when the owner changes
+	RelevantAllConnections,		/// Routed to the always-relevant node (game state, game mode replicated info, etc.)
+	Spatialize_Static,			/// Routed to the grid node; the actor never moves so its cell is computed once
+	Spatialize_Dynamic,			/// Routed to the grid node; the cell is updated every frame (characters)
+	Spatialize_Dormancy,		/// Routed to the grid node; static while dormant and dynamic while awake
+};
+
+/**
+ * Replication graph for the lobby and match maps.
+ *
+ * The default net driver checks relevancy for every replicated actor against every connection each net tick,
+ * which is O(N^2) once the lobby approaches MaxPlayers. The graph splits the work up:
+ *  - Characters live in a 2D spatial grid, so each connection only considers the cells around its viewer.
+ *  - The game state and other bAlwaysRelevant actors live in a single list that every connection shares.
+ *  - The lobby roster (player states) replicates through a frequency limiter, a bounded number per frame.
+ *  - The connection's own PlayerController and view target go through a per-connection node.
+ *  - Other bOnlyRelevantToOwner actors go through the per-connection node of the connection that owns them.
+ */
+UCLASS(transient, config = Engine)
+class MENUSYSTEM_API UMenuSystemReplicationGraph : public UReplicationGraph
+{
+	GENERATED_BODY()
+
+public:
+	UMenuSystemReplicationGraph();
+
+	virtual void InitGlobalActorClassSettings() override;
+	virtual void InitGlobalGraphNodes() override;
+	virtual void InitConnectionGraphNodes(UNetReplicationGraphConnection* RepGraphConnection) override;
+	virtual void RouteAddNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo, FGlobalActorReplicationInfo& GlobalInfo) override;
+	virtual void RouteRemoveNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo) override;
+	virtual void RemoveClientConnection(UNetConnection* NetConnection) override;
+	virtual int32 ServerReplicateActors(float DeltaSeconds) override;
+
+	/// Binds UReplicationDriver::CreateReplicationDriverDelegate so the graph is created for the game net driver only
+	/// Honors the MenuSystem.RepGraph.Enable cvar at net driver creation, which allows before/after comparisons
+	static void RegisterReplicationDriverFactory();
+	static void UnregisterReplicationDriverFactory();
+
+	/// The graph schedules actors from its own per-actor settings rather than AActor::NetUpdateFrequency
+	/// Call this after changing an actor's NetUpdateFrequency at runtime so the graph picks up the new rate
+	void SetActorNetUpdateFrequency(AActor* Actor, float NetUpdateFrequency);
+
+	/// Size of one grid cell, in cm
+	UPROPERTY(config)
+	float GridCellSize{ 10000.f };
+
+	/// Lower left corner of the grid; actors below this are clamped into the first cell
+	UPROPERTY(config)
+	float SpatialBiasX{ -150000.f };
+
+	UPROPERTY(config)
+	float SpatialBiasY{ -200000.f };
+
+	/// Characters further than this from a viewer are not replicated to it, in cm
+	UPROPERTY(config)
+	float CharacterCullDistance{ 15000.f };
+
+	/// Number of player states the roster node replicates per frame
+	UPROPERTY(config)
+	int32 RosterPlayerStatesPerFrame{ 8 };
+
+private:
+
+	EMenuSystemRepNodeMapping GetMappingPolicy(const AActor* Actor) const;
+
+	/// Moves owner-only actors whose owning connection changed (or that got one) to that connection's node.
+	/// One pass over the owner-only actors per frame, before the connections gather.
+	void UpdateOwnerOnlyActors();
+
+	/// The top-level connection an owner-only actor replicates over; a split-screen child's actors go to its parent
+	static UNetConnection* GetOwningConnection(const AActor* Actor);
+
+	class UMenuSystemReplicationGraphNode_OwnerOnly_ForConnection* FindOwnerOnlyNode(UNetConnection* NetConnection) const;
+
+	/// Characters and other spatialized actors
+	UPROPERTY()
+	UReplicationGraphNode_GridSpatialization2D* GridNode;
+
+	/// Game state and other actors that every connection needs
+	UPROPERTY()
+	UReplicationGraphNode_ActorList* AlwaysRelevantNode;
+
+	/// Lobby roster; gathers player states on its own and replicates a bounded number each frame
+	UPROPERTY()
+	UReplicationGraphNode_PlayerStateFrequencyLimiter* LobbyRosterNode;
+
+	/// The policy each routed actor was added under, so it is removed from the same node even if its state changed since
+	TMap<FObjectKey, EMenuSystemRepNodeMapping> RoutedPolicies;
+
+	/// bOnlyRelevantToOwner actors other than PlayerControllers, and the connection whose node they are in (none yet: unset)
+	TMap<AActor*, TWeakObjectPtr<UNetConnection>> OwnerOnlyActors;
+
+	/// Each connection's owner-only node, see InitConnectionGraphNodes
+	TMap<TObjectKey<UNetConnection>, class UMenuSystemReplicationGraphNode_OwnerOnly_ForConnection*> OwnerOnlyNodes;
+};
+
+/**
+ * Per-connection node for the owner-only actors the connection (or one of its split-screen children) owns.
+ * The graph adds and removes them as their owner changes, so a gather only hands over this connection's own list.
+ */
+UCLASS()
+class MENUSYSTEM_API UMenuSystemReplicationGraphNode_OwnerOnly_ForConnection : public UReplicationGraphNode
+{
+	GENERATED_BODY()
+
+public:
+	virtual void NotifyAddNetworkActor(const FNewReplicatedActorInfo& ActorInfo) override;
+	virtual bool NotifyRemoveNetworkActor(const FNewReplicatedActorInfo& ActorInfo, bool bWarnIfNotFound = true) override;
+	virtual void NotifyResetAllNetworkActors() override;
+	virtual void GatherActorListsForConnection(const FConnectionGatherActorListParameters& Params) override;
+
+private:
+	FActorRepListRefView ReplicationActorList;
+};